@@ -0,0 +1,141 @@
+#include "Benchmark.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+uint64_t AllocationCounter::allocations = 0;
+uint64_t AllocationCounter::bytes = 0;
+uint64_t AllocationCounter::luaAllocations = 0;
+
+void *operator new(size_t size)
+{
+    AllocationCounter::allocations++;
+    AllocationCounter::bytes += size;
+    void *pointer = malloc(size ? size : 1);
+    if (!pointer) {
+        throw std::bad_alloc();
+    }
+    return pointer;
+}
+
+void operator delete(void *pointer) noexcept
+{
+    free(pointer);
+}
+
+void operator delete(void *pointer, size_t) noexcept
+{
+    free(pointer);
+}
+
+void *AllocationCounter::allocate(void *, void *pointer, size_t oldSize, size_t newSize)
+{
+    if (newSize == 0) {
+        free(pointer);
+        return nullptr;
+    }
+    if (newSize > oldSize || !pointer) {
+        luaAllocations++;
+    }
+    return realloc(pointer, newSize);
+}
+
+BenchmarkRunner::BenchmarkRunner(std::chrono::milliseconds minTime, unsigned int repetitions, std::string filter)
+    : minTime(minTime), repetitions(repetitions ? repetitions : 1), filter(std::move(filter))
+{}
+
+void BenchmarkRunner::add(std::string name, Body body)
+{
+    benchmarks.emplace_back(std::move(name), std::move(body));
+}
+
+std::vector<BenchmarkResult> BenchmarkRunner::run() const
+{
+    using Clock = std::chrono::steady_clock;
+
+    std::vector<BenchmarkResult> results;
+    for (const auto &benchmark : benchmarks) {
+        if (benchmark.first.find(filter) == std::string::npos) {
+            continue;
+        }
+
+        // Calibration: double iterations until the minimal time is reached
+        uint64_t iterations = 1;
+        while (true) {
+            const Clock::time_point started = Clock::now();
+            benchmark.second(iterations);
+            if (Clock::now() - started >= minTime || iterations >= (1ull << 40)) {
+                break;
+            }
+            iterations *= 2;
+        }
+
+        BenchmarkResult result{benchmark.first, iterations, 0, 0, 0, 0};
+        std::vector<double> times;
+        for (unsigned int i = 0; i < repetitions; i++) {
+            const uint64_t allocations = AllocationCounter::allocations;
+            const uint64_t bytes = AllocationCounter::bytes;
+            const uint64_t luaAllocations = AllocationCounter::luaAllocations;
+            const Clock::time_point started = Clock::now();
+
+            benchmark.second(iterations);
+
+            const std::chrono::duration<double, std::nano> elapsed = Clock::now() - started;
+            times.push_back(elapsed.count() / iterations);
+            if (i == 0) {
+                result.allocations = static_cast<double>(AllocationCounter::allocations - allocations) / iterations;
+                result.bytes = static_cast<double>(AllocationCounter::bytes - bytes) / iterations;
+                result.luaAllocations = static_cast<double>(AllocationCounter::luaAllocations - luaAllocations)
+                    / iterations;
+            }
+        }
+
+        std::sort(times.begin(), times.end());
+        result.nanoseconds = times[times.size() / 2];
+        results.push_back(std::move(result));
+
+        fprintf(
+            stderr,
+            "%-40s %12.1f ns %10.2f allocs %10.2f lua allocs\n",
+            results.back().name.c_str(),
+            results.back().nanoseconds,
+            results.back().allocations,
+            results.back().luaAllocations
+        );
+    }
+    return results;
+}
+
+void BenchmarkRunner::writeJson(std::ostream &stream, const std::vector<BenchmarkResult> &results) const
+{
+    char buffer[512];
+    snprintf(
+        buffer,
+        sizeof(buffer),
+        "{\n  \"min_time_ms\": %lld,\n  \"repetitions\": %u,\n  \"benchmarks\": [\n",
+        static_cast<long long>(minTime.count()),
+        repetitions
+    );
+    stream << buffer;
+
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchmarkResult &result = results[i];
+        // Names contain only [A-Za-z0-9/_]
+        snprintf(
+            buffer,
+            sizeof(buffer),
+            "    {\"name\": \"%s\", \"ns_per_op\": %.1f, \"allocs_per_op\": %.2f, \"bytes_per_op\": %.1f, "
+            "\"lua_allocs_per_op\": %.2f, \"iterations\": %llu}%s\n",
+            result.name.c_str(),
+            result.nanoseconds,
+            result.allocations,
+            result.bytes,
+            result.luaAllocations,
+            static_cast<unsigned long long>(result.iterations),
+            i + 1 < results.size() ? "," : ""
+        );
+        stream << buffer;
+    }
+    stream << "  ]\n}\n";
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+
+/**
+ * @brief Allocation counters of the benchmark process
+ * @details operator new is replaced in Benchmark.cpp, lua allocations are counted by allocate (pass it to lua_newstate).
+ */
+struct AllocationCounter
+{
+    static uint64_t allocations;                    ///< operator new calls
+    static uint64_t bytes;                          ///< operator new bytes
+    static uint64_t luaAllocations;                 ///< Lua allocator calls, which allocate or grow a block
+
+    /**
+     * @brief Counting lua allocator (lua_Alloc)
+     */
+    static void *allocate(void *userdata, void *pointer, size_t oldSize, size_t newSize);
+};
+
+/**
+ * @brief Benchmark result per operation
+ */
+struct BenchmarkResult
+{
+    std::string name;
+    uint64_t iterations;                            ///< Operations per repetition
+    double nanoseconds;                             ///< Median time
+    double allocations;
+    double bytes;
+    double luaAllocations;
+};
+
+/**
+ * @brief Runs registered benchmarks and writes results
+ * @details Every benchmark is calibrated to run at least the minimal time, then it is repeated
+ * and the median time is reported. Allocations are measured during the first repetition,
+ * they don't depend on the machine, so the output can be compared between builds.
+ */
+class BenchmarkRunner
+{
+public:
+    /// Performs the operation `iterations` times
+    using Body = std::function<void(uint64_t iterations)>;
+
+    /**
+     * @param minTime Minimal repetition time
+     * @param repetitions Repetitions amount
+     * @param filter Run only benchmarks containing the substring
+     */
+    BenchmarkRunner(std::chrono::milliseconds minTime, unsigned int repetitions, std::string filter);
+
+    void add(std::string name, Body body);
+
+    /**
+     * @brief Run matching benchmarks in the registration order
+     */
+    std::vector<BenchmarkResult> run() const;
+
+    /**
+     * @brief Write results as JSON (one benchmark per line, fixed key order)
+     */
+    void writeJson(std::ostream &stream, const std::vector<BenchmarkResult> &results) const;
+
+private:
+    std::chrono::milliseconds minTime;
+    unsigned int repetitions;
+    std::string filter;
+    std::vector<std::pair<std::string, Body>> benchmarks;
+};
+
+/**
+ * @brief Prevent the compiler from removing computation of the value
+ */
+template<typename T>
+inline void doNotOptimize(const T &value)
+{
+    asm volatile("" : : "r"(&value) : "memory");
+}
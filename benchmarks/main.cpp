@@ -0,0 +1,324 @@
+#include "Benchmark.h"
+#include "ModuleSdk/LuaVmExtended.h"
+#include "lua/lauxlib.h"
+#include "lua/lualib.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <list>
+#include <memory>
+
+namespace
+{
+
+const char *SHAPES_CODE = R"(
+function identity(...)
+    return ...
+end
+
+function makeShape(shape, size)
+    local result = {}
+    for i = 1, size do
+        if shape == "numbers" then
+            result[i] = i * 0.5
+        elseif shape == "strings" then
+            result[i] = "value" .. i
+        elseif shape == "records" then
+            result[i] = { id = i, name = "name" .. i, x = i * 1.5, y = -i, active = i % 2 == 0 }
+        elseif shape == "map" then
+            result["key" .. i] = i
+        else
+            result["node" .. i] = { position = { x = i, y = i * 2, z = 0.5 }, tags = { "a", "b" } }
+        end
+    end
+    return result
+end
+)";
+
+const char *LIST_SHAPES[] = {"numbers", "strings", "records"};
+const char *MAP_SHAPES[] = {"map", "nested"};
+const int TABLE_SIZES[] = {1, 16, 256, 4096};
+const int ARGUMENTS_AMOUNTS[] = {1, 8, 64};
+
+void printUsage(const char *program)
+{
+    fprintf(
+        stderr,
+        "Usage: %s [options]\n"
+        "  --filter <text>       Run only benchmarks containing the text\n"
+        "  --min-time <ms>       Minimal repetition time (default 20)\n"
+        "  --repetitions <n>     Repetitions, the median is reported (default 5)\n"
+        "  --output <path>       Write JSON to the file instead of stdout\n",
+        program
+    );
+}
+
+/**
+ * @brief Push table made by makeShape
+ */
+void pushShape(lua_State *luaVm, const char *shape, int size)
+{
+    lua_getglobal(luaVm, "makeShape");
+    lua_pushstring(luaVm, shape);
+    lua_pushinteger(luaVm, size);
+    if (lua_pcall(luaVm, 2, 1, 0) != 0) {
+        fprintf(stderr, "makeShape: %s\n", lua_tostring(luaVm, -1));
+        exit(1);
+    }
+}
+
+/**
+ * @brief Benchmarks of one table argument
+ * @param list Shape is parsed as a list (toList is measured)
+ */
+void addTableBenchmarks(BenchmarkRunner &runner, lua_State *luaVm, const char *shape, int size, bool list)
+{
+    const std::string suffix = std::string("/") + shape + "/" + std::to_string(size);
+    LuaVmExtended lua(luaVm);
+
+    pushShape(luaVm, shape, size);
+    // Parsed twice: equality compares independent trees
+    auto original = std::make_shared<LuaArgument>(lua.parseArgument(-1));
+    auto other = std::make_shared<LuaArgument>(lua.parseArgument(-1));
+    const int reference = luaL_ref(luaVm, LUA_REGISTRYINDEX);
+
+    runner.add(
+        "parseArgument" + suffix,
+        [luaVm, reference](uint64_t iterations)
+        {
+            LuaVmExtended lua(luaVm);
+            lua_rawgeti(luaVm, LUA_REGISTRYINDEX, reference);
+            for (uint64_t i = 0; i < iterations; i++) {
+                LuaArgument argument = lua.parseArgument(-1);
+                doNotOptimize(argument);
+            }
+            lua_pop(luaVm, 1);
+        }
+    );
+    runner.add(
+        "pushArguments" + suffix,
+        [luaVm, original](uint64_t iterations)
+        {
+            LuaVmExtended lua(luaVm);
+            const std::vector<LuaArgument> arguments{*original};
+            for (uint64_t i = 0; i < iterations; i++) {
+                lua.pushArguments(arguments.cbegin(), arguments.cend());
+                lua_pop(luaVm, 1);
+            }
+        }
+    );
+    runner.add(
+        "call" + suffix,
+        [luaVm, original](uint64_t iterations)
+        {
+            LuaVmExtended lua(luaVm);
+            const std::list<LuaArgument> arguments{*original};
+            for (uint64_t i = 0; i < iterations; i++) {
+                std::vector<LuaArgument> result = lua.call("identity", arguments, 1);
+                doNotOptimize(result);
+                lua_pop(luaVm, 1);
+            }
+        }
+    );
+    runner.add(
+        "copy" + suffix,
+        [original](uint64_t iterations)
+        {
+            for (uint64_t i = 0; i < iterations; i++) {
+                LuaArgument copy(*original);
+                doNotOptimize(copy);
+            }
+        }
+    );
+    runner.add(
+        "move" + suffix,
+        [original](uint64_t iterations)
+        {
+            for (uint64_t i = 0; i < iterations; i++) {
+                LuaArgument moved(std::move(*original));
+                doNotOptimize(moved);
+                *original = std::move(moved);
+            }
+        }
+    );
+    runner.add(
+        "equal" + suffix,
+        [original, other](uint64_t iterations)
+        {
+            for (uint64_t i = 0; i < iterations; i++) {
+                bool equal = *original == *other;
+                doNotOptimize(equal);
+            }
+        }
+    );
+    runner.add(
+        "hash" + suffix,
+        [original](uint64_t iterations)
+        {
+            const LuaArgumentHash hash;
+            for (uint64_t i = 0; i < iterations; i++) {
+                size_t value = hash(*original);
+                doNotOptimize(value);
+            }
+        }
+    );
+    runner.add(
+        "toMap" + suffix,
+        [original](uint64_t iterations)
+        {
+            for (uint64_t i = 0; i < iterations; i++) {
+                LuaArgument::TableMapType map = original->toMap();
+                doNotOptimize(map);
+            }
+        }
+    );
+    if (list) {
+        // Map with 1..n keys
+        auto indexed = std::make_shared<LuaArgument>(original->toMap());
+        runner.add(
+            "toList" + suffix,
+            [indexed](uint64_t iterations)
+            {
+                for (uint64_t i = 0; i < iterations; i++) {
+                    LuaArgument::TableListType converted = indexed->toList();
+                    doNotOptimize(converted);
+                }
+            }
+        );
+    }
+}
+
+/**
+ * @brief Benchmarks of scalar arguments lists (numbers, strings and booleans)
+ */
+void addScalarBenchmarks(BenchmarkRunner &runner, lua_State *luaVm, int amount)
+{
+    const std::string suffix = "/scalars/" + std::to_string(amount);
+
+    auto arguments = std::make_shared<std::vector<LuaArgument>>();
+    for (int i = 0; i < amount; i++) {
+        switch (i % 3) {
+            case 0:
+                arguments->emplace_back(i * 0.5);
+                break;
+            case 1:
+                arguments->emplace_back(std::string("value") + std::to_string(i));
+                break;
+            default:
+                arguments->emplace_back(i % 2 == 0);
+                break;
+        }
+    }
+
+    runner.add(
+        "getArguments" + suffix,
+        [luaVm, arguments](uint64_t iterations)
+        {
+            // Fresh stack, like a registered function sees it
+            lua_State *thread = lua_newthread(luaVm);
+            LuaVmExtended lua(thread);
+            lua.pushArguments(arguments->cbegin(), arguments->cend());
+            for (uint64_t i = 0; i < iterations; i++) {
+                std::vector<LuaArgument> parsed = lua.getArguments();
+                doNotOptimize(parsed);
+            }
+            lua_pop(luaVm, 1);
+        }
+    );
+    runner.add(
+        "pushArguments" + suffix,
+        [luaVm, arguments](uint64_t iterations)
+        {
+            LuaVmExtended lua(luaVm);
+            const int top = lua_gettop(luaVm);
+            for (uint64_t i = 0; i < iterations; i++) {
+                lua.pushArguments(arguments->cbegin(), arguments->cend());
+                lua_settop(luaVm, top);
+            }
+        }
+    );
+    runner.add(
+        "call" + suffix,
+        [luaVm, arguments, amount](uint64_t iterations)
+        {
+            LuaVmExtended lua(luaVm);
+            const std::list<LuaArgument> list(arguments->cbegin(), arguments->cend());
+            const int top = lua_gettop(luaVm);
+            for (uint64_t i = 0; i < iterations; i++) {
+                std::vector<LuaArgument> result = lua.call("identity", list, amount);
+                doNotOptimize(result);
+                lua_settop(luaVm, top);
+            }
+        }
+    );
+}
+
+}
+
+int main(int argc, char **argv)
+{
+    std::string filter;
+    long minTime = 20;
+    long repetitions = 5;
+    std::string output;
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 >= argc) {
+            printUsage(argv[0]);
+            return 2;
+        }
+
+        const char *option = argv[i];
+        const char *value = argv[++i];
+        if (strcmp(option, "--filter") == 0) {
+            filter = value;
+        } else if (strcmp(option, "--min-time") == 0) {
+            minTime = strtol(value, nullptr, 10);
+        } else if (strcmp(option, "--repetitions") == 0) {
+            repetitions = strtol(value, nullptr, 10);
+        } else if (strcmp(option, "--output") == 0) {
+            output = value;
+        } else {
+            printUsage(argv[0]);
+            return 2;
+        }
+    }
+
+    lua_State *luaVm = lua_newstate(AllocationCounter::allocate, nullptr);
+    if (!luaVm) {
+        fprintf(stderr, "Unable to create lua state\n");
+        return 1;
+    }
+    luaL_openlibs(luaVm);
+    if (luaL_dostring(luaVm, SHAPES_CODE) != 0) {
+        fprintf(stderr, "%s\n", lua_tostring(luaVm, -1));
+        return 1;
+    }
+
+    BenchmarkRunner runner(std::chrono::milliseconds(minTime), static_cast<unsigned int>(repetitions), filter);
+    for (int amount : ARGUMENTS_AMOUNTS) {
+        addScalarBenchmarks(runner, luaVm, amount);
+    }
+    for (const char *shape : LIST_SHAPES) {
+        for (int size : TABLE_SIZES) {
+            addTableBenchmarks(runner, luaVm, shape, size, true);
+        }
+    }
+    for (const char *shape : MAP_SHAPES) {
+        for (int size : TABLE_SIZES) {
+            addTableBenchmarks(runner, luaVm, shape, size, false);
+        }
+    }
+
+    const std::vector<BenchmarkResult> results = runner.run();
+    if (output.empty()) {
+        runner.writeJson(std::cout, results);
+    } else {
+        std::ofstream file(output);
+        runner.writeJson(file, results);
+    }
+
+    lua_close(luaVm);
+    return 0;
+}
@@ -0,0 +1,851 @@
+#include "HostElements.h"
+#include "ModuleHost.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+namespace
+{
+
+constexpr int INSPECT_DEPTH = 4;                    ///< Nested tables deeper are printed as {...}
+
+/**
+ * @brief Append iprint representation of the value
+ * @param quote Quote strings (nested values)
+ */
+void inspect(HostElements &elements, lua_State *luaVm, int index, std::string &out, int depth, bool quote)
+{
+    if (index < 0 && index > LUA_REGISTRYINDEX) {
+        index = lua_gettop(luaVm) + index + 1;
+    }
+    luaL_checkstack(luaVm, 3, "iprint nesting is too deep");
+
+    char buffer[64];
+    switch (lua_type(luaVm, index)) {
+        case LUA_TNIL:
+            out += "nil";
+            break;
+        case LUA_TBOOLEAN:
+            out += lua_toboolean(luaVm, index) ? "true" : "false";
+            break;
+        case LUA_TNUMBER:
+            snprintf(buffer, sizeof(buffer), LUA_NUMBER_FMT, lua_tonumber(luaVm, index));
+            out += buffer;
+            break;
+        case LUA_TSTRING: {
+            size_t length;
+            const char *string = lua_tolstring(luaVm, index, &length);
+            if (quote) {
+                out += '"';
+                out.append(string, length);
+                out += '"';
+            } else {
+                out.append(string, length);
+            }
+            break;
+        }
+        case LUA_TTABLE: {
+            if (depth >= INSPECT_DEPTH) {
+                out += "{...}";
+                break;
+            }
+
+            out += "{ ";
+            bool first = true;
+            const int size = static_cast<int>(lua_objlen(luaVm, index));
+            for (int i = 1; i <= size; i++) {
+                out += first ? "" : ", ";
+                first = false;
+                lua_rawgeti(luaVm, index, i);
+                inspect(elements, luaVm, -1, out, depth + 1, true);
+                lua_pop(luaVm, 1);
+            }
+
+            lua_pushnil(luaVm);
+            while (lua_next(luaVm, index)) {
+                const bool sequenceKey = lua_type(luaVm, -2) == LUA_TNUMBER
+                    && lua_tonumber(luaVm, -2) >= 1 && lua_tonumber(luaVm, -2) <= size
+                    && lua_tonumber(luaVm, -2) == static_cast<int>(lua_tonumber(luaVm, -2));
+                if (!sequenceKey) {
+                    out += first ? "" : ", ";
+                    first = false;
+                    if (lua_type(luaVm, -2) == LUA_TSTRING) {
+                        out += lua_tostring(luaVm, -2);     // String key is not converted in place
+                    } else {
+                        out += '[';
+                        inspect(elements, luaVm, -2, out, depth + 1, true);
+                        out += ']';
+                    }
+                    out += " = ";
+                    inspect(elements, luaVm, -1, out, depth + 1, true);
+                }
+                lua_pop(luaVm, 1);
+            }
+            out += first ? "}" : " }";
+            break;
+        }
+        case LUA_TUSERDATA: {
+            HostElements::ElementId id = elements.toElement(luaVm, index);
+            if (id) {
+                snprintf(buffer, sizeof(buffer), "elem:%s[%lu]", elements.find(id)->type.c_str(), id);
+                out += buffer;
+                break;
+            }
+        }
+        // Fallthrough
+        default:
+            snprintf(
+                buffer,
+                sizeof(buffer),
+                "%s: %p",
+                lua_typename(luaVm, lua_type(luaVm, index)),
+                lua_topointer(luaVm, index)
+            );
+            out += buffer;
+            break;
+    }
+}
+
+/**
+ * @brief Push element position as {x, y, z} (Vector3 of the server)
+ */
+void pushPosition(lua_State *luaVm, const HostElements::Element &element)
+{
+    lua_createtable(luaVm, 0, 3);
+    lua_pushnumber(luaVm, element.position[0]);
+    lua_setfield(luaVm, -2, "x");
+    lua_pushnumber(luaVm, element.position[1]);
+    lua_setfield(luaVm, -2, "y");
+    lua_pushnumber(luaVm, element.position[2]);
+    lua_setfield(luaVm, -2, "z");
+}
+
+}
+
+HostElements::HostElements(ModuleHost &host)
+    : host(host)
+{
+    root = this->create("root", 0);
+    console = this->create("console", root);
+}
+
+HostElements::ElementId HostElements::create(std::string type, ElementId parent)
+{
+    const ElementId id = nextId++;
+    elements.emplace(id, Element{std::move(type), parent, {0, 0, 0}, 0});
+    return id;
+}
+
+bool HostElements::destroy(ElementId id)
+{
+    if (elements.find(id) == elements.end()) {
+        return false;
+    }
+
+    std::vector<ElementId> children;
+    for (const auto &pair : elements) {
+        if (pair.second.parent == id) {
+            children.push_back(pair.first);
+        }
+    }
+    for (ElementId child : children) {
+        this->destroy(child);
+    }
+
+    elements.erase(id);
+    return true;
+}
+
+HostElements::Element *HostElements::find(ElementId id)
+{
+    auto found = elements.find(id);
+    return found == elements.end() ? nullptr : &found->second;
+}
+
+bool HostElements::isAncestor(ElementId ancestor, ElementId element) const
+{
+    while (element) {
+        if (element == ancestor) {
+            return true;
+        }
+
+        auto found = elements.find(element);
+        if (found == elements.end()) {
+            return false;
+        }
+        element = found->second.parent;
+    }
+    return false;
+}
+
+void HostElements::registerFunctions(lua_State *luaVm, ElementId resourceRoot)
+{
+    // Registry layout of the server: element userdata cache (weak values) and class metatables
+    lua_pushstring(luaVm, "ud");
+    lua_newtable(luaVm);
+    lua_newtable(luaVm);
+    lua_pushstring(luaVm, "v");
+    lua_setfield(luaVm, -2, "__mode");
+    lua_setmetatable(luaVm, -2);
+    lua_rawset(luaVm, LUA_REGISTRYINDEX);
+
+    // Class methods take the element as the first argument
+    const luaL_Reg methods[] = {
+        {"getPosition", luaGetPosition},
+        {"setPosition", luaSetElementPosition},
+        {"getDimension", luaGetElementDimension},
+        {"setDimension", luaSetElementDimension},
+        {"getType", luaGetElementType},
+        {"destroy", luaDestroyElement},
+        {nullptr, nullptr}
+    };
+    lua_newtable(luaVm);
+    const int methodsIndex = lua_gettop(luaVm);
+    for (const luaL_Reg *method = methods; method->name; method++) {
+        lua_pushlightuserdata(luaVm, this);
+        lua_pushcclosure(luaVm, method->func, 1);
+        lua_setfield(luaVm, methodsIndex, method->name);
+    }
+
+    lua_pushstring(luaVm, "mt");
+    lua_newtable(luaVm);
+    for (const char *name : {"Element", "Ped"}) {
+        lua_newtable(luaVm);
+        lua_pushlightuserdata(luaVm, this);
+        lua_pushvalue(luaVm, methodsIndex);
+        lua_pushcclosure(luaVm, luaElementIndex, 2);
+        lua_setfield(luaVm, -2, "__index");
+        lua_pushlightuserdata(luaVm, this);
+        lua_pushcclosure(luaVm, luaElementNewIndex, 1);
+        lua_setfield(luaVm, -2, "__newindex");
+        lua_pushlightuserdata(luaVm, this);
+        lua_pushcclosure(luaVm, luaElementToString, 1);
+        lua_setfield(luaVm, -2, "__tostring");
+        lua_pushstring(luaVm, name);
+        lua_setfield(luaVm, -2, "__class");
+        lua_setfield(luaVm, -2, name);
+    }
+    lua_rawset(luaVm, LUA_REGISTRYINDEX);
+
+    // Class tables: Element.getDimension(element), Ped(model, x, y, z) and Ped.create(...)
+    lua_pushvalue(luaVm, methodsIndex);
+    lua_setglobal(luaVm, "Element");
+
+    lua_newtable(luaVm);
+    lua_newtable(luaVm);
+    lua_pushvalue(luaVm, methodsIndex);
+    lua_setfield(luaVm, -2, "__index");
+    lua_pushlightuserdata(luaVm, this);
+    lua_pushcclosure(luaVm, luaPedCall, 1);
+    lua_setfield(luaVm, -2, "__call");
+    lua_setmetatable(luaVm, -2);
+    lua_pushlightuserdata(luaVm, this);
+    lua_pushcclosure(luaVm, luaCreatePed, 1);
+    lua_setfield(luaVm, -2, "create");
+    lua_setglobal(luaVm, "Ped");
+    lua_pop(luaVm, 1);                              // Methods
+
+    const luaL_Reg functions[] = {
+        {"iprint", luaIprint},
+        {"outputDebugString", luaOutputDebugString},
+        {"outputServerLog", luaOutputServerLog},
+        {"getTickCount", luaGetTickCount},
+        {"setTimer", luaSetTimer},
+        {"killTimer", luaKillTimer},
+        {"addEventHandler", luaAddEventHandler},
+        {"addCommandHandler", luaAddCommandHandler},
+        {"createPed", luaCreatePed},
+        {"isElement", luaIsElement},
+        {"destroyElement", luaDestroyElement},
+        {"getElementType", luaGetElementType},
+        {"getElementsByType", luaGetElementsByType},
+        {"getElementPosition", luaGetElementPosition},
+        {"setElementPosition", luaSetElementPosition},
+        {"getElementDimension", luaGetElementDimension},
+        {"setElementDimension", luaSetElementDimension},
+        {"getRootElement", luaGetRootElement},
+        {"getResourceRootElement", luaGetResourceRootElement},
+        {nullptr, nullptr}
+    };
+    for (const luaL_Reg *function = functions; function->name; function++) {
+        lua_pushlightuserdata(luaVm, this);
+        lua_pushcclosure(luaVm, function->func, 1);
+        lua_setglobal(luaVm, function->name);
+    }
+
+    this->pushElement(luaVm, root);
+    lua_setglobal(luaVm, "root");
+    this->pushElement(luaVm, resourceRoot);
+    lua_setglobal(luaVm, "resourceRoot");
+}
+
+void HostElements::pushElement(lua_State *luaVm, ElementId id)
+{
+    const Element *element = this->find(id);
+    if (!element) {
+        lua_pushnil(luaVm);
+        return;
+    }
+    auto *pointer = reinterpret_cast<void *>(id);
+
+    lua_pushstring(luaVm, "ud");
+    lua_rawget(luaVm, LUA_REGISTRYINDEX);
+
+    lua_pushlightuserdata(luaVm, pointer);
+    lua_rawget(luaVm, -2);
+    if (lua_isnil(luaVm, -1)) {
+        lua_pop(luaVm, 1);
+
+        *static_cast<void **>(lua_newuserdata(luaVm, sizeof(void *))) = pointer;
+        lua_pushlightuserdata(luaVm, pointer);
+        lua_pushvalue(luaVm, -2);
+        lua_rawset(luaVm, -4);
+    }
+    lua_remove(luaVm, -2);                          // ud
+
+    lua_pushstring(luaVm, "mt");
+    lua_rawget(luaVm, LUA_REGISTRYINDEX);
+    lua_getfield(luaVm, -1, getClassName(element->type));
+    lua_remove(luaVm, -2);                          // mt
+    lua_setmetatable(luaVm, -2);
+}
+
+HostElements::ElementId HostElements::toElement(lua_State *luaVm, int index)
+{
+    if (lua_type(luaVm, index) != LUA_TUSERDATA || lua_objlen(luaVm, index) < sizeof(void *)) {
+        return 0;
+    }
+
+    auto id = reinterpret_cast<ElementId>(*static_cast<void **>(lua_touserdata(luaVm, index)));
+    return elements.find(id) == elements.end() ? 0 : id;
+}
+
+size_t HostElements::triggerEvent(const std::string &name, ElementId source)
+{
+    // Handlers may add handlers
+    const std::vector<Handler> current = events;
+
+    size_t called = 0;
+    for (const Handler &handler : current) {
+        if (handler.name != name || !this->isAncestor(handler.element, source)) {
+            continue;
+        }
+
+        this->pushElement(handler.luaVm, source);
+        lua_setglobal(handler.luaVm, "source");
+        lua_pushstring(handler.luaVm, name.c_str());
+        lua_setglobal(handler.luaVm, "eventName");
+        this->callHandler(handler, 0);
+        called++;
+    }
+    return called;
+}
+
+size_t HostElements::executeCommand(const std::string &command, const std::vector<std::string> &arguments)
+{
+    const std::vector<Handler> current = commands;
+
+    size_t called = 0;
+    for (const Handler &handler : current) {
+        if (handler.name != command) {
+            continue;
+        }
+
+        luaL_checkstack(handler.luaVm, static_cast<int>(arguments.size()) + 3, "Too many command arguments");
+        this->pushElement(handler.luaVm, console);
+        lua_pushstring(handler.luaVm, command.c_str());
+        for (const std::string &argument : arguments) {
+            lua_pushstring(handler.luaVm, argument.c_str());
+        }
+        this->callHandler(handler, static_cast<int>(arguments.size()) + 2);
+        called++;
+    }
+    return called;
+}
+
+size_t HostElements::runTimers(unsigned long tick)
+{
+    // Callbacks may set and kill timers
+    const std::vector<Timer> current = timers;
+
+    size_t called = 0;
+    for (const Timer &timer : current) {
+        auto found = std::find_if(
+            timers.begin(),
+            timers.end(),
+            [&timer](const Timer &existing)
+            {
+                return existing.handler.element == timer.handler.element;
+            }
+        );
+        if (found == timers.end() || found->due > tick) {
+            continue;
+        }
+        if (!this->find(found->handler.element)) {
+            this->removeTimer(found->handler.element);      // Destroyed by destroyElement
+            continue;
+        }
+
+        const bool last = found->remaining == 1;
+        if (!last) {
+            found->due = tick + found->interval;
+            found->remaining -= found->remaining > 0;
+        }
+
+        lua_State *luaVm = timer.handler.luaVm;
+        lua_rawgeti(luaVm, LUA_REGISTRYINDEX, timer.arguments);
+        lua_getfield(luaVm, -1, "n");
+        const int arguments = static_cast<int>(lua_tointeger(luaVm, -1));
+        lua_pop(luaVm, 1);
+        luaL_checkstack(luaVm, arguments + 1, "Too many timer arguments");
+        for (int i = 1; i <= arguments; i++) {
+            lua_rawgeti(luaVm, -i, i);
+        }
+        lua_remove(luaVm, -(arguments + 1));        // Arguments table
+
+        // The timer is destroyed before its last call, like on the server
+        const Handler handler = timer.handler;
+        if (last) {
+            timers.erase(found);
+            this->destroy(handler.element);
+            luaL_unref(luaVm, LUA_REGISTRYINDEX, timer.arguments);
+        }
+        this->callHandler(handler, arguments);
+        if (last) {
+            luaL_unref(luaVm, LUA_REGISTRYINDEX, handler.reference);
+        }
+        called++;
+    }
+    return called;
+}
+
+void HostElements::removeTimer(ElementId timer)
+{
+    auto found = std::find_if(
+        timers.begin(),
+        timers.end(),
+        [timer](const Timer &existing)
+        {
+            return existing.handler.element == timer;
+        }
+    );
+    if (found == timers.end()) {
+        return;
+    }
+
+    luaL_unref(found->handler.luaVm, LUA_REGISTRYINDEX, found->handler.reference);
+    luaL_unref(found->handler.luaVm, LUA_REGISTRYINDEX, found->arguments);
+    timers.erase(found);
+    this->destroy(timer);
+}
+
+void HostElements::removeHandlers(lua_State *luaVm)
+{
+    // The VM is closed with its registry references
+    auto fromVm = [luaVm](const Handler &handler)
+    {
+        return handler.luaVm == luaVm;
+    };
+    events.erase(std::remove_if(events.begin(), events.end(), fromVm), events.end());
+    commands.erase(std::remove_if(commands.begin(), commands.end(), fromVm), commands.end());
+    timers.erase(
+        std::remove_if(
+            timers.begin(),
+            timers.end(),
+            [luaVm](const Timer &timer)
+            {
+                return timer.handler.luaVm == luaVm;
+            }
+        ),
+        timers.end()
+    );
+}
+
+const char *HostElements::getClassName(const std::string &type)
+{
+    return type == "ped" ? "Ped" : "Element";
+}
+
+HostElements &HostElements::self(lua_State *luaVm)
+{
+    return *static_cast<HostElements *>(lua_touserdata(luaVm, lua_upvalueindex(1)));
+}
+
+HostElements::ElementId HostElements::checkElement(lua_State *luaVm, int index)
+{
+    HostElements &elements = self(luaVm);
+    const ElementId id = elements.toElement(luaVm, index);
+    if (!id) {
+        // Warning and false result, like the server argument parser
+        lua_Debug info;
+        const char *name = "?";
+        if (lua_getstack(luaVm, 0, &info) && lua_getinfo(luaVm, "n", &info) && info.name) {
+            name = info.name;
+        }
+        elements.host.output(
+            2,
+            std::string("Bad argument @ '") + name + "' [Expected element at argument " + std::to_string(index) + "]"
+        );
+    }
+    return id;
+}
+
+void HostElements::callHandler(const Handler &handler, int arguments)
+{
+    lua_State *luaVm = handler.luaVm;
+    lua_rawgeti(luaVm, LUA_REGISTRYINDEX, handler.reference);
+    lua_insert(luaVm, -(arguments + 1));
+    if (lua_pcall(luaVm, arguments, 0, 0) != 0) {
+        const char *message = lua_tostring(luaVm, -1);
+        host.scriptError(message ? message : "Error object is not a string");
+        lua_pop(luaVm, 1);
+    }
+}
+
+int HostElements::luaIprint(lua_State *luaVm)
+{
+    HostElements &elements = self(luaVm);
+    std::string line;
+    const int top = lua_gettop(luaVm);
+    for (int i = 1; i <= top; i++) {
+        if (i > 1) {
+            line += ' ';
+        }
+        inspect(elements, luaVm, i, line, 0, false);
+    }
+
+    elements.host.output(3, line);
+    return 0;
+}
+
+int HostElements::luaOutputDebugString(lua_State *luaVm)
+{
+    const char *text = lua_tostring(luaVm, 1);
+    const int level = static_cast<int>(luaL_optinteger(luaVm, 2, 3));
+    self(luaVm).host.output(level, text ? text : luaL_typename(luaVm, 1));
+    lua_pushboolean(luaVm, 1);
+    return 1;
+}
+
+int HostElements::luaOutputServerLog(lua_State *luaVm)
+{
+    const char *text = lua_tostring(luaVm, 1);
+    self(luaVm).host.output(0, text ? text : luaL_typename(luaVm, 1));
+    lua_pushboolean(luaVm, 1);
+    return 1;
+}
+
+int HostElements::luaGetTickCount(lua_State *luaVm)
+{
+    lua_pushnumber(luaVm, static_cast<lua_Number>(self(luaVm).host.getTickCount()));
+    return 1;
+}
+
+int HostElements::luaSetTimer(lua_State *luaVm)
+{
+    HostElements &elements = self(luaVm);
+    luaL_checktype(luaVm, 1, LUA_TFUNCTION);
+    const lua_Number interval = luaL_checknumber(luaVm, 2);
+    const lua_Number times = luaL_checknumber(luaVm, 3);
+    if (interval < 0 || times < 0) {
+        lua_pushboolean(luaVm, 0);
+        return 1;
+    }
+
+    // Arguments are kept with their amount, they may contain nils
+    const int top = lua_gettop(luaVm);
+    lua_createtable(luaVm, top - 3, 1);
+    for (int i = 4; i <= top; i++) {
+        lua_pushvalue(luaVm, i);
+        lua_rawseti(luaVm, -2, i - 3);
+    }
+    lua_pushinteger(luaVm, top - 3);
+    lua_setfield(luaVm, -2, "n");
+    const int arguments = luaL_ref(luaVm, LUA_REGISTRYINDEX);
+
+    ModuleHost::Resource *resource = elements.host.findResource(luaVm);
+    const ElementId id = elements.create("timer", resource ? resource->element : elements.root);
+    lua_pushvalue(luaVm, 1);
+    const Handler handler{luaVm, "timer", id, luaL_ref(luaVm, LUA_REGISTRYINDEX)};
+    const auto milliseconds = static_cast<unsigned long>(interval);
+    elements.timers.push_back(
+        {handler, arguments, milliseconds, elements.host.getTickCount() + milliseconds, static_cast<unsigned long>(times)}
+    );
+
+    elements.pushElement(luaVm, id);
+    return 1;
+}
+
+int HostElements::luaKillTimer(lua_State *luaVm)
+{
+    HostElements &elements = self(luaVm);
+    const ElementId timer = elements.toElement(luaVm, 1);
+    const Element *element = elements.find(timer);
+    if (!element || element->type != "timer") {
+        lua_pushboolean(luaVm, 0);
+        return 1;
+    }
+
+    elements.removeTimer(timer);
+    lua_pushboolean(luaVm, 1);
+    return 1;
+}
+
+int HostElements::luaAddEventHandler(lua_State *luaVm)
+{
+    const char *name = luaL_checkstring(luaVm, 1);
+    const ElementId element = checkElement(luaVm, 2);
+    luaL_checktype(luaVm, 3, LUA_TFUNCTION);
+    if (!element) {
+        lua_pushboolean(luaVm, 0);
+        return 1;
+    }
+
+    lua_pushvalue(luaVm, 3);
+    self(luaVm).events.push_back({luaVm, name, element, luaL_ref(luaVm, LUA_REGISTRYINDEX)});
+    lua_pushboolean(luaVm, 1);
+    return 1;
+}
+
+int HostElements::luaAddCommandHandler(lua_State *luaVm)
+{
+    const char *name = luaL_checkstring(luaVm, 1);
+    luaL_checktype(luaVm, 2, LUA_TFUNCTION);
+
+    lua_pushvalue(luaVm, 2);
+    self(luaVm).commands.push_back({luaVm, name, 0, luaL_ref(luaVm, LUA_REGISTRYINDEX)});
+    lua_pushboolean(luaVm, 1);
+    return 1;
+}
+
+int HostElements::luaCreatePed(lua_State *luaVm)
+{
+    HostElements &elements = self(luaVm);
+    luaL_checkinteger(luaVm, 1);                    // Model
+    const lua_Number x = luaL_checknumber(luaVm, 2);
+    const lua_Number y = luaL_checknumber(luaVm, 3);
+    const lua_Number z = luaL_checknumber(luaVm, 4);
+
+    ModuleHost::Resource *resource = elements.host.findResource(luaVm);
+    const ElementId id = elements.create("ped", resource ? resource->element : elements.root);
+    Element &element = *elements.find(id);
+    element.position[0] = static_cast<float>(x);
+    element.position[1] = static_cast<float>(y);
+    element.position[2] = static_cast<float>(z);
+
+    elements.pushElement(luaVm, id);
+    return 1;
+}
+
+int HostElements::luaPedCall(lua_State *luaVm)
+{
+    lua_remove(luaVm, 1);                           // Ped class table
+    return luaCreatePed(luaVm);
+}
+
+int HostElements::luaIsElement(lua_State *luaVm)
+{
+    lua_pushboolean(luaVm, self(luaVm).toElement(luaVm, 1) != 0);
+    return 1;
+}
+
+int HostElements::luaDestroyElement(lua_State *luaVm)
+{
+    HostElements &elements = self(luaVm);
+    const ElementId id = checkElement(luaVm, 1);
+    const bool destroyed = id && id != elements.root && id != elements.console && elements.destroy(id);
+    lua_pushboolean(luaVm, destroyed);
+    return 1;
+}
+
+int HostElements::luaGetElementType(lua_State *luaVm)
+{
+    const ElementId id = checkElement(luaVm, 1);
+    if (!id) {
+        lua_pushboolean(luaVm, 0);
+        return 1;
+    }
+
+    lua_pushstring(luaVm, self(luaVm).find(id)->type.c_str());
+    return 1;
+}
+
+int HostElements::luaGetElementsByType(lua_State *luaVm)
+{
+    HostElements &elements = self(luaVm);
+    const std::string type = luaL_checkstring(luaVm, 1);
+
+    // Creation order
+    std::vector<ElementId> found;
+    for (const auto &pair : elements.elements) {
+        if (pair.second.type == type) {
+            found.push_back(pair.first);
+        }
+    }
+    std::sort(found.begin(), found.end());
+
+    lua_createtable(luaVm, static_cast<int>(found.size()), 0);
+    for (size_t i = 0; i < found.size(); i++) {
+        elements.pushElement(luaVm, found[i]);
+        lua_rawseti(luaVm, -2, static_cast<int>(i + 1));
+    }
+    return 1;
+}
+
+int HostElements::luaGetElementPosition(lua_State *luaVm)
+{
+    const ElementId id = checkElement(luaVm, 1);
+    if (!id) {
+        lua_pushboolean(luaVm, 0);
+        return 1;
+    }
+
+    const Element &element = *self(luaVm).find(id);
+    lua_pushnumber(luaVm, element.position[0]);
+    lua_pushnumber(luaVm, element.position[1]);
+    lua_pushnumber(luaVm, element.position[2]);
+    return 3;
+}
+
+int HostElements::luaSetElementPosition(lua_State *luaVm)
+{
+    const ElementId id = checkElement(luaVm, 1);
+    if (!id) {
+        lua_pushboolean(luaVm, 0);
+        return 1;
+    }
+
+    Element &element = *self(luaVm).find(id);
+    for (int i = 0; i < 3; i++) {
+        element.position[i] = static_cast<float>(luaL_checknumber(luaVm, i + 2));
+    }
+    lua_pushboolean(luaVm, 1);
+    return 1;
+}
+
+int HostElements::luaGetElementDimension(lua_State *luaVm)
+{
+    const ElementId id = checkElement(luaVm, 1);
+    if (!id) {
+        lua_pushboolean(luaVm, 0);
+        return 1;
+    }
+
+    lua_pushinteger(luaVm, self(luaVm).find(id)->dimension);
+    return 1;
+}
+
+int HostElements::luaSetElementDimension(lua_State *luaVm)
+{
+    const ElementId id = checkElement(luaVm, 1);
+    if (!id) {
+        lua_pushboolean(luaVm, 0);
+        return 1;
+    }
+
+    self(luaVm).find(id)->dimension = static_cast<int>(luaL_checkinteger(luaVm, 2));
+    lua_pushboolean(luaVm, 1);
+    return 1;
+}
+
+int HostElements::luaGetRootElement(lua_State *luaVm)
+{
+    HostElements &elements = self(luaVm);
+    elements.pushElement(luaVm, elements.root);
+    return 1;
+}
+
+int HostElements::luaGetResourceRootElement(lua_State *luaVm)
+{
+    HostElements &elements = self(luaVm);
+    ModuleHost::Resource *resource = elements.host.findResource(luaVm);
+    if (!resource) {
+        lua_pushboolean(luaVm, 0);
+        return 1;
+    }
+
+    elements.pushElement(luaVm, resource->element);
+    return 1;
+}
+
+int HostElements::luaGetPosition(lua_State *luaVm)
+{
+    const ElementId id = checkElement(luaVm, 1);
+    if (!id) {
+        lua_pushboolean(luaVm, 0);
+        return 1;
+    }
+
+    pushPosition(luaVm, *self(luaVm).find(id));
+    return 1;
+}
+
+int HostElements::luaElementIndex(lua_State *luaVm)
+{
+    // Methods first (upvalue 2), then properties
+    lua_pushvalue(luaVm, 2);
+    lua_rawget(luaVm, lua_upvalueindex(2));
+    if (!lua_isnil(luaVm, -1)) {
+        return 1;
+    }
+    lua_pop(luaVm, 1);
+
+    HostElements &elements = self(luaVm);
+    const ElementId id = elements.toElement(luaVm, 1);
+    const char *key = lua_tostring(luaVm, 2);
+    if (!id || !key) {
+        lua_pushnil(luaVm);
+        return 1;
+    }
+
+    const Element &element = *elements.find(id);
+    if (strcmp(key, "position") == 0) {
+        pushPosition(luaVm, element);
+    } else if (strcmp(key, "dimension") == 0) {
+        lua_pushinteger(luaVm, element.dimension);
+    } else if (strcmp(key, "type") == 0) {
+        lua_pushstring(luaVm, element.type.c_str());
+    } else {
+        lua_pushnil(luaVm);
+    }
+    return 1;
+}
+
+int HostElements::luaElementNewIndex(lua_State *luaVm)
+{
+    HostElements &elements = self(luaVm);
+    const ElementId id = elements.toElement(luaVm, 1);
+    const char *key = lua_tostring(luaVm, 2);
+    if (!id || !key) {
+        return luaL_error(luaVm, "Element has been destroyed");
+    }
+
+    Element &element = *elements.find(id);
+    if (strcmp(key, "dimension") == 0) {
+        element.dimension = static_cast<int>(luaL_checkinteger(luaVm, 3));
+    } else if (strcmp(key, "position") == 0) {
+        luaL_checktype(luaVm, 3, LUA_TTABLE);
+        const char *axes[] = {"x", "y", "z"};
+        for (int i = 0; i < 3; i++) {
+            lua_getfield(luaVm, 3, axes[i]);
+            element.position[i] = static_cast<float>(luaL_checknumber(luaVm, -1));
+            lua_pop(luaVm, 1);
+        }
+    } else {
+        return luaL_error(luaVm, "Property '%s' is read-only or does not exist", key);
+    }
+    return 0;
+}
+
+int HostElements::luaElementToString(lua_State *luaVm)
+{
+    HostElements &elements = self(luaVm);
+    const ElementId id = elements.toElement(luaVm, 1);
+    if (!id) {
+        lua_pushstring(luaVm, "userdata");
+        return 1;
+    }
+
+    lua_pushfstring(luaVm, "elem:%s%p", elements.find(id)->type.c_str(), lua_touserdata(luaVm, 1));
+    return 1;
+}
@@ -0,0 +1,207 @@
+#pragma once
+
+#include "lua/ILuaModuleManager.h"
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class ModuleHost;
+
+
+/**
+ * @brief Minimal MTASA element tree, events and script functions of the host
+ * @details Elements are pushed as full userdata with the element ID, cached in the registry "ud" table
+ * and get class metatables from the registry "mt" table, like the server does.
+ * Only the functions used by the SDK tests and benchmarks are emulated:
+ * iprint, outputDebugString, outputServerLog, getTickCount, setTimer, killTimer, addEventHandler, addCommandHandler,
+ * createPed (Ped), isElement, destroyElement, getElementType, getElementsByType,
+ * get/setElementPosition, get/setElementDimension, getRootElement, getResourceRootElement,
+ * root and resourceRoot globals, Element and Ped classes (position, dimension and type properties).
+ */
+class HostElements
+{
+public:
+    using ElementId = unsigned long;
+
+    struct Element
+    {
+        std::string type;
+        ElementId parent;
+        float position[3];
+        int dimension;
+    };
+
+    explicit HostElements(ModuleHost &host);
+
+    HostElements(const HostElements &) = delete;
+
+    HostElements &operator=(const HostElements &) = delete;
+
+    /**
+     * @brief Create element
+     * @return Element ID
+     */
+    ElementId create(std::string type, ElementId parent);
+
+    /**
+     * @brief Destroy element and its children
+     * @return false, if the element does not exist
+     */
+    bool destroy(ElementId id);
+
+    /**
+     * @return nullptr, if the element does not exist
+     */
+    Element *find(ElementId id);
+
+    /**
+     * @brief Whether ancestor is the element or one of its parents
+     */
+    bool isAncestor(ElementId ancestor, ElementId element) const;
+
+    ElementId getRoot() const
+    {
+        return root;
+    }
+
+    ElementId getConsole() const
+    {
+        return console;
+    }
+
+    /**
+     * @brief Set up registry layout, classes, globals and functions of a resource VM
+     */
+    void registerFunctions(lua_State *luaVm, ElementId resourceRoot);
+
+    /**
+     * @brief Push element userdata with its class metatable (nil, if the element does not exist)
+     */
+    void pushElement(lua_State *luaVm, ElementId id);
+
+    /**
+     * @brief Element of the userdata at the stack index
+     * @return 0, if the value is not an existing element
+     */
+    ElementId toElement(lua_State *luaVm, int index);
+
+    /**
+     * @brief Call handlers of the event attached to the source or its parents
+     * @return Called handlers amount
+     */
+    size_t triggerEvent(const std::string &name, ElementId source);
+
+    /**
+     * @brief Call command handlers with (console, command, arguments...)
+     * @return Called handlers amount
+     */
+    size_t executeCommand(const std::string &command, const std::vector<std::string> &arguments);
+
+    /**
+     * @brief Call due timers (timers are elements, like on the server)
+     * @param tick Host tick count
+     * @return Called timers amount
+     */
+    size_t runTimers(unsigned long tick);
+
+    /**
+     * @brief Forget handlers and timers of the VM (before it is closed)
+     */
+    void removeHandlers(lua_State *luaVm);
+
+private:
+    /// Event or command handler
+    struct Handler
+    {
+        lua_State *luaVm;
+        std::string name;
+        ElementId element;                              ///< Attached element (events only)
+        int reference;                                  ///< Function registry reference
+    };
+
+    /// Timer of setTimer, handler element is the timer element
+    struct Timer
+    {
+        Handler handler;
+        int arguments;                                  ///< Arguments table registry reference
+        unsigned long interval;
+        unsigned long due;                              ///< Tick of the next call
+        unsigned long remaining;                        ///< Calls left (0 is infinite)
+    };
+
+    /**
+     * @brief Lua class name of the element type
+     */
+    static const char *getClassName(const std::string &type);
+
+    static HostElements &self(lua_State *luaVm);
+
+    static ElementId checkElement(lua_State *luaVm, int index);
+
+    /**
+     * @brief Call handler function with arguments on top of the stack
+     */
+    void callHandler(const Handler &handler, int arguments);
+
+    /**
+     * @brief Forget the timer and free its references and element
+     */
+    void removeTimer(ElementId timer);
+
+    static int luaIprint(lua_State *luaVm);
+
+    static int luaOutputDebugString(lua_State *luaVm);
+
+    static int luaOutputServerLog(lua_State *luaVm);
+
+    static int luaGetTickCount(lua_State *luaVm);
+
+    static int luaSetTimer(lua_State *luaVm);
+
+    static int luaKillTimer(lua_State *luaVm);
+
+    static int luaAddEventHandler(lua_State *luaVm);
+
+    static int luaAddCommandHandler(lua_State *luaVm);
+
+    static int luaCreatePed(lua_State *luaVm);
+
+    static int luaPedCall(lua_State *luaVm);
+
+    static int luaIsElement(lua_State *luaVm);
+
+    static int luaDestroyElement(lua_State *luaVm);
+
+    static int luaGetElementType(lua_State *luaVm);
+
+    static int luaGetElementsByType(lua_State *luaVm);
+
+    static int luaGetElementPosition(lua_State *luaVm);
+
+    static int luaSetElementPosition(lua_State *luaVm);
+
+    static int luaGetElementDimension(lua_State *luaVm);
+
+    static int luaSetElementDimension(lua_State *luaVm);
+
+    static int luaGetRootElement(lua_State *luaVm);
+
+    static int luaGetResourceRootElement(lua_State *luaVm);
+
+    static int luaGetPosition(lua_State *luaVm);
+
+    static int luaElementIndex(lua_State *luaVm);
+
+    static int luaElementNewIndex(lua_State *luaVm);
+
+    static int luaElementToString(lua_State *luaVm);
+
+    ModuleHost &host;
+    std::unordered_map<ElementId, Element> elements;
+    ElementId nextId = 1;
+    ElementId root;
+    ElementId console;
+    std::vector<Handler> events;
+    std::vector<Handler> commands;
+    std::vector<Timer> timers;
+};
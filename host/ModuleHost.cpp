@@ -0,0 +1,407 @@
+#include "ModuleHost.h"
+#include <algorithm>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <dlfcn.h>
+#include <fstream>
+#include <regex>
+#include <sstream>
+
+namespace
+{
+
+char RESOURCE_KEY;                                  ///< Registry key of the resource pointer
+
+std::string format(const char *format, va_list arguments)
+{
+    char buffer[1024];
+    vsnprintf(buffer, sizeof(buffer), format, arguments);
+    return buffer;
+}
+
+}
+
+ModuleHost::ModuleHost()
+    : elements(*this), started(std::chrono::steady_clock::now())
+{}
+
+bool ModuleHost::loadModule(const std::string &path)
+{
+    library = dlopen(path.c_str(), RTLD_NOW);
+    if (!library) {
+        this->ErrorPrintf("Unable to load module %s: %s\n", path.c_str(), dlerror());
+        return false;
+    }
+
+    initModule = reinterpret_cast<InitModuleFunction>(dlsym(library, "InitModule"));
+    registerFunctions = reinterpret_cast<RegisterFunctionsFunction>(dlsym(library, "RegisterFunctions"));
+    doPulse = reinterpret_cast<DoPulseFunction>(dlsym(library, "DoPulse"));
+    resourceStopped = reinterpret_cast<ResourceStoppedFunction>(dlsym(library, "ResourceStopped"));
+    shutdownModule = reinterpret_cast<ShutdownModuleFunction>(dlsym(library, "ShutdownModule"));
+    if (!(initModule && registerFunctions && doPulse)) {
+        this->ErrorPrintf("Module %s has no InitModule, RegisterFunctions or DoPulse\n", path.c_str());
+        dlclose(library);
+        library = nullptr;
+        return false;
+    }
+
+    char name[MAX_INFO_LENGTH] = {};
+    char author[MAX_INFO_LENGTH] = {};
+    float version = 0;
+    if (!initModule(this, name, author, &version)) {
+        this->ErrorPrintf("Module %s has failed to initialize\n", path.c_str());
+        dlclose(library);
+        library = nullptr;
+        return false;
+    }
+
+    name[MAX_INFO_LENGTH - 1] = '\0';
+    author[MAX_INFO_LENGTH - 1] = '\0';
+    moduleName = name;
+    this->Printf("Module %s %.2f by %s loaded\n", name, version, author);
+    return true;
+}
+
+bool ModuleHost::startResource(const std::string &name, const std::string &directory, std::vector<std::string> scripts)
+{
+    if (scripts.empty() && !readMeta(directory, scripts)) {
+        this->ErrorPrintf("Unable to read %s/meta.xml\n", directory.c_str());
+        return false;
+    }
+
+    lua_State *luaVm = luaL_newstate();
+    if (!luaVm) {
+        this->ErrorPrintf("Unable to create lua state of %s\n", name.c_str());
+        return false;
+    }
+    luaL_openlibs(luaVm);
+
+    resources.push_back({name, directory, luaVm, elements.create("resource", elements.getRoot())});
+    Resource &resource = resources.back();
+
+    lua_pushlightuserdata(luaVm, &RESOURCE_KEY);
+    lua_pushlightuserdata(luaVm, &resource);
+    lua_rawset(luaVm, LUA_REGISTRYINDEX);
+
+    elements.registerFunctions(luaVm, resource.element);
+    if (registerFunctions) {
+        registerFunctions(luaVm);
+    }
+
+    for (const std::string &script : scripts) {
+        this->runScript(resource, script);
+    }
+
+    elements.triggerEvent("onResourceStart", resource.element);
+    return true;
+}
+
+void ModuleHost::stopResource(const std::string &name)
+{
+    auto found = std::find_if(
+        resources.begin(),
+        resources.end(),
+        [&name](const Resource &resource)
+        {
+            return resource.name == name;
+        }
+    );
+    if (found == resources.end()) {
+        return;
+    }
+
+    elements.triggerEvent("onResourceStop", found->element);
+    if (resourceStopped) {
+        resourceStopped(found->luaVm);
+    }
+
+    elements.removeHandlers(found->luaVm);
+    elements.destroy(found->element);
+    lua_close(found->luaVm);
+    resources.erase(found);
+}
+
+bool ModuleHost::executeCommand(const std::string &command)
+{
+    std::istringstream stream(command);
+    std::string name;
+    stream >> name;
+
+    std::vector<std::string> arguments;
+    std::string argument;
+    while (stream >> argument) {
+        arguments.push_back(argument);
+    }
+
+    if (elements.executeCommand(name, arguments) == 0) {
+        this->ErrorPrintf("Unknown command or cvar: %s\n", name.c_str());
+        return false;
+    }
+    return true;
+}
+
+void ModuleHost::pulse()
+{
+    // Results delivered by the module pulse are seen by timers of the same tick
+    if (doPulse) {
+        doPulse();
+    }
+    elements.runTimers(this->getTickCount());
+}
+
+void ModuleHost::unloadModule()
+{
+    while (!resources.empty()) {
+        this->stopResource(resources.front().name);
+    }
+
+    if (!library) {
+        return;
+    }
+    if (shutdownModule) {
+        shutdownModule();
+    }
+    dlclose(library);
+    library = nullptr;
+    initModule = nullptr;
+    registerFunctions = nullptr;
+    doPulse = nullptr;
+    resourceStopped = nullptr;
+    shutdownModule = nullptr;
+}
+
+bool ModuleHost::hasPrinted(const std::string &text) const
+{
+    for (const auto &pair : expected) {
+        if (pair.first == text) {
+            return pair.second;
+        }
+    }
+    return false;
+}
+
+unsigned long ModuleHost::getTickCount() const
+{
+    return static_cast<unsigned long>(
+        std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started).count()
+    );
+}
+
+void ModuleHost::output(int level, const std::string &message)
+{
+    static const char *prefixes[] = {"", "ERROR: ", "WARNING: ", "INFO: "};
+    const char *prefix = level >= 0 && level <= 3 ? prefixes[level] : "";
+    printf("%s%s\n", prefix, message.c_str());
+    fflush(stdout);
+
+    for (auto &pair : expected) {
+        if (!pair.second && message.find(pair.first) != std::string::npos) {
+            pair.second = true;
+        }
+    }
+}
+
+void ModuleHost::scriptError(const std::string &message)
+{
+    errors++;
+    this->output(1, message);
+}
+
+ModuleHost::Resource *ModuleHost::findResource(lua_State *luaVm)
+{
+    lua_pushlightuserdata(luaVm, &RESOURCE_KEY);
+    lua_rawget(luaVm, LUA_REGISTRYINDEX);
+    auto *pointer = static_cast<Resource *>(lua_touserdata(luaVm, -1));
+    lua_pop(luaVm, 1);
+
+    // The pointer is checked, any lua state can be passed by the module
+    for (Resource &resource : resources) {
+        if (&resource == pointer) {
+            return &resource;
+        }
+    }
+    return nullptr;
+}
+
+ModuleHost::~ModuleHost()
+{
+    this->unloadModule();
+}
+
+void ModuleHost::ErrorPrintf(const char *szFormat, ...)
+{
+    va_list arguments;
+    va_start(arguments, szFormat);
+    std::string message = format(szFormat, arguments);
+    va_end(arguments);
+
+    fprintf(stderr, "ERROR: %s", message.c_str());
+    fflush(stderr);
+}
+
+void ModuleHost::DebugPrintf(lua_State *luaVM, const char *szFormat, ...)
+{
+    va_list arguments;
+    va_start(arguments, szFormat);
+    std::string message = format(szFormat, arguments);
+    va_end(arguments);
+
+    Resource *resource = this->findResource(luaVM);
+    this->output(3, (resource ? resource->name + ": " : std::string()) + message);
+}
+
+void ModuleHost::Printf(const char *szFormat, ...)
+{
+    va_list arguments;
+    va_start(arguments, szFormat);
+    std::string message = format(szFormat, arguments);
+    va_end(arguments);
+
+    printf("%s", message.c_str());
+    fflush(stdout);
+}
+
+bool ModuleHost::RegisterFunction(lua_State *luaVM, const char *szFunctionName, lua_CFunction Func)
+{
+    if (!(luaVM && szFunctionName && Func)) {
+        return false;
+    }
+
+    lua_register(luaVM, szFunctionName, Func);
+    return true;
+}
+
+bool ModuleHost::GetResourceName(lua_State *luaVM, std::string &strName)
+{
+    Resource *resource = this->findResource(luaVM);
+    if (!resource) {
+        return false;
+    }
+
+    strName = resource->name;
+    return true;
+}
+
+CChecksum ModuleHost::GetResourceMetaChecksum(lua_State *)
+{
+    // Checksums are not emulated
+    return CChecksum{};
+}
+
+CChecksum ModuleHost::GetResourceFileChecksum(lua_State *, const char *)
+{
+    return CChecksum{};
+}
+
+unsigned long ModuleHost::GetVersion()
+{
+    return 0x0106;
+}
+
+const char *ModuleHost::GetVersionString()
+{
+    return "1.6";
+}
+
+const char *ModuleHost::GetVersionName()
+{
+    return "Module SDK host";
+}
+
+unsigned long ModuleHost::GetNetcodeVersion()
+{
+    return 0;
+}
+
+const char *ModuleHost::GetOperatingSystemName()
+{
+    return "GNU/Linux";
+}
+
+lua_State *ModuleHost::GetResourceFromName(const char *szResourceName)
+{
+    for (const Resource &resource : resources) {
+        if (resource.name == szResourceName) {
+            return resource.luaVm;
+        }
+    }
+    return nullptr;
+}
+
+bool ModuleHost::GetResourceName(lua_State *luaVM, char *szName, size_t length)
+{
+    Resource *resource = this->findResource(luaVM);
+    if (!resource || length == 0) {
+        return false;
+    }
+
+    strncpy(szName, resource->name.c_str(), length);
+    szName[length - 1] = '\0';
+    return true;
+}
+
+bool ModuleHost::GetResourceFilePath(lua_State *luaVM, const char *fileName, char *path, size_t length)
+{
+    Resource *resource = this->findResource(luaVM);
+    if (!resource || length == 0 || strstr(fileName, "..")) {
+        return false;
+    }
+
+    const std::string result = resource->directory + "/" + fileName;
+    if (result.size() >= length) {
+        return false;
+    }
+    strncpy(path, result.c_str(), length);
+    return true;
+}
+
+bool ModuleHost::readMeta(const std::string &directory, std::vector<std::string> &scripts)
+{
+    std::ifstream file(directory + "/meta.xml");
+    if (!file) {
+        return false;
+    }
+    std::stringstream content;
+    content << file.rdbuf();
+    const std::string meta = content.str();
+
+    // Not an XML parser: <script src="..." type="..."/> tags in order
+    static const std::regex scriptTag(R"(<script\s([^>]*)>)");
+    static const std::regex sourceAttribute(R"(src\s*=\s*"([^"]*)\")");
+    static const std::regex typeAttribute(R"(type\s*=\s*"([^"]*)\")");
+    for (auto it = std::sregex_iterator(meta.begin(), meta.end(), scriptTag); it != std::sregex_iterator(); ++it) {
+        const std::string attributes = (*it)[1];
+        std::smatch source;
+        std::smatch type;
+        if (!std::regex_search(attributes, source, sourceAttribute)) {
+            continue;
+        }
+        if (std::regex_search(attributes, type, typeAttribute) && type[1] == "client") {
+            continue;
+        }
+        scripts.push_back(source[1]);
+    }
+    return true;
+}
+
+void ModuleHost::runScript(Resource &resource, const std::string &script)
+{
+    std::ifstream file(resource.directory + "/" + script, std::ios::binary);
+    if (!file) {
+        this->scriptError("Unable to read " + resource.name + "/" + script);
+        return;
+    }
+    std::stringstream content;
+    content << file.rdbuf();
+    const std::string code = content.str();
+
+    const std::string chunkName = "@" + resource.name + "/" + script;
+    lua_State *luaVm = resource.luaVm;
+    if (luaL_loadbuffer(luaVm, code.data(), code.size(), chunkName.c_str()) != 0
+        || lua_pcall(luaVm, 0, 0, 0) != 0) {
+        const char *message = lua_tostring(luaVm, -1);
+        this->scriptError(message ? message : "Error object is not a string");
+        lua_pop(luaVm, 1);
+    }
+}
@@ -0,0 +1,189 @@
+#pragma once
+
+#include "HostElements.h"
+#include "lua/ILuaModuleManager.h"
+#include <chrono>
+#include <list>
+#include <string>
+#include <vector>
+
+
+/**
+ * @brief Standalone MTASA server emulation for one module and its resources
+ * @details Loads a module shared library and calls InitModule, RegisterFunctions, DoPulse, ResourceStopped
+ * and ShutdownModule the same way the server does. Resources are stock lua 5.1 states with the MTASA registry layout
+ * ("ud" cache of element userdata and "mt" class metatables) and a minimal set of MTASA functions (see HostElements).
+ * The host process exports lua, so ImportLua of the module resolves it from the process.
+ */
+class ModuleHost : public ILuaModuleManager10
+{
+public:
+    /// Running resource
+    struct Resource
+    {
+        std::string name;
+        std::string directory;
+        lua_State *luaVm;
+        HostElements::ElementId element;                ///< resourceRoot
+    };
+
+    ModuleHost();
+
+    ModuleHost(const ModuleHost &) = delete;
+
+    ModuleHost &operator=(const ModuleHost &) = delete;
+
+    /**
+     * @brief Load module and call InitModule
+     * @param path Module shared library path
+     * @return false, if the library or its entry points can't be loaded, or InitModule has failed
+     */
+    bool loadModule(const std::string &path);
+
+    /**
+     * @brief Create resource VM, register functions, run scripts and trigger onResourceStart
+     * @param name Resource name
+     * @param directory Resource directory (script paths and getResourceFilePath are relative to it)
+     * @param scripts Script paths (meta.xml server and shared scripts, if empty)
+     * @return false, if the VM can't be created or meta.xml can't be read. Script errors are printed and counted
+     */
+    bool startResource(const std::string &name, const std::string &directory, std::vector<std::string> scripts = {});
+
+    /**
+     * @brief Call ResourceStopped and close resource VM
+     */
+    void stopResource(const std::string &name);
+
+    /**
+     * @brief Call command handlers of all resources
+     * @param command Command name and space separated arguments
+     * @return false, if there is no handler
+     */
+    bool executeCommand(const std::string &command);
+
+    /**
+     * @brief Call DoPulse of the module
+     */
+    void pulse();
+
+    /**
+     * @brief Stop all resources and call ShutdownModule
+     */
+    void unloadModule();
+
+    /**
+     * @brief Script errors amount (load, runtime and event handler errors)
+     */
+    size_t getErrors() const
+    {
+        return errors;
+    }
+
+    /**
+     * @brief Whether output contained the text
+     */
+    bool hasPrinted(const std::string &text) const;
+
+    /**
+     * @brief Remember text to be found by hasPrinted
+     */
+    void expect(std::string text)
+    {
+        expected.push_back({std::move(text), false});
+    }
+
+    /**
+     * @brief Milliseconds since the host start (getTickCount)
+     */
+    unsigned long getTickCount() const;
+
+    /**
+     * @brief Print script output line
+     * @param level 0 custom, 1 error, 2 warning, 3 information (outputDebugString levels)
+     */
+    void output(int level, const std::string &message);
+
+    /**
+     * @brief Print and count script error
+     */
+    void scriptError(const std::string &message);
+
+    /**
+     * @brief Resource of the VM (including its threads)
+     * @return nullptr, if the VM is not a resource
+     */
+    Resource *findResource(lua_State *luaVm);
+
+    HostElements &getElements()
+    {
+        return elements;
+    }
+
+    ~ModuleHost();
+
+    // ILuaModuleManager
+
+    void ErrorPrintf(const char *szFormat, ...) override;
+
+    void DebugPrintf(lua_State *luaVM, const char *szFormat, ...) override;
+
+    void Printf(const char *szFormat, ...) override;
+
+    bool RegisterFunction(lua_State *luaVM, const char *szFunctionName, lua_CFunction Func) override;
+
+    bool GetResourceName(lua_State *luaVM, std::string &strName) override;
+
+    CChecksum GetResourceMetaChecksum(lua_State *luaVM) override;
+
+    CChecksum GetResourceFileChecksum(lua_State *luaVM, const char *szFile) override;
+
+    // ILuaModuleManager10
+
+    unsigned long GetVersion() override;
+
+    const char *GetVersionString() override;
+
+    const char *GetVersionName() override;
+
+    unsigned long GetNetcodeVersion() override;
+
+    const char *GetOperatingSystemName() override;
+
+    lua_State *GetResourceFromName(const char *szResourceName) override;
+
+    bool GetResourceName(lua_State *luaVM, char *szName, size_t length) override;
+
+    bool GetResourceFilePath(lua_State *luaVM, const char *fileName, char *path, size_t length) override;
+
+private:
+    using InitModuleFunction = bool (*)(ILuaModuleManager10 *, char *, char *, float *);
+    using RegisterFunctionsFunction = void (*)(lua_State *);
+    using DoPulseFunction = bool (*)();
+    using ResourceStoppedFunction = void (*)(lua_State *);
+    using ShutdownModuleFunction = bool (*)();
+
+    /**
+     * @brief Read server and shared script paths from meta.xml
+     * @return false, if the file can't be read
+     */
+    static bool readMeta(const std::string &directory, std::vector<std::string> &scripts);
+
+    /**
+     * @brief Load and call script file
+     */
+    void runScript(Resource &resource, const std::string &script);
+
+    void *library = nullptr;
+    InitModuleFunction initModule = nullptr;
+    RegisterFunctionsFunction registerFunctions = nullptr;
+    DoPulseFunction doPulse = nullptr;
+    ResourceStoppedFunction resourceStopped = nullptr;
+    ShutdownModuleFunction shutdownModule = nullptr;
+    std::string moduleName;
+
+    HostElements elements;
+    std::list<Resource> resources;                      ///< Stable addresses (stored in VM registries)
+    std::chrono::steady_clock::time_point started;
+    size_t errors = 0;
+    std::vector<std::pair<std::string, bool>> expected; ///< Text and whether it has been printed
+};
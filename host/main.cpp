@@ -0,0 +1,109 @@
+#include "ModuleHost.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+namespace
+{
+
+void printUsage(const char *program)
+{
+    printf(
+        "Usage: %s <module> <resource directory> [options]\n"
+        "  --script <path>     Run the script instead of meta.xml scripts (repeatable)\n"
+        "  --command <text>    Execute console command after the start (repeatable)\n"
+        "  --duration <ms>     Pulse the module for the time after the start (default 3000)\n"
+        "  --interval <ms>     Time between pulses (default 10)\n"
+        "  --expect <text>     Fail, unless the output contains the text (repeatable)\n",
+        program
+    );
+}
+
+std::string getResourceName(std::string directory)
+{
+    while (directory.size() > 1 && directory.back() == '/') {
+        directory.pop_back();
+    }
+    const size_t slash = directory.rfind('/');
+    return slash == std::string::npos ? directory : directory.substr(slash + 1);
+}
+
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 3) {
+        printUsage(argv[0]);
+        return 2;
+    }
+
+    const std::string module = argv[1];
+    const std::string directory = argv[2];
+    std::vector<std::string> scripts;
+    std::vector<std::string> commands;
+    std::vector<std::string> expected;
+    long duration = 3000;
+    long interval = 10;
+    for (int i = 3; i < argc; i++) {
+        if (i + 1 >= argc) {
+            printUsage(argv[0]);
+            return 2;
+        }
+
+        const char *option = argv[i];
+        const char *value = argv[++i];
+        if (strcmp(option, "--script") == 0) {
+            scripts.emplace_back(value);
+        } else if (strcmp(option, "--command") == 0) {
+            commands.emplace_back(value);
+        } else if (strcmp(option, "--duration") == 0) {
+            duration = strtol(value, nullptr, 10);
+        } else if (strcmp(option, "--interval") == 0) {
+            interval = strtol(value, nullptr, 10);
+        } else if (strcmp(option, "--expect") == 0) {
+            expected.emplace_back(value);
+        } else {
+            printUsage(argv[0]);
+            return 2;
+        }
+    }
+
+    ModuleHost host;
+    for (const std::string &text : expected) {
+        host.expect(text);
+    }
+
+    if (!host.loadModule(module)) {
+        return 1;
+    }
+    const std::string resource = getResourceName(directory);
+    if (!host.startResource(resource, directory, scripts)) {
+        return 1;
+    }
+    for (const std::string &command : commands) {
+        host.executeCommand(command);
+    }
+
+    // The server pulses modules from its main loop
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(duration);
+    do {
+        host.pulse();
+        std::this_thread::sleep_for(std::chrono::milliseconds(interval));
+    } while (std::chrono::steady_clock::now() < deadline);
+
+    host.unloadModule();
+
+    bool success = host.getErrors() == 0;
+    for (const std::string &text : expected) {
+        if (!host.hasPrinted(text)) {
+            fprintf(stderr, "Output does not contain: %s\n", text.c_str());
+            success = false;
+        }
+    }
+    if (host.getErrors()) {
+        fprintf(stderr, "Script errors: %zu\n", host.getErrors());
+    }
+    return success ? 0 : 1;
+}
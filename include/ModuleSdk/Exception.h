@@ -17,8 +17,25 @@ static const std::unordered_map<LuaArgumentType, std::string> STRING_TYPE = {
     {LuaArgumentType::LuaTypeObject, "Object"},
     {LuaArgumentType::LuaTypeTableList, "Table list"},
     {LuaArgumentType::LuaTypeTableMap, "Table map"},
+    {LuaArgumentType::LuaTypeDoubleArray, "Double array"},
+    {LuaArgumentType::LuaTypeFloatArray, "Float array"},
+    {LuaArgumentType::LuaTypeInt32Array, "Int32 array"},
 };      ///< Readable type names
 
+/**
+ * @brief Readable type name getter
+ * @param type Argument type (or lua type code)
+ * @return Type name, or type code if name is unknown
+ */
+inline std::string getTypeName(LuaArgumentType type)
+{
+    auto it = STRING_TYPE.find(type);
+    if (it == STRING_TYPE.end()) {
+        return "type code " + std::to_string(static_cast<int>(type));
+    }
+    return it->second;
+}
+
 /**
  * @brief Base Lua exception
  */
@@ -72,7 +89,7 @@ public:
     void setMessage(const std::string &newMessage) noexcept
     {
         destroy();
-        this->message = new char[newMessage.size()];
+        this->message = new char[newMessage.size() + 1];
         std::strcpy(this->message, newMessage.c_str());
     }
 
@@ -133,21 +150,21 @@ public:
     explicit LuaUnexpectedType(LuaArgumentType expectedType)
     {
         this->setMessage(
-            "Expected " + STRING_TYPE.at(expectedType)
+            "Expected " + getTypeName(expectedType)
         );
     }
 
     LuaUnexpectedType(LuaArgumentType expectedType, LuaArgumentType receivedType)
     {
         this->setMessage(
-            "Expected " + STRING_TYPE.at(expectedType) + ", got " + STRING_TYPE.at(receivedType)
+            "Expected " + getTypeName(expectedType) + ", got " + getTypeName(receivedType)
         );
     }
 
     LuaUnexpectedType(LuaArgumentType expectedType, LuaArgumentType receivedType, int index)
     {
         this->setMessage(
-            "Expected " + STRING_TYPE.at(expectedType) + ", got " + STRING_TYPE.at(receivedType)
+            "Expected " + getTypeName(expectedType) + ", got " + getTypeName(receivedType)
                 + " at argument " + std::to_string(index)
         );
     }
@@ -174,7 +191,7 @@ public:
     explicit LuaUnexpectedPushType(LuaArgumentType receivedType)
     {
         this->setMessage(
-            "Got unexpected type " + STRING_TYPE.at(receivedType)
+            "Got unexpected type " + getTypeName(receivedType)
         );
     }
 
@@ -222,6 +239,117 @@ public:
     }
 };
 
+/**
+ * @brief Parse limit (depth, nodes amount or stack size) has been exceeded
+ */
+class LuaParseLimitExceeded: public LuaException
+{
+private:
+    const char *messageDefault = "Parse limit exceeded";
+
+public:
+    using LuaException::LuaException;
+
+    explicit LuaParseLimitExceeded(const std::string &message)
+    {
+        this->setMessage(message);
+    }
+
+    const char *getMessageDefault() const override
+    {
+        return this->messageDefault;
+    }
+};
+
+/**
+ * @brief Table references itself (directly or through nested tables)
+ */
+class LuaTableCycle: public LuaException
+{
+private:
+    const char *messageDefault = "Table cycle detected";
+
+public:
+    using LuaException::LuaException;
+
+    const char *getMessageDefault() const override
+    {
+        return this->messageDefault;
+    }
+};
+
+/**
+ * @brief Async operation failed or async function can't suspend
+ */
+class LuaAsyncException: public LuaException
+{
+private:
+    const char *messageDefault = "Async operation failed";
+
+public:
+    using LuaException::LuaException;
+
+    explicit LuaAsyncException(const std::string &message)
+    {
+        this->setMessage(message);
+    }
+
+    const char *getMessageDefault() const override
+    {
+        return this->messageDefault;
+    }
+};
+
+/**
+ * @brief Table does not match schema
+ */
+class LuaSchemaMismatch: public LuaException
+{
+private:
+    const char *messageDefault = "Schema mismatch";
+    std::string path;
+
+public:
+    using LuaException::LuaException;
+
+    /**
+     * @brief Missing field constructor
+     * @param path Field path
+     */
+    explicit LuaSchemaMismatch(std::string path)
+        : path(std::move(path))
+    {
+        this->setMessage("Missing field " + this->path);
+    }
+
+    /**
+     * @brief Type mismatch constructor
+     * @param path Field path
+     * @param expectedType Schema type
+     * @param receivedType Captured type
+     */
+    LuaSchemaMismatch(std::string path, LuaArgumentType expectedType, LuaArgumentType receivedType)
+        : path(std::move(path))
+    {
+        this->setMessage(
+            "Expected " + getTypeName(expectedType) + " at " + this->path + ", got " + getTypeName(receivedType)
+        );
+    }
+
+    /**
+     * @brief Failed field path (e.g. items[3].price)
+     */
+    const std::string &getPath() const
+    {
+        return path;
+    }
+
+    const char *getMessageDefault() const override
+    {
+        return this->messageDefault;
+    }
+};
+
 /**
  * @brief Base exception for LuaArgument
  */
@@ -245,7 +373,7 @@ public:
 
     explicit LuaUnexpectedArgumentType(LuaArgumentType expectedType, LuaArgumentType receivedType)
     {
-        this->setMessage("Expected " + STRING_TYPE.at(expectedType) + ", got " + STRING_TYPE.at(receivedType));
+        this->setMessage("Expected " + getTypeName(expectedType) + ", got " + getTypeName(receivedType));
     }
 
     ~LuaUnexpectedArgumentType() override = default;
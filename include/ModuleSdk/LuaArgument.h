@@ -2,8 +2,11 @@
 
 #include "Exception.h"
 #include "LuaArgumentType.h"
+#include "LuaCounters.h"
 #include "LuaObject.h"
 #include "lua/lua.h"
+#include <atomic>
+#include <cstdint>
 #include <string>
 #include <unordered_map>
 #include <utility>
@@ -13,13 +16,30 @@
 #define LUA_VM_ARGUMENT_GET_FUNCTION(templateType, check, typeName) \
 templateType to##typeName() const    \
 {                       \
-    if (this->type != (check)) {  \
-        throw LuaUnexpectedArgumentType(check, this->type); \
+    if (this->getType() != (check)) {  \
+        throw LuaUnexpectedArgumentType(check, this->getType()); \
     }
 
 
 class LuaArgument;
 
+/// Nil payload for LuaArgument::visit
+struct LuaNil
+{
+};
+
+/// Userdata payload for LuaArgument::visit
+struct LuaUserdata
+{
+    void *pointer;
+};
+
+/// Lightuserdata payload for LuaArgument::visit
+struct LuaLightUserdata
+{
+    void *pointer;
+};
+
 /**
  * @brief Provides hash functional for LuaArgument
  */
@@ -31,15 +51,22 @@ public:
 
 /**
  * @brief Lua dynamic type object
+ * @details Scalars are stored inline, other values are allocated.
+ * Type-dependent operations are dispatched by dense type index (see LuaTypeIndex)
  */
-class LuaArgument
+class LuaArgument final
 {
     friend LuaArgumentHash;
+    friend struct LuaArgumentOperations;
+    friend class LuaStringPool;
     friend bool operator==(const LuaArgument &, const LuaArgument &);
 
 public:
     using TableListType = std::vector<LuaArgument>;
     using TableMapType = std::unordered_map<LuaArgument, LuaArgument, LuaArgumentHash>;
+    using DoubleArrayType = std::vector<double>;
+    using FloatArrayType = std::vector<float>;
+    using Int32ArrayType = std::vector<int32_t>;
 
     /**
      * @brief Nil constructor
@@ -51,32 +78,45 @@ public:
      * @param value Initial boolean
      */
     LuaArgument(bool valueBool)
-        : value(new bool(valueBool)), type(LuaArgumentType::LuaTypeBoolean)
-    {}
+        : index(LuaTypeIndex::Boolean)
+    {
+        storage.boolean = valueBool;
+    }
 
     /**
      * @brief Number constructor
      * @param value Initial double
      */
     LuaArgument(double valueDouble)
-        : value(new double(valueDouble)), type(LuaArgumentType::LuaTypeNumber)
-    {}
+        : index(LuaTypeIndex::Number)
+    {
+        storage.number = valueDouble;
+    }
 
     /**
      * @brief String constructor
      * @param value Initial string
      */
     LuaArgument(std::string valueString)
-        : value(new std::string(std::move(valueString))), type(LuaArgumentType::LuaTypeString)
-    {}
+        : index(LuaTypeIndex::String)
+    {
+        LUA_COUNTERS_ADD(allocations, 1);
+        LUA_COUNTERS_ADD(bytesCopied, valueString.size());
+        storage.pointer = new SharedString(std::move(valueString));
+    }
 
     /**
      * @brief const char * constructor
      * @param value C-style string
      */
     LuaArgument(const char *valueStringC)
-        : value(new std::string(valueStringC)), type(LuaArgumentType::LuaTypeString)
-    {}
+        : index(LuaTypeIndex::String)
+    {
+        auto *shared = new SharedString(valueStringC);
+        LUA_COUNTERS_ADD(allocations, 1);
+        LUA_COUNTERS_ADD(bytesCopied, shared->value.size());
+        storage.pointer = shared;
+    }
 
     /// Constructor pointer meaning
     enum PointerType
@@ -91,46 +131,91 @@ public:
      * @param type Pointer meaning
      */
     LuaArgument(void *valuePointer, PointerType type = PointerUserdata)
-        : value(valuePointer), type(static_cast<LuaArgumentType>(type))
-    {}
+        : index(type == PointerUserdata ? LuaTypeIndex::Userdata : LuaTypeIndex::LightUserdata)
+    {
+        storage.pointer = valuePointer;
+    }
 
     /**
      * @brief Integer constructor
      * @param value Initial int
      */
     LuaArgument(int valueInt)
-        : value(new int(valueInt)), type(LuaArgumentType::LuaTypeInteger)
-    {}
+        : index(LuaTypeIndex::Integer)
+    {
+        storage.integer = valueInt;
+    }
 
     /**
      * @brief MTASA Object (userdata special case) constructor
      * @param value Initial LuaObject
      */
     LuaArgument(LuaObject valueObject)
-        : value(new LuaObject(std::move(valueObject))), type(LuaArgumentType::LuaTypeObject)
-    {}
+        : index(LuaTypeIndex::Object)
+    {
+        LUA_COUNTERS_ADD(allocations, 1);
+        storage.pointer = new LuaObject(std::move(valueObject));
+    }
 
     /**
      * @brief List (table special case) constructor
      * @param value Initial vector of LuaArgument
      */
     LuaArgument(TableListType valueList)
-        : value(new TableListType(std::move(valueList))), type(LuaArgumentType::LuaTypeTableList)
-    {}
+        : index(LuaTypeIndex::TableList)
+    {
+        LUA_COUNTERS_ADD(allocations, 1);
+        storage.pointer = new SharedTable<TableListType>(std::move(valueList));
+    }
 
     /**
      * @brief Map (table special case) constructor
      * @param value Initial map of LuaArgument
      */
     LuaArgument(TableMapType valueMap)
-        : value(new TableMapType(std::move(valueMap))), type(LuaArgumentType::LuaTypeTableMap)
-    {}
+        : index(LuaTypeIndex::TableMap)
+    {
+        LUA_COUNTERS_ADD(allocations, 1);
+        storage.pointer = new SharedTable<TableMapType>(std::move(valueMap));
+    }
+
+    /**
+     * @brief Typed array (sequence of numbers) constructor
+     * @param value Initial elements
+     */
+    LuaArgument(DoubleArrayType valueArray)
+        : index(LuaTypeIndex::DoubleArray)
+    {
+        LUA_COUNTERS_ADD(allocations, 1);
+        storage.pointer = new SharedTable<DoubleArrayType>(std::move(valueArray));
+    }
+
+    /**
+     * @brief Typed array (sequence of numbers) constructor
+     * @param value Initial elements
+     */
+    LuaArgument(FloatArrayType valueArray)
+        : index(LuaTypeIndex::FloatArray)
+    {
+        LUA_COUNTERS_ADD(allocations, 1);
+        storage.pointer = new SharedTable<FloatArrayType>(std::move(valueArray));
+    }
+
+    /**
+     * @brief Typed array (sequence of numbers) constructor
+     * @param value Initial elements
+     */
+    LuaArgument(Int32ArrayType valueArray)
+        : index(LuaTypeIndex::Int32Array)
+    {
+        LUA_COUNTERS_ADD(allocations, 1);
+        storage.pointer = new SharedTable<Int32ArrayType>(std::move(valueArray));
+    }
 
     /**
      * @brief Copy constructor
      */
     LuaArgument(const LuaArgument &argument)
-        : type(argument.type)
     {
         this->copy(argument);
     }
@@ -148,6 +233,10 @@ public:
      */
     LuaArgument &operator=(const LuaArgument &argument)
     {
+        if (this == &argument) {
+            return *this;
+        }
+
         this->destroy();
         this->copy(argument);
 
@@ -168,7 +257,7 @@ public:
      * @return Result
      */
     LUA_VM_ARGUMENT_GET_FUNCTION(bool &, LuaArgumentType::LuaTypeBoolean, Bool)
-        return *reinterpret_cast<bool *>(this->value);
+        return storage.boolean;
     }
 
     /**
@@ -177,7 +266,7 @@ public:
      * @return Result
      */
     LUA_VM_ARGUMENT_GET_FUNCTION(double &, LuaArgumentType::LuaTypeNumber, Number)
-        return *reinterpret_cast<double *>(this->value);
+        return storage.number;
     }
 
     /**
@@ -186,16 +275,16 @@ public:
      * @return Result
      */
     LUA_VM_ARGUMENT_GET_FUNCTION(int &, LuaArgumentType::LuaTypeInteger, Integer)
-        return *reinterpret_cast<int *>(this->value);
+        return storage.integer;
     }
 
     /**
-     * @brief String getter
+     * @brief String getter (strings are immutable and shared between copies)
      * @throws LuaUnexpectedArgumentType Type mismatch
      * @return Result
      */
-    LUA_VM_ARGUMENT_GET_FUNCTION(std::string &, LuaArgumentType::LuaTypeString, String)
-        return *reinterpret_cast<std::string *>(this->value);
+    LUA_VM_ARGUMENT_GET_FUNCTION(const std::string &, LuaArgumentType::LuaTypeString, String)
+        return reinterpret_cast<SharedString *>(storage.pointer)->value;
     }
 
     /**
@@ -204,12 +293,39 @@ public:
      * @return Result
      */
     LUA_VM_ARGUMENT_GET_FUNCTION(LuaObject &, LuaArgumentType::LuaTypeObject, Object)
-        return *reinterpret_cast<LuaObject *>(this->value);
+        return *reinterpret_cast<LuaObject *>(storage.pointer);
+    }
+
+    /**
+     * @brief Typed array getter
+     * @throws LuaUnexpectedArgumentType Type mismatch
+     * @return Result
+     */
+    LUA_VM_ARGUMENT_GET_FUNCTION(const DoubleArrayType &, LuaArgumentType::LuaTypeDoubleArray, DoubleArray)
+        return this->getTable<DoubleArrayType>();
+    }
+
+    /**
+     * @brief Typed array getter
+     * @throws LuaUnexpectedArgumentType Type mismatch
+     * @return Result
+     */
+    LUA_VM_ARGUMENT_GET_FUNCTION(const FloatArrayType &, LuaArgumentType::LuaTypeFloatArray, FloatArray)
+        return this->getTable<FloatArrayType>();
+    }
+
+    /**
+     * @brief Typed array getter
+     * @throws LuaUnexpectedArgumentType Type mismatch
+     * @return Result
+     */
+    LUA_VM_ARGUMENT_GET_FUNCTION(const Int32ArrayType &, LuaArgumentType::LuaTypeInt32Array, Int32Array)
+        return this->getTable<Int32ArrayType>();
     }
 
     /**
      * @brief Map getter
-     * @throws LuaUnexpectedArgumentType Type mismatch (expected TABLE_MAP or TABLE_LIST)
+     * @throws LuaUnexpectedArgumentType Type mismatch (expected TABLE_MAP, TABLE_LIST or typed array)
      * @return Result
      */
     TableMapType toMap() const;
@@ -222,6 +338,32 @@ public:
      */
     TableListType toList() const;
 
+    /**
+     * @brief List getter without transformation
+     * @throws LuaUnexpectedArgumentType Type mismatch (expected TABLE_LIST)
+     * @return Shared list reference
+     */
+    const TableListType &getList() const
+    {
+        if (this->index != LuaTypeIndex::TableList) {
+            throw LuaUnexpectedArgumentType(LuaArgumentType::LuaTypeTableList, this->getType());
+        }
+        return this->getTable<TableListType>();
+    }
+
+    /**
+     * @brief Map getter without transformation
+     * @throws LuaUnexpectedArgumentType Type mismatch (expected TABLE_MAP)
+     * @return Shared map reference
+     */
+    const TableMapType &getMap() const
+    {
+        if (this->index != LuaTypeIndex::TableMap) {
+            throw LuaUnexpectedArgumentType(LuaArgumentType::LuaTypeTableMap, this->getType());
+        }
+        return this->getTable<TableMapType>();
+    }
+
     /**
      * @brief Pointer getter
      * @throws LuaUnexpectedArgumentType Type mismatch (expected USERDATA or LIGHTUSERDATA)
@@ -235,7 +377,7 @@ public:
      */
     bool isNil() const
     {
-        return this->type == LuaArgumentType::LuaTypeNil;
+        return this->index == LuaTypeIndex::Nil;
     }
 
     /**
@@ -252,24 +394,148 @@ public:
      */
     LuaArgumentType getType() const
     {
-        return type;
+        return TYPE_BY_INDEX[static_cast<int>(index)];
+    }
+
+    /**
+     * @brief Dense type index getter
+     * @return Object's type index
+     */
+    LuaTypeIndex getTypeIndex() const
+    {
+        return index;
+    }
+
+    /**
+     * @brief Call visitor with typed value
+     * @details Visitor is called with one of: LuaNil, bool, double, int, const std::string &,
+     * LuaLightUserdata, LuaUserdata, const LuaObject &, const TableListType &, const TableMapType &,
+     * const DoubleArrayType &, const FloatArrayType &, const Int32ArrayType &.
+     * All overloads must return the same type.
+     * @param visitor Callable object (e.g. generic lambda)
+     * @return Visitor result
+     */
+    template<typename Visitor>
+    auto visit(Visitor &&visitor) const -> decltype(visitor(LuaNil{}))
+    {
+        switch (index) {
+            case LuaTypeIndex::Boolean:
+                return visitor(static_cast<bool>(storage.boolean));
+            case LuaTypeIndex::LightUserdata:
+                return visitor(LuaLightUserdata{storage.pointer});
+            case LuaTypeIndex::Number:
+                return visitor(static_cast<double>(storage.number));
+            case LuaTypeIndex::String:
+                return visitor(static_cast<const std::string &>(reinterpret_cast<SharedString *>(storage.pointer)->value));
+            case LuaTypeIndex::Userdata:
+                return visitor(LuaUserdata{storage.pointer});
+            case LuaTypeIndex::TableMap:
+                return visitor(static_cast<const TableMapType &>(this->getTable<TableMapType>()));
+            case LuaTypeIndex::Integer:
+                return visitor(static_cast<int>(storage.integer));
+            case LuaTypeIndex::Object:
+                return visitor(static_cast<const LuaObject &>(*reinterpret_cast<LuaObject *>(storage.pointer)));
+            case LuaTypeIndex::TableList:
+                return visitor(static_cast<const TableListType &>(this->getTable<TableListType>()));
+            case LuaTypeIndex::DoubleArray:
+                return visitor(static_cast<const DoubleArrayType &>(this->getTable<DoubleArrayType>()));
+            case LuaTypeIndex::FloatArray:
+                return visitor(static_cast<const FloatArrayType &>(this->getTable<FloatArrayType>()));
+            case LuaTypeIndex::Int32Array:
+                return visitor(static_cast<const Int32ArrayType &>(this->getTable<Int32ArrayType>()));
+            default:
+                return visitor(LuaNil{});
+        }
     }
 
     /**
      * @brief Destructor
      */
-    virtual ~LuaArgument()
+    ~LuaArgument()
     {
         this->destroy();
     }
 
 private:
-    virtual void move(LuaArgument &&argument) noexcept;
-    virtual void copy(const LuaArgument &argument);
-    virtual void destroy() noexcept;
+    /**
+     * @brief Reference counted table storage
+     * @details Table contents are never modified after construction, so copies share the storage
+     */
+    template<typename T>
+    struct SharedTable
+    {
+        explicit SharedTable(T table)
+            : table(std::move(table))
+        {}
+
+        std::atomic<size_t> references{1};            ///< Owners amount
+        T table;                                        ///< Table contents
+    };
+
+    /**
+     * @brief Shared table contents getter (type must be checked before)
+     */
+    template<typename T>
+    T &getTable() const
+    {
+        return reinterpret_cast<SharedTable<T> *>(storage.pointer)->table;
+    }
+
+    /// Refcounted immutable string with precomputed hash
+    struct SharedString
+    {
+        explicit SharedString(std::string value)
+            : hash(hashString(value.data(), value.size())), value(std::move(value))
+        {}
+
+        SharedString(std::string value, size_t hash)
+            : hash(hash), value(std::move(value))
+        {}
+
+        std::atomic<size_t> references{1};          ///< Owners amount
+        size_t hash;                                ///< Contents hash
+        std::string value;
+    };
+
+    /**
+     * @brief String contents hash (FNV-1a)
+     */
+    static size_t hashString(const char *data, size_t length)
+    {
+        size_t hash = static_cast<size_t>(14695981039346656037ull);
+        for (size_t i = 0; i < length; i++) {
+            hash = (hash ^ static_cast<unsigned char>(data[i])) * static_cast<size_t>(1099511628211ull);
+        }
+        return hash;
+    }
+
+    /// Value storage
+    union Storage
+    {
+        void *pointer;                                  ///< Allocated value or userdata pointer
+        bool boolean;
+        double number;
+        int integer;
+    };
+
+    /// Type-dependent operations (one entry per LuaTypeIndex)
+    struct Operations
+    {
+        void (*copy)(Storage &destination, const Storage &source);
+        void (*destroy)(Storage &storage);
+        bool (*equal)(const Storage &left, const Storage &right);
+        size_t (*hash)(const Storage &storage);
+    };
+
+    static const Operations OPERATIONS[static_cast<int>(LuaTypeIndex::Count)];    ///< Jump table
+
+    void move(LuaArgument &&argument) noexcept;
+    void copy(const LuaArgument &argument);
+    void destroy() noexcept;
 
-    void *value = nullptr;                                ///< Pointer to allocated value (unknown type)
-    LuaArgumentType type = LuaArgumentType::LuaTypeNil;                    ///< Object's type
+    /// Getters return references from const methods, so storage is mutable
+    mutable Storage storage{nullptr};
+    LuaTypeIndex index = LuaTypeIndex::Nil;                 ///< Object's type index
 };
 
 bool operator==(const LuaArgument &left, const LuaArgument &right);
@@ -18,4 +18,82 @@ enum class LuaArgumentType
     LuaTypeInteger = 1001,
     LuaTypeObject = 1002,
     LuaTypeTableList = 1003,
-};
\ No newline at end of file
+    LuaTypeDoubleArray = 1004,          ///< Sequence of numbers stored as std::vector<double>
+    LuaTypeFloatArray = 1005,           ///< Sequence of numbers stored as std::vector<float>
+    LuaTypeInt32Array = 1006,           ///< Sequence of numbers stored as std::vector<int32_t>
+};
+
+/// Dense LuaArgumentType index (for jump tables)
+enum class LuaTypeIndex : unsigned char
+{
+    Nil,
+    Boolean,
+    LightUserdata,
+    Number,
+    String,
+    Userdata,
+    TableMap,
+    Integer,
+    Object,
+    TableList,
+    DoubleArray,
+    FloatArray,
+    Int32Array,
+
+    Count,              ///< Types amount
+};
+
+/// LuaArgumentType by dense index
+static constexpr LuaArgumentType TYPE_BY_INDEX[static_cast<int>(LuaTypeIndex::Count)] = {
+    LuaArgumentType::LuaTypeNil,
+    LuaArgumentType::LuaTypeBoolean,
+    LuaArgumentType::LuaTypeLightUserdata,
+    LuaArgumentType::LuaTypeNumber,
+    LuaArgumentType::LuaTypeString,
+    LuaArgumentType::LuaTypeUserdata,
+    LuaArgumentType::LuaTypeTableMap,
+    LuaArgumentType::LuaTypeInteger,
+    LuaArgumentType::LuaTypeObject,
+    LuaArgumentType::LuaTypeTableList,
+    LuaArgumentType::LuaTypeDoubleArray,
+    LuaArgumentType::LuaTypeFloatArray,
+    LuaArgumentType::LuaTypeInt32Array,
+};
+
+/**
+ * @brief Dense index getter
+ * @param type Argument type
+ * @return Dense index (LuaTypeIndex::Count for unknown types)
+ */
+inline LuaTypeIndex getTypeIndex(LuaArgumentType type)
+{
+    switch (type) {
+        case LuaArgumentType::LuaTypeNil:
+            return LuaTypeIndex::Nil;
+        case LuaArgumentType::LuaTypeBoolean:
+            return LuaTypeIndex::Boolean;
+        case LuaArgumentType::LuaTypeLightUserdata:
+            return LuaTypeIndex::LightUserdata;
+        case LuaArgumentType::LuaTypeNumber:
+            return LuaTypeIndex::Number;
+        case LuaArgumentType::LuaTypeString:
+            return LuaTypeIndex::String;
+        case LuaArgumentType::LuaTypeUserdata:
+            return LuaTypeIndex::Userdata;
+        case LuaArgumentType::LuaTypeTableMap:
+            return LuaTypeIndex::TableMap;
+        case LuaArgumentType::LuaTypeInteger:
+            return LuaTypeIndex::Integer;
+        case LuaArgumentType::LuaTypeObject:
+            return LuaTypeIndex::Object;
+        case LuaArgumentType::LuaTypeTableList:
+            return LuaTypeIndex::TableList;
+        case LuaArgumentType::LuaTypeDoubleArray:
+            return LuaTypeIndex::DoubleArray;
+        case LuaArgumentType::LuaTypeFloatArray:
+            return LuaTypeIndex::FloatArray;
+        case LuaArgumentType::LuaTypeInt32Array:
+            return LuaTypeIndex::Int32Array;
+    }
+    return LuaTypeIndex::Count;
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+
+/**
+ * @brief Lock-free multiple producers, single consumer queue
+ * @details Producers push with one CAS, the consumer takes the whole queue with one exchange.
+ * Used to hand results from worker threads to the main thread (see LuaTaskPool)
+ * @tparam T Value type
+ */
+template<typename T>
+class LuaCompletionQueue
+{
+public:
+    LuaCompletionQueue() = default;
+
+    LuaCompletionQueue(const LuaCompletionQueue &) = delete;
+
+    LuaCompletionQueue &operator=(const LuaCompletionQueue &) = delete;
+
+    /**
+     * @brief Add value (any thread)
+     */
+    void push(T value)
+    {
+        Node *node = new Node{std::move(value), head.load(std::memory_order_relaxed)};
+        while (!head.compare_exchange_weak(node->next, node, std::memory_order_release, std::memory_order_relaxed)) {
+        }
+    }
+
+    /**
+     * @brief Take all values in push order (consumer thread only)
+     * @param consumer Callable with T & argument. If it throws, the rest of values are dropped
+     * @return Consumed values amount
+     */
+    template<typename F>
+    size_t drain(F &&consumer)
+    {
+        Node *node = head.exchange(nullptr, std::memory_order_acquire);
+
+        // Stack order is reversed
+        Node *ordered = nullptr;
+        while (node) {
+            Node *next = node->next;
+            node->next = ordered;
+            ordered = node;
+            node = next;
+        }
+
+        size_t count = 0;
+        try {
+            while (ordered) {
+                Node *next = ordered->next;
+                Node *current = ordered;
+                ordered = next;
+
+                consumer(current->value);
+                delete current;
+                count++;
+            }
+        } catch (...) {
+            destroy(ordered);
+            throw;
+        }
+        return count;
+    }
+
+    /**
+     * @brief Check, if there are no values (hint, producers may push concurrently)
+     */
+    bool empty() const
+    {
+        return head.load(std::memory_order_relaxed) == nullptr;
+    }
+
+    ~LuaCompletionQueue()
+    {
+        destroy(head.exchange(nullptr, std::memory_order_acquire));
+    }
+
+private:
+    /// Queued value
+    struct Node
+    {
+        T value;
+        Node *next;
+    };
+
+    static void destroy(Node *node)
+    {
+        while (node) {
+            Node *next = node->next;
+            delete node;
+            node = next;
+        }
+    }
+
+    std::atomic<Node *> head{nullptr};            ///< Last pushed value
+};
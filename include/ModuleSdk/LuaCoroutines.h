@@ -0,0 +1,294 @@
+#pragma once
+
+#if !defined(__cpp_impl_coroutine)
+#error "LuaCoroutines.h requires C++20 coroutines (configure with -DBUILD_COROUTINES=ON)"
+#endif
+
+#include "LuaArgument.h"
+#include "LuaCompletionQueue.h"
+#include "lua/lua.h"
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class LuaCoroutines;
+
+
+/**
+ * @brief Async module function (C++ coroutine), started by LuaCoroutines::call
+ * @details co_return the lua results, lua gets true, results. Exceptions are returned to lua as false, error message
+ */
+class LuaAsync
+{
+public:
+    struct promise_type
+    {
+        LuaCoroutines *owner = nullptr;             ///< Manager, which resumes the task
+        uint64_t id = 0;                            ///< Task ID
+        std::vector<LuaArgument> results;
+        std::exception_ptr exception;
+
+        LuaAsync get_return_object()
+        {
+            return LuaAsync(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+
+        // Started by LuaCoroutines::call, which sets the owner
+        std::suspend_always initial_suspend() noexcept
+        {
+            return {};
+        }
+
+        // Kept for LuaCoroutines to read the results
+        std::suspend_always final_suspend() noexcept
+        {
+            return {};
+        }
+
+        void return_value(std::vector<LuaArgument> values)
+        {
+            results = std::move(values);
+        }
+
+        void unhandled_exception()
+        {
+            exception = std::current_exception();
+        }
+    };
+
+    LuaAsync(const LuaAsync &) = delete;
+
+    LuaAsync &operator=(const LuaAsync &) = delete;
+
+    LuaAsync(LuaAsync &&task) noexcept
+        : handle(task.handle)
+    {
+        task.handle = nullptr;
+    }
+
+    LuaAsync &operator=(LuaAsync &&task) noexcept
+    {
+        if (this != &task) {
+            this->destroy();
+            handle = task.handle;
+            task.handle = nullptr;
+        }
+        return *this;
+    }
+
+    ~LuaAsync()
+    {
+        this->destroy();
+    }
+
+private:
+    friend class LuaCoroutines;
+
+    explicit LuaAsync(std::coroutine_handle<promise_type> handle)
+        : handle(handle)
+    {}
+
+    void destroy()
+    {
+        if (handle) {
+            handle.destroy();
+            handle = nullptr;
+        }
+    }
+
+    std::coroutine_handle<promise_type> handle;
+};
+
+
+/**
+ * @brief Result of async operation, awaited by LuaAsync functions
+ * @details Settled once from any thread (I/O callback, worker thread, timer).
+ * Copies share the state. Awaiting task is resumed on LuaCoroutines::pulse.
+ * co_await returns the results or throws LuaAsyncException with the rejection message
+ */
+class LuaPromise
+{
+private:
+    struct State;
+
+public:
+    LuaPromise()
+        : state(std::make_shared<State>())
+    {}
+
+    /**
+     * @brief Resolve with results (any thread)
+     * @return false, if promise has been already settled
+     */
+    bool resolve(std::vector<LuaArgument> results)
+    {
+        return this->settle(true, std::move(results), {});
+    }
+
+    /**
+     * @brief Reject with error message (any thread)
+     * @return false, if promise has been already settled
+     */
+    bool reject(std::string error)
+    {
+        return this->settle(false, {}, std::move(error));
+    }
+
+    bool isSettled() const
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        return state->settled;
+    }
+
+    /// co_await support (await once)
+    class Awaiter
+    {
+    public:
+        explicit Awaiter(std::shared_ptr<LuaPromise::State> state)
+            : state(std::move(state))
+        {}
+
+        bool await_ready() const;
+
+        bool await_suspend(std::coroutine_handle<LuaAsync::promise_type> handle);
+
+        std::vector<LuaArgument> await_resume();
+
+    private:
+        std::shared_ptr<LuaPromise::State> state;
+    };
+
+    Awaiter operator co_await() const
+    {
+        return Awaiter(state);
+    }
+
+private:
+    /// Shared state
+    struct State
+    {
+        std::mutex mutex;                           ///< Protects all fields
+        bool settled = false;
+        bool success = false;
+        std::vector<LuaArgument> results;
+        std::string error;
+        LuaCoroutines *owner = nullptr;             ///< Waiting task manager
+        uint64_t waiter = 0;                        ///< Waiting task ID
+    };
+
+    bool settle(bool success, std::vector<LuaArgument> results, std::string error);
+
+    std::shared_ptr<State> state;
+};
+
+
+/**
+ * @brief Runs async module functions in lua coroutines
+ * @details A lua function returns call(luaVm, task). Results are returned at once, if the task finishes without suspension.
+ * Otherwise the calling lua coroutine is yielded and resumed with the results from pulse, after awaited promises are settled.
+ * Scripts see a blocking call, which returns true, results... or false, error message (like LuaTaskPool callbacks).
+ * The server thread never blocks.
+ * Async functions can't be called from the main thread (use coroutine.wrap) or through pcall.
+ * A coroutine is resumed only while it is still yielded by the call: a failed yield or a coroutine resumed
+ * by the script drops the task with an error.
+ * call, pulse and resourceStopped must be called from the main thread. The manager must outlive its promises.
+ */
+class LuaCoroutines
+{
+public:
+    using ErrorHandler = std::function<void(lua_State *luaVm, const std::string &message)>;
+
+    LuaCoroutines() = default;
+
+    LuaCoroutines(const LuaCoroutines &) = delete;
+
+    LuaCoroutines &operator=(const LuaCoroutines &) = delete;
+
+    /**
+     * @brief Start async function called from lua
+     * @param luaVm Calling lua coroutine
+     * @param task Async function result
+     * @return lua_CFunction return value
+     */
+    int call(lua_State *luaVm, LuaAsync task);
+
+    /**
+     * @brief Resume tasks with settled promises and lua coroutines of finished tasks (call from DoPulse)
+     * @return Resumed tasks amount
+     */
+    size_t pulse();
+
+    /**
+     * @brief Drop tasks of the stopped resource (call from ResourceStopped)
+     */
+    void resourceStopped(lua_State *luaVm);
+
+    /**
+     * @brief Suspended tasks amount
+     */
+    size_t getSuspended() const
+    {
+        return suspended.size();
+    }
+
+    /**
+     * @brief Set handler of errors raised by resumed lua coroutines (errors are ignored by default)
+     */
+    void setErrorHandler(ErrorHandler handler)
+    {
+        errorHandler = std::move(handler);
+    }
+
+private:
+    friend class LuaPromise;
+
+    /// Task waiting for a promise
+    struct Suspended
+    {
+        LuaAsync task;
+        lua_State *thread;                          ///< Yielded lua coroutine
+        int reference;                              ///< Coroutine registry reference (keeps it from GC)
+        const void *registry;                       ///< VM registry (shared by VM coroutines)
+        const void *function;                       ///< Yielding C function
+    };
+
+    /**
+     * @brief Whether the coroutine is still yielded by the task call
+     * @details The thread token (registry thread -> task ID, overwritten by the next call) and the C function
+     * at the top of the yielded call stack must match the task.
+     */
+    static bool isYielded(const Suspended &entry, uint64_t id);
+
+    /**
+     * @brief Set (or clear with 0) the task ID of the thread token
+     */
+    static void setToken(lua_State *thread, uint64_t id);
+
+    /**
+     * @brief Function of the top call stack frame
+     */
+    static const void *getFunction(lua_State *thread);
+
+    /**
+     * @brief Push true, task results or false, error
+     * @return Pushed values amount
+     */
+    static int finish(lua_State *luaVm, LuaAsync::promise_type &promise);
+
+    /**
+     * @brief VM identity shared by its coroutines
+     */
+    static const void *getRegistry(lua_State *luaVm);
+
+    std::unordered_map<uint64_t, Suspended> suspended;
+    LuaCompletionQueue<uint64_t> ready;             ///< Tasks with settled promises (any thread)
+    uint64_t nextId = 1;
+    ErrorHandler errorHandler;
+};
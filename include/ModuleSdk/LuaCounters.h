@@ -0,0 +1,104 @@
+#pragma once
+
+#include "lua/lua.h"
+#include <cstdint>
+#include <map>
+#include <string>
+
+#ifdef MODULE_SDK_COUNTERS
+#define LUA_COUNTERS_ADD(field, amount) (LuaCounters::local().field += (amount))
+#define LUA_COUNTERS_SCOPE(name) LuaCounters::Scope luaCountersScope(name)
+#else
+#define LUA_COUNTERS_ADD(field, amount) ((void) 0)
+#define LUA_COUNTERS_SCOPE(name) ((void) 0)
+#endif
+
+
+/**
+ * @brief Marshaling costs
+ */
+struct LuaCounterValues
+{
+    uint64_t calls = 0;                             ///< Finished scopes
+    uint64_t apiCalls = 0;                          ///< Lua C API calls through the imports
+    uint64_t tablesCreated = 0;                     ///< Lua tables created (lua_createtable)
+    uint64_t allocations = 0;                       ///< LuaArgument heap blocks (strings, tables, objects)
+    uint64_t bytesCopied = 0;                       ///< Bytes copied into LuaArgument values (copy() and strings)
+
+    LuaCounterValues &operator+=(const LuaCounterValues &other);
+};
+
+LuaCounterValues operator-(LuaCounterValues left, const LuaCounterValues &right);
+
+
+/**
+ * @brief Opt-in per-thread marshaling counters, rolled up per function
+ * @details Counting is compiled in with MODULE_SDK_COUNTERS (BUILD_COUNTERS CMake option).
+ * Every thread counts its own costs without synchronization. LUA_COUNTERS_SCOPE("name") at a function entry
+ * adds the costs made until the scope end to the function totals (nested scopes are inclusive).
+ * Without MODULE_SDK_COUNTERS the macros are empty and the totals stay empty.
+ */
+class LuaCounters
+{
+public:
+    /**
+     * @brief Whether counting is compiled in
+     */
+    static constexpr bool isEnabled()
+    {
+#ifdef MODULE_SDK_COUNTERS
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    /**
+     * @brief Costs of the current thread since its start
+     */
+    static LuaCounterValues current();
+
+    /**
+     * @brief Current thread counters of LuaArgument costs (use LUA_COUNTERS_ADD)
+     */
+    static LuaCounterValues &local();
+
+    /**
+     * @brief Totals of finished scopes per function
+     */
+    static std::map<std::string, LuaCounterValues> getFunctions();
+
+    /**
+     * @brief Clear function totals
+     */
+    static void reset();
+
+    /**
+     * @brief Lua: getMarshalingCounters([reset]) -> {functionName = {calls, apiCalls, tablesCreated, allocations, bytesCopied}}
+     */
+    static int luaGetCounters(lua_State *luaVm);
+
+    /**
+     * @brief Adds costs made during its lifetime to the function totals
+     */
+    class Scope
+    {
+    public:
+        /**
+         * @param name Function name (string literal, it is not copied until the scope end)
+         */
+        explicit Scope(const char *name)
+            : name(name), started(current())
+        {}
+
+        Scope(const Scope &) = delete;
+
+        Scope &operator=(const Scope &) = delete;
+
+        ~Scope();
+
+    private:
+        const char *name;
+        LuaCounterValues started;
+    };
+};
@@ -0,0 +1,123 @@
+#pragma once
+
+#include "LuaArgument.h"
+#include "lua/lua.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+/**
+ * @brief Coalesces native events into one lua call per subscriber and pulse
+ * @details Native code posts events to subscriptions during a pulse. flush() calls every subscriber
+ * with pending events once as callback(events), where events is a list presized on push.
+ * Events posted with a key replace the pending event with the same key (keeping its position),
+ * so the subscriber sees only the latest state. All methods must be called from the main thread.
+ */
+class LuaEventBatcher
+{
+public:
+    using SubscriptionId = uint64_t;
+    using ErrorHandler = std::function<void(lua_State *luaVm, const std::string &message)>;
+
+    LuaEventBatcher() = default;
+
+    LuaEventBatcher(const LuaEventBatcher &) = delete;
+
+    LuaEventBatcher &operator=(const LuaEventBatcher &) = delete;
+
+    /**
+     * @brief Subscribe lua function
+     * @param luaVm Lua VM pointer
+     * @param callbackIndex Callback stack index
+     * @throws LuaBadType Callback is not a function
+     * @return Subscription ID (never 0)
+     */
+    SubscriptionId subscribe(lua_State *luaVm, int callbackIndex);
+
+    /**
+     * @brief Unsubscribe, pending events are dropped
+     * @return false, if subscription does not exist
+     */
+    bool unsubscribe(SubscriptionId id);
+
+    /**
+     * @brief Add event
+     * @return false, if subscription does not exist
+     */
+    bool post(SubscriptionId id, LuaArgument event);
+
+    /**
+     * @brief Add event, which replaces pending event with the same key
+     * @return false, if subscription does not exist
+     */
+    bool post(SubscriptionId id, const LuaArgument &key, LuaArgument event);
+
+    /**
+     * @brief Deliver pending events (call at the end of DoPulse)
+     * @return Called callbacks amount
+     */
+    size_t flush();
+
+    /**
+     * @brief Drop subscriptions of the stopped resource (call from ResourceStopped)
+     */
+    void resourceStopped(lua_State *luaVm);
+
+    /**
+     * @brief Lua: subscribe(callback) -> subscription ID or false
+     */
+    int luaSubscribe(lua_State *luaVm);
+
+    /**
+     * @brief Lua: unsubscribe(subscription ID) -> boolean
+     */
+    int luaUnsubscribe(lua_State *luaVm);
+
+    /**
+     * @brief Not delivered events amount
+     */
+    size_t getPending() const
+    {
+        return pending;
+    }
+
+    size_t getSubscriptionsAmount() const
+    {
+        return subscriptions.size();
+    }
+
+    /**
+     * @brief Set handler of errors raised by callbacks (errors are ignored by default)
+     */
+    void setErrorHandler(ErrorHandler handler)
+    {
+        errorHandler = std::move(handler);
+    }
+
+private:
+    /// Subscriber and its pending events
+    struct Subscription
+    {
+        lua_State *luaVm;
+        int reference;                              ///< Callback registry reference
+        LuaArgument::TableListType events;
+        std::unordered_map<LuaArgument, size_t, LuaArgumentHash> keys;     ///< Merge key -> events index
+        size_t lastBatch = 0;                       ///< Previous batch size (reserved for the next one)
+    };
+
+    /**
+     * @brief Find subscription and mark it as having events
+     * @return nullptr, if subscription does not exist
+     */
+    Subscription *prepare(SubscriptionId id);
+
+    std::unordered_map<SubscriptionId, Subscription> subscriptions;
+    std::vector<SubscriptionId> dirty;              ///< Subscriptions with pending events
+    SubscriptionId nextId = 1;
+    size_t pending = 0;
+    ErrorHandler errorHandler;
+};
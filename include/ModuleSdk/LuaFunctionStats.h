@@ -0,0 +1,199 @@
+#pragma once
+
+#include "LuaStatsOutput.h"
+#include "lua/ILuaModuleManager.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+/**
+ * @brief Log-linear latency histogram (HDR-style, 16 sub-buckets per power of two, about 6% precision)
+ */
+class LuaLatencyHistogram
+{
+public:
+    static constexpr int SUB_BUCKETS_BITS = 4;
+    static constexpr int SUB_BUCKETS = 1 << SUB_BUCKETS_BITS;
+    static constexpr int MAGNITUDES = 40;           ///< Values up to 2^40 ns (longer are counted in the last bucket)
+    static constexpr int BUCKETS = (MAGNITUDES - SUB_BUCKETS_BITS + 1) * SUB_BUCKETS;
+
+    void record(uint64_t nanoseconds);
+
+    void merge(const LuaLatencyHistogram &other);
+
+    void clear();
+
+    uint64_t getCount() const
+    {
+        return count;
+    }
+
+    uint64_t getSum() const
+    {
+        return sum;
+    }
+
+    uint64_t getMax() const
+    {
+        return max;
+    }
+
+    /**
+     * @brief Value, which is not less than the fraction of recorded values (bucket upper bound)
+     * @param fraction 0..1
+     * @return 0, if the histogram is empty
+     */
+    uint64_t getPercentile(double fraction) const;
+
+    /**
+     * @brief Recorded values less than the bound (exact for powers of two)
+     */
+    uint64_t countBelow(uint64_t bound) const;
+
+    static size_t getIndex(uint64_t value);
+
+    /**
+     * @brief Smallest value of the bucket
+     */
+    static uint64_t getLowerBound(size_t index);
+
+    /**
+     * @brief Smallest value of the next bucket
+     */
+    static uint64_t getUpperBound(size_t index);
+
+private:
+    std::array<uint64_t, BUCKETS> buckets{};
+    uint64_t count = 0;
+    uint64_t sum = 0;
+    uint64_t max = 0;
+};
+
+
+/**
+ * @brief Call statistics of registered functions per function and resource
+ * @details registerFunction registers the function through the module manager and replaces the global
+ * with an instrumenting trampoline (C closure), which counts calls, raised errors and records
+ * successful call latency. Trampoline calls in progress are kept on a frame stack. Lua errors (longjmp)
+ * and exceptions leave their frames behind, they are counted as errors, once a later trampoline call
+ * or a statistics read is not deeper on the native stack, or the enclosing trampoline call returns.
+ * So calls in progress are never seen as errors and the errors counter only grows.
+ * Statistics are kept for the module lifetime (restarted resources continue their entries).
+ * Calls are expected on the main thread only (as all resource VMs are).
+ */
+class LuaFunctionStats: public LuaStatsOutput
+{
+public:
+    /// Dump format
+    enum class Format
+    {
+        Json,
+        Prometheus,
+    };
+
+    /// Statistics of a function (in a resource)
+    struct Summary
+    {
+        std::string function;
+        std::string resource;                       ///< Empty for merged resources
+        uint64_t calls;
+        uint64_t errors;
+        LuaLatencyHistogram latency;                ///< Successful calls (nanoseconds)
+    };
+
+    /**
+     * @param enabled Register functions without trampolines, if false
+     */
+    explicit LuaFunctionStats(bool enabled = true)
+        : enabled(enabled)
+    {}
+
+    LuaFunctionStats(const LuaFunctionStats &) = delete;
+
+    LuaFunctionStats &operator=(const LuaFunctionStats &) = delete;
+
+    /**
+     * @brief Register function with the trampoline (call from RegisterFunctions)
+     * @return RegisterFunction result
+     */
+    bool registerFunction(ILuaModuleManager10 *manager, lua_State *luaVm, const char *name, lua_CFunction function);
+
+    /**
+     * @param byResource Separate entries per resource, or merged per function
+     * @return Summaries sorted by function (and resource) name
+     */
+    std::vector<Summary> getSummaries(bool byResource = true) const;
+
+    /**
+     * @brief Clear counters and histograms
+     */
+    void reset();
+
+    /**
+     * @brief Prometheus text exposition (calls and errors counters, latency histogram in seconds)
+     */
+    std::string toPrometheus() const;
+
+    /**
+     * @brief JSON document with one entry per function and resource
+     */
+    std::string toJson() const;
+
+    /**
+     * @brief Write statistics to the file
+     * @return false, if the file can't be written
+     */
+    bool dump(const std::string &path, Format format) const;
+
+    bool isEnabled() const
+    {
+        return enabled;
+    }
+
+    /**
+     * @brief Lua: getFunctionStats([byResource = true]) -> {{function, resource, calls, errors, p50, p90, p99, max}, ...}
+     * @details Latency values are in milliseconds
+     */
+    int luaGetStats(lua_State *luaVm);
+
+    /**
+     * @brief Lua: dumpFunctionStats(fileName[, "json" or "prometheus"]) -> true or false, error message
+     * @details The file name can't contain directories, it is written to the dump directory
+     */
+    int luaDump(lua_State *luaVm);
+
+private:
+    /// Trampoline upvalue
+    struct Entry
+    {
+        LuaFunctionStats *owner;
+        lua_CFunction function;
+        uint64_t calls = 0;
+        uint64_t errors = 0;                        ///< Unwound calls
+        LuaLatencyHistogram latency;
+    };
+
+    /// Trampoline call in progress
+    struct Frame
+    {
+        Entry *entry;
+        uintptr_t address;                          ///< Native stack address of the trampoline frame
+    };
+
+    static int trampoline(lua_State *luaVm);
+
+    /**
+     * @brief Count frames left by errors, which are not below the native stack address
+     * @details The native stack grows down: live callers of the address have higher ones
+     */
+    void unwind(uintptr_t address) const;
+
+    bool enabled;
+    std::map<std::pair<std::string, std::string>, Entry> entries;   ///< (function, resource), nodes are stable
+    mutable std::vector<Frame> frames;              ///< Innermost call last
+};
@@ -0,0 +1,165 @@
+#pragma once
+
+#include "LuaStatsOutput.h"
+#include "lua/lua.h"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+
+
+/**
+ * @brief Incremental garbage collection of opted-in VMs in DoPulse, under a time budget
+ * @details A pacer cycle starts, when the VM memory grows by the trigger percent over the memory left by
+ * the previous cycle (pacer or automatic one). The trigger is below the automatic collector pause, so pacer
+ * cycles start first. Then every pulse runs LUA_GCSTEP steps until the VM budget is spent or the cycle ends.
+ * Script allocations run automatic steps too: memory dropped between pulses ends the pacer cycle.
+ * The automatic collector stays as a backstop. Once a second the pacer estimates the allocation rate
+ * (memory growth between pulses) and compares the collection time it needs with the time the budget gives.
+ * The collector pause is raised up to maxPause, when the pacer keeps up (automatic cycles start later),
+ * and lowered down to minPause with a higher step multiplier, when it does not.
+ * The original pause and step multiplier are restored on disable. Pacing belongs to the VM, so its coroutines
+ * share it. All methods must be called from the main thread.
+ */
+class LuaGcPacer
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /// Pacing settings of a VM
+    struct Options
+    {
+        std::chrono::microseconds budget{1000};     ///< Step time per pulse
+        int stepSize = 8;                           ///< LUA_GCSTEP argument (work of a single step)
+        int trigger = 120;                          ///< Cycle start, percent of the memory after the last cycle
+        int minPause = 200;                         ///< Automatic collector pause bounds (percent, above trigger)
+        int maxPause = 400;
+        int stepMultiplier = 200;                   ///< Step multiplier bounds (percent)
+        int maxStepMultiplier = 1000;
+        bool adaptive = true;                       ///< Tune pause and step multiplier once a second
+    };
+
+    /// Pacing counters of a VM
+    struct Stats
+    {
+        std::chrono::nanoseconds gcTime{0};         ///< Time spent in pacer steps
+        std::chrono::nanoseconds lastPulseTime{0};  ///< Step time of the last pulse
+        uint64_t steps = 0;
+        uint64_t cycles = 0;                        ///< Cycles finished by pacer steps
+        uint64_t pulses = 0;
+        size_t bytes = 0;                           ///< VM memory after the last pulse
+        double allocationRate = 0;                  ///< Estimated bytes per second
+        int pause = 0;                              ///< Current automatic collector pause
+        int stepMultiplier = 0;                     ///< Current step multiplier
+    };
+
+    LuaGcPacer() = default;
+
+    LuaGcPacer(const LuaGcPacer &) = delete;
+
+    LuaGcPacer &operator=(const LuaGcPacer &) = delete;
+
+    /**
+     * @brief Start pacing the VM (options of a paced VM are replaced)
+     * @return false, if the options are invalid (trigger must be below minPause)
+     */
+    bool enable(lua_State *luaVm, const Options &options);
+
+    /**
+     * @brief Stop pacing, restore the original pause and step multiplier
+     * @return false, if the VM is not paced
+     */
+    bool disable(lua_State *luaVm);
+
+    bool isEnabled(lua_State *luaVm) const
+    {
+        return states.find(getRegistry(luaVm)) != states.end();
+    }
+
+    /**
+     * @return Counters of the VM (empty, if it is not paced)
+     */
+    Stats getStats(lua_State *luaVm) const;
+
+    /**
+     * @brief Collection time of all VMs
+     */
+    std::chrono::nanoseconds getTotalGcTime() const;
+
+    /**
+     * @brief Run collection steps of paced VMs (call from DoPulse)
+     * @return Steps amount
+     */
+    size_t pulse()
+    {
+        return this->pulse(Clock::now());
+    }
+
+    /**
+     * @brief Run collection steps, rates are measured at the given time
+     * @return Steps amount
+     */
+    size_t pulse(Clock::time_point now);
+
+    /**
+     * @brief Forget the stopped resource VM (call from ResourceStopped)
+     */
+    void resourceStopped(lua_State *luaVm);
+
+    /**
+     * @brief Lua: enableGcPacer([budget = 1000 (microseconds)]) -> boolean
+     */
+    int luaEnable(lua_State *luaVm);
+
+    /**
+     * @brief Lua: disableGcPacer() -> boolean
+     */
+    int luaDisable(lua_State *luaVm);
+
+    /**
+     * @brief Lua: getGcPacerStats() -> {gcTime, lastPulseTime (milliseconds), steps, cycles, pulses, bytes,
+     * allocationRate, pause, stepMultiplier} or false
+     */
+    int luaGetStats(lua_State *luaVm);
+
+private:
+    /// Paced VM
+    struct State
+    {
+        lua_State *luaVm;                           ///< Thread, which enabled pacing (referenced in the registry)
+        int reference;
+        Options options;
+        Stats stats;
+        int originalPause;
+        int originalStepMultiplier;
+        bool collecting = false;                    ///< Pacer cycle is started
+        size_t baseline;                            ///< Memory after the last (pacer or automatic) cycle
+        size_t lastBytes;                           ///< Memory after the last pulse
+        std::chrono::nanoseconds cycleTime{0};      ///< Step time of the current cycle
+        size_t cycleBytes = 0;                      ///< Memory at the current cycle start
+        double throughput = 0;                      ///< Collected heap bytes per second of step time
+        Clock::time_point window;                   ///< Rate window start
+        size_t windowAllocated = 0;
+        uint64_t windowPulses = 0;
+    };
+
+    static size_t getBytes(lua_State *luaVm);
+
+    /**
+     * @brief VM identity shared by its coroutines
+     */
+    static const void *getRegistry(lua_State *luaVm);
+
+    /**
+     * @brief Run steps of the VM within its budget
+     */
+    size_t step(State &state);
+
+    /**
+     * @brief Update the allocation rate and tune the collector
+     */
+    static void adapt(State &state, double elapsed);
+
+    std::map<const void *, std::unique_ptr<State>> states;     ///< By VM registry
+};
@@ -0,0 +1,192 @@
+#pragma once
+
+#include "LuaStatsOutput.h"
+#include "lua/ILuaModuleManager.h"
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+/**
+ * @brief Opt-in per-VM memory telemetry: the VM allocator is wrapped and forwards to the original one
+ * @details Live bytes start from the VM GC count at enable time. New blocks are counted by power of two
+ * size classes. Allocations made while an Attribution scope is alive on the thread (LuaVmExtended pushes)
+ * are also counted as module memory. Allocation rates are updated by pulse once a second.
+ * Trackers belong to the VM, so its coroutines share them.
+ * The wrapper counts without synchronization: enable it for VMs, which run on the main thread,
+ * and read the stats there.
+ */
+class LuaMemoryTelemetry : public LuaStatsOutput
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr size_t SIZE_CLASSES = 21;      ///< Up to 1 B, 2 B, ... 512 KiB, bigger
+
+    /// Memory counters of a VM
+    struct Stats
+    {
+        std::string name;
+        int64_t liveBytes = 0;
+        int64_t peakBytes = 0;
+        uint64_t allocations = 0;                   ///< New blocks
+        uint64_t reallocations = 0;                 ///< Resized blocks
+        uint64_t frees = 0;
+        uint64_t allocatedBytes = 0;                ///< New blocks and growth of resized blocks
+        uint64_t moduleAllocations = 0;             ///< New blocks in attribution scopes
+        uint64_t moduleBytes = 0;                   ///< Allocated bytes in attribution scopes
+        double allocationRate = 0;                  ///< Allocated bytes per second (last pulse second)
+        double allocationsPerSecond = 0;
+        std::array<uint64_t, SIZE_CLASSES> sizeClasses{};   ///< New blocks per size class
+    };
+
+    /**
+     * @brief Marks allocations of the current thread as made by the module (RAII, nestable)
+     */
+    class Attribution
+    {
+    public:
+        Attribution()
+        {
+            depth++;
+        }
+
+        Attribution(const Attribution &) = delete;
+
+        Attribution &operator=(const Attribution &) = delete;
+
+        ~Attribution()
+        {
+            depth--;
+        }
+
+    private:
+        friend class LuaMemoryTelemetry;
+
+        static thread_local unsigned int depth;
+    };
+
+    LuaMemoryTelemetry() = default;
+
+    LuaMemoryTelemetry(const LuaMemoryTelemetry &) = delete;
+
+    LuaMemoryTelemetry &operator=(const LuaMemoryTelemetry &) = delete;
+
+    /**
+     * @brief Wrap the VM allocator
+     * @param name Resource name
+     * @return false, if the VM is already tracked
+     */
+    bool enable(lua_State *luaVm, const std::string &name);
+
+    /**
+     * @brief Restore the original allocator and drop the stats
+     * @return false, if the VM is not tracked or its allocator was wrapped again by someone else
+     */
+    bool disable(lua_State *luaVm);
+
+    bool isEnabled(lua_State *luaVm) const
+    {
+        return trackers.find(getRegistry(luaVm)) != trackers.end();
+    }
+
+    /**
+     * @return Counters of the VM (empty, if it is not tracked)
+     */
+    Stats getStats(lua_State *luaVm) const;
+
+    /**
+     * @brief Counters of all tracked VMs, sorted by name
+     */
+    std::vector<Stats> getAllStats() const;
+
+    /**
+     * @brief Update allocation rates once a second (call from DoPulse)
+     */
+    void pulse()
+    {
+        this->pulse(Clock::now());
+    }
+
+    void pulse(Clock::time_point now);
+
+    /**
+     * @brief Stop tracking the stopped resource VM (call from ResourceStopped)
+     * @details The original allocator is restored, so the VM is closed without the wrapper
+     */
+    void resourceStopped(lua_State *luaVm);
+
+    /**
+     * @brief JSON document with one entry per tracked VM
+     */
+    std::string toJson() const;
+
+    /**
+     * @brief Write JSON stats to the file
+     * @return false, if the file can't be written
+     */
+    bool dump(const std::string &path) const;
+
+    /**
+     * @brief Size class of the allocation (the last class holds all bigger sizes)
+     */
+    static size_t getSizeClass(size_t size);
+
+    /**
+     * @brief Lua: enableMemoryTelemetry() -> boolean
+     * @param manager Resolves the resource name (nullptr names it "vm")
+     */
+    int luaEnable(lua_State *luaVm, ILuaModuleManager10 *manager);
+
+    /**
+     * @brief Lua: disableMemoryTelemetry() -> boolean
+     */
+    int luaDisable(lua_State *luaVm);
+
+    /**
+     * @brief Lua: getMemoryStats([allResources = false]) -> stats or {resourceName = stats}
+     * @details Stats are {liveBytes, peakBytes, allocations, reallocations, frees, allocatedBytes,
+     * moduleAllocations, moduleBytes, allocationRate, allocationsPerSecond, sizeClasses = {[upperBound] = blocks}}
+     */
+    int luaGetStats(lua_State *luaVm);
+
+    /**
+     * @brief Lua: dumpMemoryStats(fileName) -> true or false, error message
+     * @details The file name can't contain directories, it is written to the dump directory
+     */
+    int luaDump(lua_State *luaVm);
+
+private:
+    /// Allocator userdata
+    struct Tracker
+    {
+        lua_Alloc allocator;                        ///< Original allocator
+        void *userdata;                             ///< Original allocator userdata
+        Stats stats;
+        uint64_t rateAllocatedBytes = 0;            ///< Counters at the rate window start
+        uint64_t rateAllocations = 0;
+    };
+
+    static void *allocate(void *userdata, void *pointer, size_t oldSize, size_t newSize);
+
+    /**
+     * @brief VM identity shared by its coroutines
+     */
+    static const void *getRegistry(lua_State *luaVm);
+
+    /**
+     * @brief Put the original allocator back
+     * @return false, if the allocator was wrapped again by someone else
+     */
+    static bool restore(lua_State *luaVm, Tracker *tracker);
+
+    static void pushStats(lua_State *luaVm, const Stats &stats);
+
+    std::map<const void *, std::unique_ptr<Tracker>> trackers;     ///< By VM registry
+    Clock::time_point rateWindow = Clock::now();
+};
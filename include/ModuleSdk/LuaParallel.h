@@ -0,0 +1,147 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+
+/**
+ * @brief Fork-join parallel loop over index ranges with work stealing
+ * @details parallelFor splits [0, count) between the calling thread and persistent worker threads.
+ * Every participant takes grain-sized chunks from the front of its own range and, when it is empty,
+ * steals half of the remaining range of another participant. The call returns when all chunks are done,
+ * so it can be used synchronously from lua functions. Small inputs and nested calls run serially on the caller.
+ * One loop runs at a time per pool (concurrent calls wait).
+ */
+class LuaParallel
+{
+public:
+    /**
+     * @brief Constructor. Threads are started on the first parallel loop
+     * @param threads Participants amount including the caller (0 means hardware concurrency)
+     * @param serialThreshold Loops with less items run serially
+     */
+    explicit LuaParallel(unsigned int threads = 0, size_t serialThreshold = 4096);
+
+    LuaParallel(const LuaParallel &) = delete;
+
+    LuaParallel &operator=(const LuaParallel &) = delete;
+
+    /**
+     * @brief Call body(begin, end) for chunks covering [0, count) and wait
+     * @param count Items amount
+     * @param body Callable with (size_t begin, size_t end) arguments, called concurrently
+     * @param grain Chunk size (0 means count / (participants * 8))
+     * @throws Rethrows the first body exception (the rest of chunks are skipped)
+     */
+    template<typename F>
+    void parallelFor(size_t count, F &&body, size_t grain = 0)
+    {
+        using Body = typename std::remove_reference<F>::type;
+        this->run(
+            count,
+            grain,
+            [](void *context, size_t begin, size_t end)
+            {
+                (*static_cast<Body *>(context))(begin, end);
+            },
+            const_cast<void *>(static_cast<const void *>(&body))
+        );
+    }
+
+    /**
+     * @brief Participants amount including the caller
+     */
+    unsigned int getThreadsAmount() const
+    {
+        return threadsAmount;
+    }
+
+    size_t getSerialThreshold() const
+    {
+        return serialThreshold;
+    }
+
+    void setSerialThreshold(size_t threshold)
+    {
+        serialThreshold = threshold;
+    }
+
+    /**
+     * @brief Shared pool of the module
+     */
+    static LuaParallel &getDefault();
+
+    /**
+     * @brief Destructor. Waits for worker threads
+     */
+    ~LuaParallel();
+
+private:
+    using Invoke = void (*)(void *context, size_t begin, size_t end);
+
+    /// Remaining range of a participant
+    struct Slot
+    {
+        std::mutex mutex;
+        size_t begin = 0;
+        size_t end = 0;
+    };
+
+    /// Running loop
+    struct Job
+    {
+        Invoke invoke;
+        void *context;
+        size_t grain;
+        std::atomic<bool> cancelled{false};
+        std::mutex exceptionMutex;
+        std::exception_ptr exception;               ///< First body exception
+    };
+
+    /**
+     * @brief Run type-erased loop
+     */
+    void run(size_t count, size_t grain, Invoke invoke, void *context);
+
+    /**
+     * @brief Take chunks until no range is left
+     */
+    void participate(Job &job, unsigned int self);
+
+    /**
+     * @brief Take chunk from own range or steal half of another range
+     * @return false, if all ranges are empty
+     */
+    bool take(Job &job, unsigned int self, size_t &begin, size_t &end);
+
+    /**
+     * @brief Worker thread loop
+     */
+    void work(unsigned int self);
+
+    /**
+     * @brief Start worker threads
+     */
+    void start();
+
+    unsigned int threadsAmount;
+    size_t serialThreshold;
+    std::unique_ptr<Slot[]> slots;                  ///< Ranges (0 is the caller)
+    std::vector<std::thread> workers;
+    std::mutex runMutex;                            ///< One loop at a time
+    std::mutex mutex;                               ///< Protects job, generation, active and stopping
+    std::condition_variable condition;              ///< Job has been published or pool is stopping
+    std::condition_variable finished;               ///< Worker has left the job
+    Job *job = nullptr;
+    uint64_t generation = 0;
+    unsigned int active = 0;                        ///< Workers inside the job
+    bool stopping = false;
+};
@@ -0,0 +1,198 @@
+#pragma once
+
+#include "LuaStatsOutput.h"
+#include "lua/ILuaModuleManager.h"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+/**
+ * @brief Sampling profiler of lua call stacks (count hooks), folded stacks output for flamegraphs
+ * @details Profiling is enabled per VM: start installs a count hook, which fires every N lua instructions.
+ * The hook takes at most samplesPerSecond samples (other hook calls only read the clock), walks at most
+ * maxDepth frames and writes the sample into a fixed-size lock-free ring, so the overhead stays bounded.
+ * The hook is the single producer, collect is the single consumer. Frame names are interned into an append-only
+ * table published with an atomic counter, so the consumer may run on another thread.
+ * Samples are aggregated as "resource;outer;...;inner count" lines (flamegraph.pl, speedscope).
+ * Time spent in C functions is not sampled (count hooks fire on lua instructions only). Coroutines created
+ * after start inherit the hook. Sessions belong to the VM, so its coroutines share them.
+ * Start, stop and the hook run on the main thread.
+ */
+class LuaProfiler : public LuaStatsOutput
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr size_t MAX_DEPTH = 64;         ///< Frames per sample (deeper stacks are truncated)
+
+    /// Sampling settings
+    struct Options
+    {
+        int instructions = 1000;                    ///< Lua instructions between hook calls
+        unsigned int samplesPerSecond = 1000;       ///< Sample budget of the VM (0 means unlimited)
+        size_t maxDepth = MAX_DEPTH;                ///< Frames per sample (at most MAX_DEPTH)
+    };
+
+    /// Profiling counters of a VM
+    struct Stats
+    {
+        uint64_t samples = 0;                       ///< Samples written
+        uint64_t skipped = 0;                       ///< Hook calls over the sample budget
+        uint64_t dropped = 0;                       ///< Samples lost, because the ring was full
+        std::chrono::nanoseconds hookTime{0};       ///< Time spent in the hook
+    };
+
+    /**
+     * @param bufferSize Ring samples (rounded up to a power of two)
+     * @param maxFrames Distinct frame names (later frames are folded as "[unknown]")
+     */
+    explicit LuaProfiler(size_t bufferSize = 4096, size_t maxFrames = 65536);
+
+    LuaProfiler(const LuaProfiler &) = delete;
+
+    LuaProfiler &operator=(const LuaProfiler &) = delete;
+
+    /**
+     * @brief Install the sampling hook
+     * @param name Root frame of the VM samples (resource name)
+     * @return false, if the VM has a foreign hook or the options are invalid
+     */
+    bool start(lua_State *luaVm, const std::string &name, const Options &options);
+
+    /**
+     * @brief Remove the sampling hook (stats are kept until resourceStopped)
+     * @return false, if the VM is not profiled
+     */
+    bool stop(lua_State *luaVm);
+
+    bool isRunning(lua_State *luaVm) const;
+
+    /**
+     * @return Counters of the VM (empty, if it was never started)
+     */
+    Stats getStats(lua_State *luaVm) const;
+
+    /**
+     * @brief Move samples from the ring into folded stacks (consumer)
+     * @return Samples amount
+     */
+    size_t collect();
+
+    /**
+     * @brief Collect samples (call from DoPulse, so the ring does not overflow)
+     */
+    size_t pulse()
+    {
+        return this->collect();
+    }
+
+    /**
+     * @brief Collected stacks in the folded format, sorted (consumer)
+     */
+    std::string toFolded();
+
+    /**
+     * @brief Write folded stacks to the file (consumer)
+     * @return false, if the file can't be written
+     */
+    bool dump(const std::string &path);
+
+    /**
+     * @brief Drop collected stacks (consumer)
+     */
+    void reset();
+
+    /**
+     * @brief Forget the stopped resource VM (call from ResourceStopped)
+     */
+    void resourceStopped(lua_State *luaVm);
+
+    /**
+     * @brief Lua: startProfiler([instructions = 1000, samplesPerSecond = 1000, maxDepth = 64]) -> true or false, error message
+     * @param manager Resolves the resource name of the root frame (nullptr names it "vm")
+     */
+    int luaStart(lua_State *luaVm, ILuaModuleManager10 *manager);
+
+    /**
+     * @brief Lua: stopProfiler() -> boolean
+     */
+    int luaStop(lua_State *luaVm);
+
+    /**
+     * @brief Lua: getProfilerStats() -> {running, samples, skipped, dropped, hookTime (milliseconds)}
+     */
+    int luaGetStats(lua_State *luaVm);
+
+    /**
+     * @brief Lua: dumpProfiler(fileName) -> true or false, error message
+     * @details The file name can't contain directories, it is written to the dump directory
+     */
+    int luaDump(lua_State *luaVm);
+
+private:
+    /// Profiled VM (registry value of the hook)
+    struct Session
+    {
+        Session(LuaProfiler *profiler, uint32_t root, const Options &options)
+            : profiler(profiler),
+              root(root),
+              options(options)
+        {
+        }
+
+        LuaProfiler *profiler;
+        uint32_t root;                              ///< Name frame
+        Options options;
+        bool running = false;
+        Clock::time_point window;                   ///< Current second of the sample budget
+        unsigned int windowSamples = 0;
+        Stats stats;
+    };
+
+    /// Ring slot
+    struct Sample
+    {
+        uint32_t root;
+        uint32_t depth;
+        std::array<uint32_t, MAX_DEPTH> frames;     ///< Innermost first
+    };
+
+    static void hook(lua_State *luaVm, lua_Debug *debug);
+
+    /**
+     * @brief VM identity shared by its coroutines
+     */
+    static const void *getRegistry(lua_State *luaVm);
+
+    /**
+     * @brief Take a sample of the VM stack (producer)
+     */
+    void sample(lua_State *luaVm, Session &session);
+
+    /**
+     * @brief Frame ID of the name, registered on the first use (producer)
+     */
+    uint32_t intern(const std::string &name);
+
+    std::vector<Sample> ring;
+    size_t mask;
+    std::atomic<size_t> head{0};                    ///< Next written sample
+    std::atomic<size_t> tail{0};                    ///< Next collected sample
+
+    std::unique_ptr<std::string[]> frames;          ///< Append-only frame names
+    size_t maxFrames;
+    std::atomic<size_t> frameCount{0};
+    std::unordered_map<std::string, uint32_t> frameIds;     ///< Producer only
+    std::string frameName;                          ///< Reused name buffer (producer only)
+
+    std::map<const void *, std::unique_ptr<Session>> sessions;     ///< By VM registry
+    std::unordered_map<std::string, uint64_t> folded;       ///< Consumer only
+};
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "LuaArgument.h"
+#include <cstddef>
+#include <vector>
+
+
+/**
+ * @brief Precomputed table sizes and stack usage for pushing LuaArgument trees
+ * @details Arguments are walked once before the push. Tables are recorded in push order,
+ * so they can be created with exact array and hash sizes and the stack can be reserved once.
+ */
+class LuaPushPlan
+{
+public:
+    /// Table creation sizes
+    struct TableSize
+    {
+        int arraySize;                          ///< Array part size (keys 1..n)
+        int hashSize;                           ///< Hash part size
+    };
+
+    /**
+     * @brief Add argument to the plan (arguments are pushed one after another)
+     * @param argument Argument to be pushed
+     */
+    void add(const LuaArgument &argument);
+
+    /**
+     * @brief Stack slots required to push all added arguments
+     */
+    int getStackSize() const
+    {
+        return stackSize;
+    }
+
+    /**
+     * @brief Next table sizes (in push order)
+     * @throws LuaOutOfRange Table has not been planned
+     */
+    TableSize nextTable();
+
+private:
+    /**
+     * @brief Record table sizes of the argument tree
+     * @return Stack slots required to push the argument
+     */
+    int plan(const LuaArgument &argument);
+
+    std::vector<TableSize> tables;              ///< Table sizes (in push order)
+    size_t position = 0;                        ///< Next table index
+    int stackSize = 0;                          ///< Required stack slots
+    int pushed = 0;                             ///< Added arguments amount
+};
@@ -0,0 +1,219 @@
+#pragma once
+
+#include "LuaArgument.h"
+#include "lua/lua.h"
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+/**
+ * @brief Main thread scheduler driven by DoPulse: native timers and time-budgeted deferred tasks
+ * @details Timers are kept in a hierarchical timer wheel (4 levels of 256 slots, 1 ms resolution),
+ * so adding, killing and expiring a timer is O(1). Lua timer callbacks are pinned in the registry once.
+ * Every pulse runs expired timers and then deferred task steps until the time budget is spent.
+ * Work left over (late timers, unfinished tasks) is carried into the next pulse.
+ * All methods must be called from the main thread.
+ */
+class LuaScheduler
+{
+public:
+    using Clock = std::chrono::steady_clock;
+    using TimerId = uint64_t;
+    using Callback = std::function<void()>;
+    using Task = std::function<bool()>;                                 ///< Returns true, when finished
+    using ErrorHandler = std::function<void(lua_State *luaVm, const std::string &message)>;
+
+    /**
+     * @brief Constructor
+     * @param budget Pulse time budget (0 means unlimited)
+     */
+    explicit LuaScheduler(std::chrono::microseconds budget = std::chrono::microseconds(2000));
+
+    LuaScheduler(const LuaScheduler &) = delete;
+
+    LuaScheduler &operator=(const LuaScheduler &) = delete;
+
+    /**
+     * @brief Add native timer
+     * @param callback Timer callback
+     * @param interval Interval in milliseconds (at least 1)
+     * @param repeats Times to execute (0 means infinite)
+     * @return Timer ID (never 0)
+     */
+    TimerId setTimer(Callback callback, unsigned int interval, unsigned int repeats = 1);
+
+    /**
+     * @brief Add lua timer
+     * @param luaVm Lua VM pointer
+     * @param callbackIndex Callback stack index
+     * @param interval Interval in milliseconds (at least 1)
+     * @param repeats Times to execute (0 means infinite)
+     * @param arguments Callback arguments
+     * @throws LuaBadType Callback is not a function
+     * @return Timer ID (never 0)
+     */
+    TimerId setTimer(
+        lua_State *luaVm, int callbackIndex, unsigned int interval, unsigned int repeats = 1,
+        std::vector<LuaArgument> arguments = {}
+    );
+
+    /**
+     * @brief Kill timer
+     * @return false, if timer does not exist
+     */
+    bool killTimer(TimerId id);
+
+    /**
+     * @brief Check, if timer exists
+     */
+    bool isTimer(TimerId id) const
+    {
+        return timers.find(id) != timers.end();
+    }
+
+    /**
+     * @brief Add deferred task, which is run step by step in pulses
+     * @param task Task step. Returns true, when the task is finished
+     */
+    void defer(Task task);
+
+    /**
+     * @brief Run expired timers and deferred tasks (call from DoPulse)
+     * @return Timer callbacks and task steps amount
+     */
+    size_t pulse()
+    {
+        return this->pulse(Clock::now());
+    }
+
+    /**
+     * @brief Run expired timers and deferred tasks at the given time
+     * @return Timer callbacks and task steps amount
+     */
+    size_t pulse(Clock::time_point now);
+
+    /**
+     * @brief Drop timers of the stopped resource (call from ResourceStopped)
+     */
+    void resourceStopped(lua_State *luaVm);
+
+    /**
+     * @brief Lua: setTimer(callback, interval, timesToExecute, arguments...) -> timer ID or false
+     */
+    int luaSetTimer(lua_State *luaVm);
+
+    /**
+     * @brief Lua: killTimer(timer ID) -> boolean
+     */
+    int luaKillTimer(lua_State *luaVm);
+
+    size_t getTimersAmount() const
+    {
+        return timers.size();
+    }
+
+    size_t getTasksAmount() const
+    {
+        return tasks.size();
+    }
+
+    std::chrono::microseconds getBudget() const
+    {
+        return budget;
+    }
+
+    void setBudget(std::chrono::microseconds newBudget)
+    {
+        budget = newBudget;
+    }
+
+    /**
+     * @brief Set handler of errors raised by callbacks and tasks (errors are ignored by default)
+     */
+    void setErrorHandler(ErrorHandler handler)
+    {
+        errorHandler = std::move(handler);
+    }
+
+private:
+    static constexpr unsigned int LEVELS = 4;
+    static constexpr unsigned int SLOT_BITS = 8;
+    static constexpr unsigned int SLOTS = 1u << SLOT_BITS;
+
+    /// Timer (node of intrusive slot list)
+    struct Timer
+    {
+        TimerId id;
+        uint64_t expires;                           ///< Expiration tick
+        unsigned int interval;
+        unsigned int repeats;                       ///< Times left (0 means infinite)
+        Callback callback;                          ///< Native callback
+        lua_State *luaVm;                           ///< Lua VM (nullptr for native timers)
+        int reference;                              ///< Lua callback registry reference
+        std::vector<LuaArgument> arguments;         ///< Lua callback arguments
+        Timer *previous;
+        Timer *next;
+        Timer **slot;                               ///< Slot list head (nullptr, if not in the wheel)
+    };
+
+    /**
+     * @brief Add timer object
+     */
+    TimerId add(std::unique_ptr<Timer> timer);
+
+    /**
+     * @brief Put timer into the wheel slot by its expiration tick
+     */
+    void insert(Timer *timer);
+
+    /**
+     * @brief Remove timer from its slot
+     */
+    static void unlink(Timer *timer);
+
+    /**
+     * @brief Move wheel to tick, expired timers are added to due list
+     */
+    void advance(uint64_t tick);
+
+    /**
+     * @brief Re-insert timers of upper level slot
+     */
+    void cascade(unsigned int level);
+
+    /**
+     * @brief Run timer callback and reschedule or remove it
+     */
+    void fire(Timer *timer);
+
+    /**
+     * @brief Remove timer, lua reference is released, if VM is still running
+     */
+    void remove(TimerId id, bool releaseReference);
+
+    /**
+     * @brief Current tick
+     */
+    uint64_t getTick(Clock::time_point time) const;
+
+    Clock::time_point start;                        ///< Tick 0 time
+    uint64_t current = 0;                           ///< Processed tick
+    size_t scheduled = 0;                           ///< Timers in the wheel
+    TimerId firing = 0;                             ///< Timer, which callback is running
+    bool firingKilled = false;                      ///< Running timer has been killed by its callback
+    std::array<std::array<Timer *, SLOTS>, LEVELS> wheel{};
+    std::unordered_map<TimerId, std::unique_ptr<Timer>> timers;
+    std::deque<TimerId> due;                        ///< Expired timers not yet run
+    std::deque<Task> tasks;                         ///< Unfinished deferred tasks
+    TimerId nextId = 1;
+    std::chrono::microseconds budget;
+    ErrorHandler errorHandler;
+};
@@ -0,0 +1,180 @@
+#pragma once
+
+#include "LuaArgument.h"
+#include "lua/lua.h"
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+class LuaCompiledSchema;
+
+/**
+ * @brief Table structure description (fields, types, optionality and nested lists)
+ * @details Schema is built once and compiled for every lua VM it is used with
+ */
+class LuaSchema
+{
+    friend LuaCompiledSchema;
+
+public:
+    /**
+     * @brief Add scalar field (TABLE_MAP type means the whole table is parsed)
+     * @param name Field key
+     * @param type Field type
+     * @param optional Field may be nil
+     * @return Current schema
+     */
+    LuaSchema &field(std::string name, LuaArgumentType type, bool optional = false);
+
+    /**
+     * @brief Add nested record field
+     * @param name Field key
+     * @param record Nested record schema
+     * @param optional Field may be nil
+     * @return Current schema
+     */
+    LuaSchema &field(std::string name, const LuaSchema &record, bool optional = false);
+
+    /**
+     * @brief Add list of scalars field (keys 1..n until the first nil)
+     * @param name Field key
+     * @param type Elements type
+     * @param optional Field may be nil
+     * @return Current schema
+     */
+    LuaSchema &list(std::string name, LuaArgumentType type, bool optional = false);
+
+    /**
+     * @brief Add list of records field (keys 1..n until the first nil)
+     * @param name Field key
+     * @param record Elements schema
+     * @param optional Field may be nil
+     * @return Current schema
+     */
+    LuaSchema &list(std::string name, const LuaSchema &record, bool optional = false);
+
+    /**
+     * @brief Compile schema for lua VM
+     * @param luaVm Lua VM pointer
+     * @return Compiled schema
+     */
+    LuaCompiledSchema compile(lua_State *luaVm) const;
+
+private:
+    /// Field kind
+    enum class Kind
+    {
+        Scalar,
+        Record,
+        ScalarList,
+        RecordList,
+    };
+
+    /// Field description
+    struct Field
+    {
+        Kind kind;
+        std::string name;                           ///< Field key
+        LuaArgumentType type;                       ///< Scalar (or list element) type
+        bool optional;                              ///< Field may be nil
+        std::shared_ptr<const LuaSchema> record;    ///< Nested record schema
+    };
+
+    std::vector<Field> fields;                      ///< Fields in declaration order
+};
+
+/**
+ * @brief Schema compiled into flat instruction sequence for a lua VM
+ * @details Field keys are interned in the lua registry, so no strings are pushed during extraction.
+ * Compiled schema must not outlive the lua VM it was compiled for.
+ */
+class LuaCompiledSchema
+{
+public:
+    /**
+     * @brief Constructor. Compiles schema
+     * @param luaVm Lua VM pointer
+     * @param schema Source schema
+     */
+    LuaCompiledSchema(lua_State *luaVm, const LuaSchema &schema);
+
+    LuaCompiledSchema(const LuaCompiledSchema &) = delete;
+
+    LuaCompiledSchema &operator=(const LuaCompiledSchema &) = delete;
+
+    LuaCompiledSchema(LuaCompiledSchema &&schema) noexcept;
+
+    LuaCompiledSchema &operator=(LuaCompiledSchema &&schema) noexcept;
+
+    /**
+     * @brief Validate table and extract schema fields in one pass
+     * @param index Table stack index
+     * @throws LuaSchemaMismatch Missing field or type mismatch (with field path)
+     * @throws LuaParseLimitExceeded Lua stack limit exceeded
+     * @return Table map with schema fields only (lists are table lists)
+     */
+    LuaArgument extract(int index) const;
+
+    /**
+     * @brief Validate table without extraction
+     * @param index Table stack index
+     * @param path Failed field path output (optional)
+     * @return true, if table matches schema
+     */
+    bool validate(int index, std::string *path = nullptr) const;
+
+    ~LuaCompiledSchema();
+
+private:
+    /// Instruction operation
+    enum class Opcode
+    {
+        Scalar,             ///< Get field, check type and store it
+        Record,             ///< Get field and enter nested record
+        ScalarList,         ///< Get field and read elements 1..n
+        RecordList,         ///< Get field and enter every element record
+        End,                ///< Leave record
+    };
+
+    /// Flat schema instruction
+    struct Instruction
+    {
+        Opcode opcode;
+        int key;                                    ///< Interned key registry reference
+        size_t name;                                ///< Field name index
+        LuaArgumentType type;                       ///< Scalar (or list element) type
+        bool optional;                              ///< Field may be nil
+        size_t end;                                 ///< Block End instruction (Record, RecordList)
+    };
+
+    /**
+     * @brief Emit schema instructions
+     * @param schema Record schema
+     * @param depth Stack slots used by parent tables
+     * @param interned Already interned keys
+     */
+    void emit(const LuaSchema &schema, unsigned int depth, std::unordered_map<std::string, int> &interned);
+
+    /**
+     * @brief Run instructions
+     * @param index Table stack index
+     * @param store Extract values
+     * @throws LuaSchemaMismatch
+     */
+    LuaArgument run(int index, bool store) const;
+
+    /**
+     * @brief Release interned keys
+     */
+    void release() noexcept;
+
+    lua_State *luaVm;                               ///< Original VM
+    std::vector<Instruction> instructions;          ///< Flat program
+    std::vector<std::string> names;                 ///< Field names
+    std::vector<LuaArgument> nameArguments;         ///< Field names as result keys
+    std::vector<int> keys;                          ///< Interned keys registry references
+    unsigned int maxDepth = 0;                      ///< Maximum stack slots used by nested tables
+};
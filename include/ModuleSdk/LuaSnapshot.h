@@ -0,0 +1,197 @@
+#pragma once
+
+#include "LuaArgument.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+
+/**
+ * @brief Opaque userdata handle stored in snapshots
+ * @details Can't be dereferenced, only turned back into userdata on the main thread (LuaSnapshot::View::toArgument)
+ */
+struct LuaSnapshotHandle
+{
+    uintptr_t value;
+};
+
+inline bool operator==(const LuaSnapshotHandle &left, const LuaSnapshotHandle &right)
+{
+    return left.value == right.value;
+}
+
+
+/**
+ * @brief Detached immutable copy of LuaArgument tree
+ * @details The whole tree (nodes, strings, typed arrays) lives in one contiguous allocation,
+ * so building takes one allocation and freeing is one operation. Userdata are stored as opaque handles,
+ * so a snapshot never refers to a lua VM. Snapshots are reference counted (atomic) and read without locks,
+ * copies can be passed to any thread.
+ */
+class LuaSnapshot
+{
+private:
+    struct Header;
+    struct Node;
+    struct Builder;
+
+public:
+    /**
+     * @brief Read-only cursor to snapshot node
+     * @details Valid while the snapshot (or any copy of it) is alive
+     */
+    class View
+    {
+    public:
+        LuaTypeIndex getTypeIndex() const;
+
+        LuaArgumentType getType() const
+        {
+            return TYPE_BY_INDEX[static_cast<int>(this->getTypeIndex())];
+        }
+
+        bool isNil() const
+        {
+            return this->getTypeIndex() == LuaTypeIndex::Nil;
+        }
+
+        /**
+         * @brief String length, list items, map pairs or typed array elements amount (0 for other types)
+         */
+        size_t size() const;
+
+        /**
+         * @brief Getters
+         * @throws LuaUnexpectedArgumentType Type mismatch
+         */
+        bool toBool() const;
+
+        double toNumber() const;
+
+        int toInteger() const;
+
+        /**
+         * @brief String getter (null-terminated, see size() for length)
+         * @throws LuaUnexpectedArgumentType Type mismatch
+         */
+        const char *toString() const;
+
+        /**
+         * @brief Userdata or light userdata handle
+         * @throws LuaUnexpectedArgumentType Type mismatch
+         */
+        LuaSnapshotHandle toHandle() const;
+
+        /**
+         * @brief MTASA Object copy
+         * @throws LuaUnexpectedArgumentType Type mismatch
+         */
+        LuaObject toObject() const;
+
+        /**
+         * @brief Typed array data (see size() for elements amount)
+         * @throws LuaUnexpectedArgumentType Type mismatch
+         */
+        const double *toDoubleArray() const;
+
+        const float *toFloatArray() const;
+
+        const int32_t *toInt32Array() const;
+
+        /**
+         * @brief List item
+         * @throws LuaUnexpectedArgumentType Not a list
+         * @throws LuaOutOfRange Index is out of range
+         */
+        View operator[](size_t index) const;
+
+        /**
+         * @brief Map pair key and value
+         * @throws LuaUnexpectedArgumentType Not a map
+         * @throws LuaOutOfRange Index is out of range
+         */
+        View getKey(size_t index) const;
+
+        View getValue(size_t index) const;
+
+        /**
+         * @brief Find map value by string key (linear search)
+         * @throws LuaUnexpectedArgumentType Not a map
+         * @return Value or nil view
+         */
+        View find(const std::string &key) const;
+
+        /**
+         * @brief Build LuaArgument (handles become userdata again)
+         */
+        LuaArgument toArgument() const;
+
+    private:
+        friend class LuaSnapshot;
+
+        View(const Node *node, const Header *block)
+            : node(node), block(block)
+        {}
+
+        /**
+         * @throws LuaUnexpectedArgumentType Node has another type
+         */
+        void check(LuaTypeIndex type) const;
+
+        View child(size_t index) const;
+
+        const char *getBytes() const;
+
+        const Node *node;
+        const Header *block;
+    };
+
+    /**
+     * @brief Nil snapshot
+     */
+    LuaSnapshot() = default;
+
+    /**
+     * @brief Snapshot argument tree
+     * @throws LuaOutOfRange String or table is too big (more than 2^32 bytes or elements)
+     */
+    explicit LuaSnapshot(const LuaArgument &argument);
+
+    LuaSnapshot(const LuaSnapshot &snapshot) noexcept;
+
+    LuaSnapshot(LuaSnapshot &&snapshot) noexcept
+        : block(snapshot.block)
+    {
+        snapshot.block = nullptr;
+    }
+
+    LuaSnapshot &operator=(const LuaSnapshot &snapshot) noexcept;
+
+    LuaSnapshot &operator=(LuaSnapshot &&snapshot) noexcept;
+
+    /**
+     * @brief Root node
+     */
+    View getRoot() const;
+
+    /**
+     * @brief Allocated bytes amount (0 for nil snapshot)
+     */
+    size_t getMemorySize() const;
+
+    LuaArgument toArgument() const
+    {
+        return this->getRoot().toArgument();
+    }
+
+    ~LuaSnapshot();
+
+private:
+    /**
+     * @brief Drop reference, free the block by the last one
+     */
+    void release() noexcept;
+
+    Header *block = nullptr;
+};
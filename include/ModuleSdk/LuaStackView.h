@@ -0,0 +1,294 @@
+#pragma once
+
+#include "LuaArgument.h"
+#include "lua/lua.h"
+#include <cstddef>
+#include <iterator>
+
+
+/**
+ * @brief Non-owning reference to a single lua stack slot
+ * @details Accessors read the slot in place and do not allocate.
+ * Type checks are the same as LuaVmExtended::parseArgument checks (e.g. numeric strings are numbers).
+ */
+class LuaStackValue
+{
+public:
+    /**
+     * @brief Constructor
+     * @param luaVm Lua VM pointer
+     * @param index Absolute stack index
+     */
+    LuaStackValue(lua_State *luaVm, int index)
+        : luaVm(luaVm), index(index)
+    {}
+
+    /**
+     * @brief Stack index getter
+     */
+    int getIndex() const
+    {
+        return index;
+    }
+
+    /**
+     * @brief Lua type of the slot (tables are LuaTypeTableMap)
+     */
+    LuaArgumentType getType() const
+    {
+        return static_cast<LuaArgumentType>(lua_type(luaVm, index));
+    }
+
+    bool isNil() const
+    {
+        return lua_isnil(luaVm, index);
+    }
+
+    bool isBool() const
+    {
+        return lua_isboolean(luaVm, index);
+    }
+
+    bool isNumber() const
+    {
+        return lua_isnumber(luaVm, index) != 0;
+    }
+
+    bool isString() const
+    {
+        return lua_isstring(luaVm, index) != 0;
+    }
+
+    bool isTable() const
+    {
+        return lua_istable(luaVm, index);
+    }
+
+    bool isUserdata() const
+    {
+        return lua_isuserdata(luaVm, index) != 0;
+    }
+
+    /**
+     * @brief Boolean getter
+     * @throws LuaUnexpectedType Type mismatch
+     */
+    bool toBool() const;
+
+    /**
+     * @brief Number getter
+     * @throws LuaUnexpectedType Type mismatch
+     */
+    double toNumber() const;
+
+    /**
+     * @brief Integer getter
+     * @throws LuaUnexpectedType Type mismatch
+     */
+    int toInteger() const;
+
+    /**
+     * @brief String getter. Pointer is valid while the value stays on the stack
+     * @details Numbers are converted to strings in place (lua_tolstring behaviour)
+     * @param length Output string length (optional)
+     * @throws LuaUnexpectedType Type mismatch
+     */
+    const char *toString(size_t *length = nullptr) const;
+
+    /**
+     * @brief Userdata (or lightuserdata) pointer getter
+     * @throws LuaUnexpectedType Type mismatch
+     */
+    void *toPointer() const;
+
+    /**
+     * @brief Parse value into LuaArgument (types autodetect, default parse options)
+     * @throws LuaBadType Bad type has been captured
+     */
+    LuaArgument parse() const;
+
+private:
+    lua_State *luaVm;                               ///< Original VM
+    int index;                                      ///< Absolute stack index
+};
+
+/**
+ * @brief Non-owning range over lua stack slots (arguments by default)
+ * @details Range is fixed on construction, so values pushed later are not included
+ */
+class LuaStackView
+{
+public:
+    /**
+     * @brief Random access iterator over stack slots
+     */
+    class Iterator
+    {
+    public:
+        using iterator_category = std::random_access_iterator_tag;
+        using value_type = LuaStackValue;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = LuaStackValue;
+
+        Iterator(lua_State *luaVm, int index)
+            : luaVm(luaVm), index(index)
+        {}
+
+        LuaStackValue operator*() const
+        {
+            return LuaStackValue(luaVm, index);
+        }
+
+        LuaStackValue operator[](difference_type offset) const
+        {
+            return LuaStackValue(luaVm, index + static_cast<int>(offset));
+        }
+
+        Iterator &operator++()
+        {
+            index++;
+            return *this;
+        }
+
+        Iterator operator++(int)
+        {
+            Iterator old = *this;
+            index++;
+            return old;
+        }
+
+        Iterator &operator--()
+        {
+            index--;
+            return *this;
+        }
+
+        Iterator operator--(int)
+        {
+            Iterator old = *this;
+            index--;
+            return old;
+        }
+
+        Iterator &operator+=(difference_type offset)
+        {
+            index += static_cast<int>(offset);
+            return *this;
+        }
+
+        Iterator &operator-=(difference_type offset)
+        {
+            index -= static_cast<int>(offset);
+            return *this;
+        }
+
+        Iterator operator+(difference_type offset) const
+        {
+            return Iterator(luaVm, index + static_cast<int>(offset));
+        }
+
+        Iterator operator-(difference_type offset) const
+        {
+            return Iterator(luaVm, index - static_cast<int>(offset));
+        }
+
+        difference_type operator-(const Iterator &other) const
+        {
+            return index - other.index;
+        }
+
+        bool operator==(const Iterator &other) const
+        {
+            return index == other.index;
+        }
+
+        bool operator!=(const Iterator &other) const
+        {
+            return index != other.index;
+        }
+
+        bool operator<(const Iterator &other) const
+        {
+            return index < other.index;
+        }
+
+        bool operator>(const Iterator &other) const
+        {
+            return index > other.index;
+        }
+
+        bool operator<=(const Iterator &other) const
+        {
+            return index <= other.index;
+        }
+
+        bool operator>=(const Iterator &other) const
+        {
+            return index >= other.index;
+        }
+
+    private:
+        lua_State *luaVm;                           ///< Original VM
+        int index;                                  ///< Absolute stack index
+    };
+
+    /**
+     * @brief Constructor. View over all stack slots (function arguments)
+     * @param luaVm Lua VM pointer
+     */
+    explicit LuaStackView(lua_State *luaVm)
+        : LuaStackView(luaVm, 1, lua_gettop(luaVm))
+    {}
+
+    /**
+     * @brief Constructor
+     * @param luaVm Lua VM pointer
+     * @param first First absolute stack index
+     * @param last Last absolute stack index (inclusive)
+     */
+    LuaStackView(lua_State *luaVm, int first, int last)
+        : luaVm(luaVm), first(first), last(last < first ? first - 1 : last)
+    {}
+
+    size_t size() const
+    {
+        return static_cast<size_t>(last - first + 1);
+    }
+
+    bool empty() const
+    {
+        return last < first;
+    }
+
+    /**
+     * @brief Value getter (without range check)
+     * @param position Position in view (starts from 0)
+     */
+    LuaStackValue operator[](size_t position) const
+    {
+        return LuaStackValue(luaVm, first + static_cast<int>(position));
+    }
+
+    /**
+     * @brief Value getter
+     * @param position Position in view (starts from 0)
+     * @throws LuaOutOfRange Position is out of view
+     */
+    LuaStackValue at(size_t position) const;
+
+    Iterator begin() const
+    {
+        return Iterator(luaVm, first);
+    }
+
+    Iterator end() const
+    {
+        return Iterator(luaVm, last + 1);
+    }
+
+private:
+    lua_State *luaVm;                               ///< Original VM
+    int first;                                      ///< First absolute stack index
+    int last;                                       ///< Last absolute stack index (inclusive)
+};
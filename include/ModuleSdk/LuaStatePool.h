@@ -0,0 +1,85 @@
+#pragma once
+
+#include "LuaSnapshot.h"
+#include "LuaTaskPool.h"
+#include "lua/lua.h"
+#include <cstddef>
+#include <string>
+
+
+/**
+ * @brief Private lua states on worker threads for pure lua computations
+ * @details Every worker thread owns a sandboxed lua state (base without file access, table, string and math libraries).
+ * Resources submit lua chunks, which are called with the snapshot arguments as `...`.
+ * Every call runs in a fresh environment with read-only access to the libraries, so calls of different resources
+ * on the same state see nothing of each other. Binary chunks are rejected (also by loadstring),
+ * load, getfenv and setfenv are not available.
+ * Results are delivered on pulse as callback(true, results...) or callback(false, errorMessage).
+ * Worker states share nothing with resource VMs: userdata are passed as opaque light userdata
+ * and results can't contain full userdata. Compiled chunks are cached per state.
+ */
+class LuaStatePool
+{
+public:
+    /**
+     * @brief Constructor. Threads and states are created on the first submit
+     * @param threads Worker threads amount (0 means hardware concurrency)
+     * @param instructionsLimit Chunk call instructions limit (0 means unlimited)
+     * @param chunksCacheSize Compiled chunks per state (cache is reset, when exceeded)
+     */
+    explicit LuaStatePool(unsigned int threads = 0, size_t instructionsLimit = 0, size_t chunksCacheSize = 64);
+
+    LuaStatePool(const LuaStatePool &) = delete;
+
+    LuaStatePool &operator=(const LuaStatePool &) = delete;
+
+    /**
+     * @brief Run chunk on a worker state and call lua function with its results on pulse
+     * @param luaVm Lua VM pointer
+     * @param callbackIndex Callback stack index
+     * @param code Lua chunk source
+     * @param arguments Chunk arguments list (or nil snapshot)
+     * @throws LuaBadType Callback is not a function
+     */
+    void submit(lua_State *luaVm, int callbackIndex, std::string code, LuaSnapshot arguments);
+
+    /**
+     * @brief Deliver finished chunks results (call from DoPulse)
+     * @return Called callbacks amount
+     */
+    size_t pulse()
+    {
+        return pool.pulse();
+    }
+
+    /**
+     * @brief Drop callbacks of the stopped resource (call from ResourceStopped)
+     */
+    void resourceStopped(lua_State *luaVm)
+    {
+        pool.resourceStopped(luaVm);
+    }
+
+    /**
+     * @brief Lua: runWorker(code, callback, arguments...) -> true or false, error message
+     */
+    int luaRun(lua_State *luaVm);
+
+    size_t getPending() const
+    {
+        return pool.getPending();
+    }
+
+    /**
+     * @brief Set handler of errors raised by callbacks (errors are ignored by default)
+     */
+    void setErrorHandler(LuaTaskPool::ErrorHandler handler)
+    {
+        pool.setErrorHandler(std::move(handler));
+    }
+
+private:
+    LuaTaskPool pool;
+    size_t instructionsLimit;
+    size_t chunksCacheSize;
+};
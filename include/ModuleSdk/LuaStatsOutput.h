@@ -0,0 +1,59 @@
+#pragma once
+
+#include "lua/lua.h"
+#include <functional>
+#include <string>
+
+
+/**
+ * @brief Output shared by statistics collectors: lua counters tables, number formatting and dump files
+ * @details Files written on behalf of lua go to the dump directory, lua passes only a file name
+ */
+class LuaStatsOutput
+{
+public:
+    /**
+     * @brief Directory of files written by lua (default is the working directory)
+     */
+    void setDumpDirectory(std::string directory)
+    {
+        dumpDirectory = std::move(directory);
+    }
+
+    /**
+     * @brief Format number with printf format (e.g. "%.1f")
+     */
+    static std::string formatNumber(const char *format, double value);
+
+    /**
+     * @brief Set number field of the table on the stack top
+     */
+    static void pushCounter(lua_State *luaVm, const char *name, double value);
+
+    /**
+     * @brief Replace file contents
+     * @return false, if the file can't be written
+     */
+    static bool writeFile(const std::string &path, const std::string &text);
+
+protected:
+    LuaStatsOutput() = default;
+
+    /**
+     * @brief Lua: write file named by the argument in the dump directory -> true or false, error message
+     * @details The file name can't contain directories
+     * @param index File name stack index
+     * @param dump Writes the file by path, returns false on failure
+     * @return lua_CFunction return value
+     */
+    int luaDumpFile(lua_State *luaVm, int index, const std::function<bool(const std::string &path)> &dump) const;
+
+    /**
+     * @brief Push false, error message
+     * @return Pushed values amount
+     */
+    static int pushError(lua_State *luaVm, const std::string &message);
+
+private:
+    std::string dumpDirectory = ".";
+};
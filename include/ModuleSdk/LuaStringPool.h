@@ -0,0 +1,103 @@
+#pragma once
+
+#include "LuaArgument.h"
+#include "lua/lauxlib.h"
+#include "lua/lua.h"
+#include <cstddef>
+#include <unordered_map>
+
+
+/**
+ * @brief Interning pool for repeated strings (see LuaVmExtended::setStringPool)
+ * @details Parsed strings with the same contents share one immutable storage with precomputed hash,
+ * so record keys are allocated once per pool instead of once per record.
+ * Pushed pool strings are pinned in the lua registry, so lua does not hash them again. The registry is shared
+ * by the VM threads, so strings are pushed onto any of them (coroutines included).
+ * Pool must not outlive the lua VM it was created for.
+ */
+class LuaStringPool
+{
+public:
+    /**
+     * @brief Constructor
+     * @param luaVm Lua VM main thread (releases registry references)
+     * @param maxLength Longer strings are not interned
+     * @param maxSize Maximum interned strings amount (new strings are not interned after that)
+     */
+    explicit LuaStringPool(lua_State *luaVm, size_t maxLength = 64, size_t maxSize = 1u << 16)
+        : luaVm(luaVm), maxLength(maxLength), maxSize(maxSize)
+    {}
+
+    LuaStringPool(const LuaStringPool &) = delete;
+
+    LuaStringPool &operator=(const LuaStringPool &) = delete;
+
+    /**
+     * @brief Get interned string
+     * @param data String contents
+     * @param length String length
+     * @return String argument (shares storage with previous results for the same contents)
+     */
+    LuaArgument intern(const char *data, size_t length);
+
+    /**
+     * @brief Push string from the registry cache
+     * @param target Thread of the pool VM, which gets the string
+     * @param argument String argument
+     * @return false, if string is not interned (nothing is pushed)
+     */
+    bool push(lua_State *target, const LuaArgument &argument);
+
+    /**
+     * @brief Interned strings amount
+     */
+    size_t size() const
+    {
+        return strings.size();
+    }
+
+    /**
+     * @brief Forget interned strings and release registry references
+     * @details Already parsed arguments stay valid
+     */
+    void clear() noexcept;
+
+    ~LuaStringPool()
+    {
+        this->clear();
+    }
+
+private:
+    /// Pool key (points to interned string contents)
+    struct Key
+    {
+        const char *data;
+        size_t length;
+        size_t hash;
+    };
+
+    struct KeyHash
+    {
+        size_t operator()(const Key &key) const
+        {
+            return key.hash;
+        }
+    };
+
+    struct KeyEqual
+    {
+        bool operator()(const Key &left, const Key &right) const;
+    };
+
+    /// Interned string
+    struct Entry
+    {
+        LuaArgument string;
+        int reference;                              ///< Registry reference (LUA_NOREF, if not pushed yet)
+    };
+
+    lua_State *luaVm;                               ///< Original VM
+    size_t maxLength;                               ///< Longer strings are not interned
+    size_t maxSize;                                 ///< Maximum interned strings amount
+    std::unordered_map<Key, Entry, KeyHash, KeyEqual> strings;
+};
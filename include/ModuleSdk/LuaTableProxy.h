@@ -0,0 +1,162 @@
+#pragma once
+
+#include "LuaArgument.h"
+#include "lua/lauxlib.h"
+#include "lua/lua.h"
+
+
+/**
+ * @brief Lazy registry-backed reference to a Lua table
+ * @details Table is pinned with luaL_ref and fields are fetched on access (raw access, no metamethods).
+ * Only explicitly requested subtrees are materialized into LuaArgument.
+ * Proxy must not outlive the lua VM it was created for.
+ */
+class LuaTableProxy
+{
+public:
+    /**
+     * @brief Constructor. Pins table
+     * @param luaVm Lua VM pointer
+     * @param index Table stack index
+     * @throws LuaUnexpectedType Value at index is not a table
+     */
+    LuaTableProxy(lua_State *luaVm, int index);
+
+    LuaTableProxy(const LuaTableProxy &) = delete;
+
+    LuaTableProxy &operator=(const LuaTableProxy &) = delete;
+
+    /**
+     * @brief Move constructor
+     */
+    LuaTableProxy(LuaTableProxy &&proxy) noexcept
+        : luaVm(proxy.luaVm), reference(proxy.reference)
+    {
+        proxy.reference = LUA_NOREF;
+    }
+
+    /**
+     * @brief Move assignment
+     */
+    LuaTableProxy &operator=(LuaTableProxy &&proxy) noexcept
+    {
+        this->release();
+        this->luaVm = proxy.luaVm;
+        this->reference = proxy.reference;
+        proxy.reference = LUA_NOREF;
+
+        return *this;
+    }
+
+    /**
+     * @brief Get field by key and materialize it (nested tables are parsed completely)
+     * @param key Field key
+     * @throws LuaOutOfRange Proxy has been released
+     * @throws LuaBadType Bad type has been captured
+     * @return Field value (nil, if field does not exist)
+     */
+    LuaArgument get(const LuaArgument &key) const;
+
+    /**
+     * @brief Get array field and materialize it (nested tables are parsed completely)
+     * @param index Array index (starts from 1)
+     * @throws LuaOutOfRange Proxy has been released
+     * @throws LuaBadType Bad type has been captured
+     * @return Field value (nil, if field does not exist)
+     */
+    LuaArgument getByIndex(int index) const;
+
+    /**
+     * @brief Get nested table by key without parsing it
+     * @param key Field key
+     * @throws LuaOutOfRange Proxy has been released
+     * @throws LuaUnexpectedType Field is not a table
+     * @return Nested table proxy
+     */
+    LuaTableProxy getTable(const LuaArgument &key) const;
+
+    /**
+     * @brief Get nested table by array index without parsing it
+     * @param index Array index (starts from 1)
+     * @throws LuaOutOfRange Proxy has been released
+     * @throws LuaUnexpectedType Field is not a table
+     * @return Nested table proxy
+     */
+    LuaTableProxy getTableByIndex(int index) const;
+
+    /**
+     * @brief Get field lua type without parsing it
+     * @param key Field key
+     * @throws LuaOutOfRange Proxy has been released
+     * @return Field type (LuaTypeNil, if field does not exist)
+     */
+    LuaArgumentType getType(const LuaArgument &key) const;
+
+    /**
+     * @brief Is field exists
+     * @param key Field key
+     * @throws LuaOutOfRange Proxy has been released
+     * @return true, if field is not nil
+     */
+    bool has(const LuaArgument &key) const
+    {
+        return this->getType(key) != LuaArgumentType::LuaTypeNil;
+    }
+
+    /**
+     * @brief Array part length (lua # operator without metamethods)
+     * @throws LuaOutOfRange Proxy has been released
+     */
+    size_t size() const;
+
+    /**
+     * @brief Parse whole table
+     * @throws LuaOutOfRange Proxy has been released
+     * @throws LuaBadType Bad type has been captured
+     * @return Table map argument
+     */
+    LuaArgument materialize() const;
+
+    /**
+     * @brief Push referenced table to lua VM
+     * @throws LuaOutOfRange Proxy has been released
+     */
+    void push() const;
+
+    /**
+     * @brief Is proxy still holds the table
+     */
+    bool isValid() const
+    {
+        return this->reference != LUA_NOREF;
+    }
+
+    /**
+     * @brief Releases registry reference. Proxy becomes invalid
+     */
+    void release() noexcept;
+
+    /**
+     * @brief Destructor. Releases registry reference
+     */
+    ~LuaTableProxy()
+    {
+        this->release();
+    }
+
+private:
+    /**
+     * @brief Push referenced table and the field by key
+     * @details Stack after call: table, value
+     */
+    void pushField(const LuaArgument &key) const;
+
+    /**
+     * @brief Push referenced table and the array field by index
+     * @details Stack after call: table, value
+     */
+    void pushFieldByIndex(int index) const;
+
+    lua_State *luaVm;                               ///< Original VM
+    int reference = LUA_NOREF;                      ///< Registry reference
+};
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "LuaStackView.h"
+
+
+/// Walker reaction on visitor callback
+enum class LuaWalkAction
+{
+    Continue,           ///< Go on
+    Skip,               ///< Skip subtree (see callback description)
+    Stop,               ///< Stop walking
+};
+
+/// Table pairs traversal order
+enum class LuaWalkOrder
+{
+    Next,               ///< All pairs in lua_next order
+    Sequence,           ///< Root keys 1..n until the first nil (ipairs order), nested tables in Next order
+};
+
+/**
+ * @brief Table walker callbacks (see LuaVmExtended::walkTable)
+ * @details Values are passed as stack slots, so nothing is parsed or allocated by the walker.
+ * Callbacks must keep the lua stack balanced and must not convert keys in place
+ * (LuaStackValue::toString on number key breaks lua_next).
+ * Depth of the root table is 0. Key and value callbacks receive depth of the table they belong to.
+ */
+class LuaTableVisitor
+{
+public:
+    /**
+     * @brief Table is entered
+     * @return Skip: do not visit table contents (endTable is not called)
+     */
+    virtual LuaWalkAction beginTable(const LuaStackValue & /*table*/, unsigned int /*depth*/)
+    {
+        return LuaWalkAction::Continue;
+    }
+
+    /**
+     * @brief Key is found
+     * @return Skip: do not visit the value
+     */
+    virtual LuaWalkAction key(const LuaStackValue & /*key*/, unsigned int /*depth*/)
+    {
+        return LuaWalkAction::Continue;
+    }
+
+    /**
+     * @brief Not a table value is found
+     * @return Skip: skip the rest of the current table (endTable is called)
+     */
+    virtual LuaWalkAction value(const LuaStackValue & /*value*/, unsigned int /*depth*/)
+    {
+        return LuaWalkAction::Continue;
+    }
+
+    /**
+     * @brief Table contents are visited
+     * @return Skip: skip the rest of the parent table
+     */
+    virtual LuaWalkAction endTable(unsigned int /*depth*/)
+    {
+        return LuaWalkAction::Continue;
+    }
+
+    virtual ~LuaTableVisitor() = default;
+};
@@ -0,0 +1,127 @@
+#pragma once
+
+#include "LuaArgument.h"
+#include "LuaCompletionQueue.h"
+#include "lua/lua.h"
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+
+/**
+ * @brief Worker thread pool with lua callbacks delivered on the main thread
+ * @details Jobs run on worker threads and must not touch lua VMs.
+ * Results are passed back through a lock-free queue and callbacks are called from pulse()
+ * as callback(true, results...) or callback(false, errorMessage).
+ * submit, pulse and resourceStopped must be called from the main thread (e.g. lua functions, DoPulse, ResourceStopped).
+ */
+class LuaTaskPool
+{
+public:
+    using Job = std::function<std::vector<LuaArgument>()>;
+    using ErrorHandler = std::function<void(lua_State *luaVm, const std::string &message)>;
+
+    /**
+     * @brief Constructor. Threads are started on the first submit
+     * @param threads Worker threads amount (0 means hardware concurrency)
+     */
+    explicit LuaTaskPool(unsigned int threads = 0);
+
+    LuaTaskPool(const LuaTaskPool &) = delete;
+
+    LuaTaskPool &operator=(const LuaTaskPool &) = delete;
+
+    /**
+     * @brief Run job on a worker thread and call lua function with its results on pulse
+     * @param luaVm Lua VM pointer
+     * @param callbackIndex Callback stack index
+     * @param job Job (exceptions are delivered as error messages)
+     * @throws LuaBadType Callback is not a function
+     */
+    void submit(lua_State *luaVm, int callbackIndex, Job job);
+
+    /**
+     * @brief Deliver finished jobs results (call from DoPulse)
+     * @return Called callbacks amount
+     */
+    size_t pulse();
+
+    /**
+     * @brief Drop callbacks of the stopped resource (call from ResourceStopped)
+     * @details Running jobs are finished, but their results are dropped without touching the VM
+     */
+    void resourceStopped(lua_State *luaVm);
+
+    /**
+     * @brief Submitted, but not delivered jobs amount
+     */
+    size_t getPending() const
+    {
+        return pending;
+    }
+
+    /**
+     * @brief Set handler of errors raised by callbacks (errors are ignored by default)
+     */
+    void setErrorHandler(ErrorHandler handler)
+    {
+        errorHandler = std::move(handler);
+    }
+
+    /**
+     * @brief Destructor. Waits for running jobs, queued jobs and results are dropped
+     */
+    ~LuaTaskPool();
+
+private:
+    /// Submitted job
+    struct Task
+    {
+        Job job;
+        lua_State *luaVm;
+        int callback;                               ///< Callback registry reference
+        uint64_t epoch;                             ///< VM epoch at submit time
+    };
+
+    /// Finished job
+    struct Completion
+    {
+        lua_State *luaVm;
+        int callback;                               ///< Callback registry reference
+        uint64_t epoch;                             ///< VM epoch at submit time
+        bool success;
+        std::vector<LuaArgument> results;
+        std::string error;
+    };
+
+    /**
+     * @brief Worker thread loop
+     */
+    void work();
+
+    /**
+     * @brief Start worker threads
+     */
+    void start();
+
+    unsigned int threadsAmount;                     ///< Worker threads amount
+    std::vector<std::thread> workers;
+    std::mutex mutex;                               ///< Protects tasks and stopping
+    std::condition_variable condition;              ///< Task has been added or pool is stopping
+    std::deque<Task> tasks;                         ///< Queued jobs
+    bool stopping = false;
+    LuaCompletionQueue<Completion> completions;     ///< Finished jobs (lock-free)
+
+    // Main thread state
+    std::unordered_map<lua_State *, uint64_t> epochs;   ///< Current epoch of running VMs
+    uint64_t nextEpoch = 1;
+    size_t pending = 0;
+    ErrorHandler errorHandler;
+};
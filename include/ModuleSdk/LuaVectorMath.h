@@ -0,0 +1,135 @@
+#pragma once
+
+#include "LuaArgument.h"
+#include "lua/lua.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+/// Instruction set used by vector math kernels
+enum class LuaVectorMathBackend
+{
+    Scalar,             ///< Portable fallback
+    Sse,                ///< 4 points per iteration
+    Avx,                ///< 8 points per iteration
+};
+
+/**
+ * @brief Batch vector math over packed float3 arrays ({x1, y1, z1, x2, y2, z2, ...})
+ * @details Kernels are selected once at runtime by CPU features (see getBackend).
+ * All backends return the same results. Result indices start from 1 (lua arrays).
+ * Lua functions parse points as LuaTypeFloatArray and push results as typed arrays,
+ * on bad arguments they return false and error message. Large distance batches are split between
+ * threads of LuaParallel::getDefault().
+ */
+class LuaVectorMath
+{
+public:
+    /**
+     * @brief Active backend getter
+     */
+    static LuaVectorMathBackend getBackend();
+
+    /**
+     * @brief Force backend (e.g. for benchmarks)
+     * @return false, if backend is not supported by CPU (backend is not changed)
+     */
+    static bool setBackend(LuaVectorMathBackend backend);
+
+    /**
+     * @brief Check CPU support of backend
+     */
+    static bool isSupported(LuaVectorMathBackend backend);
+
+    /**
+     * @brief Distances from every point to origin
+     * @param points Packed points (3 * count floats)
+     * @param count Points amount
+     * @param origin Origin point (3 floats)
+     * @param result Output distances (count floats)
+     */
+    static void distances(const float *points, size_t count, const float *origin, float *result);
+
+    /**
+     * @brief Distances between points with the same index
+     * @param left Packed points (3 * count floats)
+     * @param right Packed points (3 * count floats)
+     * @param count Points amount
+     * @param result Output distances (count floats)
+     */
+    static void pairDistances(const float *left, const float *right, size_t count, float *result);
+
+    /**
+     * @brief Points within radius (inclusive)
+     * @param points Packed points (3 * count floats)
+     * @param count Points amount
+     * @param origin Sphere center (3 floats)
+     * @param radius Sphere radius
+     * @param result Output indices (up to count)
+     * @return Found points amount
+     */
+    static size_t withinRadius(const float *points, size_t count, const float *origin, float radius, int32_t *result);
+
+    /**
+     * @brief Points inside axis-aligned box (inclusive)
+     * @param points Packed points (3 * count floats)
+     * @param count Points amount
+     * @param min Box minimum corner (3 floats)
+     * @param max Box maximum corner (3 floats)
+     * @param result Output indices (up to count)
+     * @return Found points amount
+     */
+    static size_t insideBox(const float *points, size_t count, const float *min, const float *max, int32_t *result);
+
+    /**
+     * @brief Nearest points, closest first (equal distances are ordered by index)
+     * @param points Packed points (3 * count floats)
+     * @param count Points amount
+     * @param origin Origin point (3 floats)
+     * @param k Maximum result size
+     * @param result Output indices (up to k)
+     * @return Found points amount
+     */
+    static size_t nearest(const float *points, size_t count, const float *origin, size_t k, int32_t *result);
+
+    /**
+     * @brief Lua: (points, x, y, z) -> distances
+     */
+    static int luaDistances(lua_State *luaVm);
+
+    /**
+     * @brief Lua: (points, otherPoints) -> distances
+     */
+    static int luaPairDistances(lua_State *luaVm);
+
+    /**
+     * @brief Lua: (points, x, y, z, radius) -> indices
+     */
+    static int luaWithinRadius(lua_State *luaVm);
+
+    /**
+     * @brief Lua: (points, minX, minY, minZ, maxX, maxY, maxZ) -> indices
+     */
+    static int luaInsideBox(lua_State *luaVm);
+
+    /**
+     * @brief Lua: (points, x, y, z, k) -> indices
+     */
+    static int luaNearest(lua_State *luaVm);
+
+    /**
+     * @brief Lua functions with default names (for ILuaModuleManager10::RegisterFunction)
+     */
+    static const std::vector<std::pair<std::string, lua_CFunction>> &getLuaFunctions();
+
+private:
+    /**
+     * @brief Parse packed points argument
+     * @throws LuaUnexpectedType Argument is not a sequence of numbers
+     * @throws LuaOutOfRange Array size is not a multiple of 3
+     */
+    static LuaArgument parsePoints(lua_State *luaVm, int index);
+};
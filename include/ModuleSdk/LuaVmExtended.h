@@ -1,12 +1,31 @@
 #pragma once
 
 #include "LuaArgument.h"
+#include "LuaMemoryTelemetry.h"
+#include "LuaPushPlan.h"
+#include "LuaStackView.h"
+#include "LuaStringPool.h"
+#include "LuaTableVisitor.h"
+#include "LuaTableProxy.h"
 #include "lua/lua.h"
+#include <cstddef>
 #include <list>
 #include <unordered_map>
 #include <vector>
 
 
+/**
+ * @brief Table parsing limits
+ */
+struct LuaParseOptions
+{
+    unsigned int maxDepth = 64;             ///< Maximum nested tables depth
+    size_t maxNodes = 1u << 22;             ///< Maximum parsed keys and values amount (per argument)
+    bool breakCycles = false;               ///< Replace cyclic references with nil instead of throwing
+    bool shareReferences = false;           ///< Parse repeated tables once and share parsed storage
+    bool numberArrays = false;              ///< Parse sequences of numbers 1..n as LuaTypeDoubleArray
+};
+
 /**
  * @brief Extends lua_State functional
  */
@@ -27,6 +46,15 @@ public:
      */
     std::vector<LuaArgument> getArguments();
 
+    /**
+     * @brief View over all arguments without parsing them
+     * @return Arguments stack view
+     */
+    LuaStackView getArgumentsView() const
+    {
+        return LuaStackView(luaVm);
+    }
+
     /**
      * @brief Parse arguments from lua VM
      * @param types Strictly assigned types list
@@ -43,6 +71,7 @@ public:
      * @param begin Begin iterator
      * @param end End iterator
      * @throws LuaUnexpectedPushType Passed argument type is not supported
+     * @throws LuaOutOfRange Lua stack cannot be grown
      * @return Size of pushed list
      */
     template<
@@ -53,9 +82,16 @@ public:
     >
     int pushArguments(IT begin, IT end) const
     {
+        LuaMemoryTelemetry::Attribution attribution;
+        LuaPushPlan plan;
+        for (IT it = begin; it != end; it++) {
+            plan.add(*it);
+        }
+        reserveStack(plan);
+
         int size = 0;
         for (IT it = begin; it != end; it++) {
-            pushArgument(*it);
+            pushArgument(*it, plan);
             size++;
         }
         return size;
@@ -64,6 +100,7 @@ public:
     /**
      * @brief Push single argument to lua VM
      * @throws LuaUnexpectedPushType Passed argument type is not supported
+     * @throws LuaOutOfRange Lua stack cannot be grown
      */
     void pushArgument(const LuaArgument &argument) const;
 
@@ -86,6 +123,64 @@ public:
      */
     LuaArgument parseArgument(int index, LuaArgumentType type, bool force = false) const;
 
+    /**
+     * @brief Pin table argument without parsing it
+     * @param index Argument index
+     * @throws LuaUnexpectedType Argument is not a table
+     * @return Lazy table proxy
+     */
+    LuaTableProxy getTableProxy(int index) const
+    {
+        return LuaTableProxy(luaVm, index);
+    }
+
+    /**
+     * @brief Visit table without building LuaArgument tree
+     * @details Table keys are not entered. Depth limit and cycles handling are taken from parse options.
+     * @param index Table index
+     * @param visitor Callbacks
+     * @param order Pairs traversal order
+     * @throws LuaUnexpectedType Value at index is not a table
+     * @throws LuaParseLimitExceeded Depth or lua stack limit has been exceeded
+     * @throws LuaTableCycle Table references itself (if cycles are not broken)
+     * @return false, if walking has been stopped by visitor
+     */
+    bool walkTable(int index, LuaTableVisitor &visitor, LuaWalkOrder order = LuaWalkOrder::Next) const;
+
+    /**
+     * @brief Table parsing limits getter
+     */
+    const LuaParseOptions &getParseOptions() const
+    {
+        return parseOptions;
+    }
+
+    /**
+     * @brief Table parsing limits setter
+     */
+    void setParseOptions(const LuaParseOptions &newParseOptions)
+    {
+        parseOptions = newParseOptions;
+    }
+
+    /**
+     * @brief String interning pool getter
+     */
+    LuaStringPool *getStringPool() const
+    {
+        return stringPool;
+    }
+
+    /**
+     * @brief String interning pool setter
+     * @details Parsed strings are interned and pool strings are pushed from its registry cache.
+     * Pool must be created for the same lua VM. nullptr disables interning
+     */
+    void setStringPool(LuaStringPool *newStringPool)
+    {
+        stringPool = newStringPool;
+    }
+
     /**
      * @brief Clears lua VM stack
      */
@@ -109,6 +204,15 @@ public:
     std::vector<LuaArgument>
     call(const std::string &function, const std::list<LuaArgument> &functionArgs, int returnSize = 0) const;
 
+    /**
+     * @brief Call lua function pinned in the registry (return values are discarded)
+     * @param reference Registry reference (luaL_ref)
+     * @param functionArgs Arguments
+     * @throws LuaUnexpectedPushType Passed argument type is not supported
+     * @throws LuaCallException Error during function execution
+     */
+    void callReference(int reference, const std::vector<LuaArgument> &functionArgs) const;
+
     virtual ~LuaVmExtended() = default;
 
 private:
@@ -140,6 +244,28 @@ private:
      */
     std::vector<LuaArgument> getCallReturn(const std::list<LuaArgumentType> &types) const;
 
+    /**
+     * @brief Parse table without recursion
+     * @param index Table index
+     * @throws LuaBadType Bad type has been captured
+     * @throws LuaParseLimitExceeded Depth, nodes amount or lua stack limit has been exceeded
+     * @throws LuaTableCycle Table references itself (if cycles are not broken)
+     * @return Table map argument
+     */
+    LuaArgument parseTable(int index) const;
+
+    /**
+     * @brief Reserve stack slots for the planned push
+     * @throws LuaOutOfRange Lua stack cannot be grown
+     */
+    void reserveStack(const LuaPushPlan &plan) const;
+
+    /**
+     * @brief Push single argument using precomputed table sizes
+     * @throws LuaUnexpectedPushType Passed argument type is not supported
+     */
+    void pushArgument(const LuaArgument &argument, LuaPushPlan &plan) const;
+
     /**
      * @brief Push MTASA object to stack
      * @author https://github.com/multitheftauto/mtasa-blue/blob/master/Server/mods/deathmatch/logic/lua/LuaCommon.cpp
@@ -147,14 +273,16 @@ private:
     void pushObject(const LuaObject &object) const;
 
     /**
-     * @brief Push transformable to table-list LuaArgument
+     * @brief Push table-list LuaArgument
      */
-    void pushTableList(const LuaArgument &argument) const;
+    void pushTableList(const LuaArgument &argument, LuaPushPlan &plan) const;
 
     /**
-     * @brief Push transformable to table-list LuaArgument
+     * @brief Push table-map LuaArgument
      */
-    void pushTableMap(const LuaArgument &argument) const;
+    void pushTableMap(const LuaArgument &argument, LuaPushPlan &plan) const;
 
     lua_State *luaVm;                               ///< Original VM
+    LuaParseOptions parseOptions;                   ///< Table parsing limits
+    LuaStringPool *stringPool = nullptr;            ///< String interning pool (optional)
 };
@@ -36,4 +36,15 @@ EXTERN_C_BLOCK_START
 
 bool ImportLua();
 
+#ifdef MODULE_SDK_COUNTERS
+/* Imported lua calls of the current thread */
+typedef struct LuaImportsCounters
+{
+  unsigned long long calls;   /* Calls through the imported functions */
+  unsigned long long tables;  /* lua_createtable calls */
+} LuaImportsCounters;
+
+LuaImportsCounters* GetLuaImportsCounters();
+#endif
+
 EXTERN_C_BLOCK_END
\ No newline at end of file
@@ -30,6 +30,7 @@
 #include <dlfcn.h>
 #include <stdarg.h>
 #include "lua/ILuaModuleManager.h"
+#include "lua/LuaImports.h"
 
 EXTERN_C_BLOCK_START
 #include "lua/luaconf.h"
@@ -205,6 +206,12 @@ static void* pluaL_addstring = 0;
 static void* pluaL_addvalue = 0;
 static void* pluaL_pushresult = 0;
 
+/* Standard libraries (optional, used to open private states) */
+static void* pluaopen_base = 0;
+static void* pluaopen_table = 0;
+static void* pluaopen_string = 0;
+static void* pluaopen_math = 0;
+
 
 #define SAFE_IMPORT(x) \
   p ## x = dlsym(dl, #x); \
@@ -214,6 +221,9 @@ static void* pluaL_pushresult = 0;
     return false; \
   }
 
+#define OPTIONAL_IMPORT(x) \
+  p ## x = dlsym(dl, #x);
+
 EXTERN_C bool ImportLua()
 {
 #ifdef ANY_x64
@@ -223,8 +233,22 @@ EXTERN_C bool ImportLua()
 #endif
   if (!dl)
   {
-    pModuleManager->ErrorPrintf("[LuaImports] Unable to open deathmatch.so: %s\n", dlerror());
-    return false;
+    /* Standalone host: lua is exported by the host process itself */
+    const char* error = dlerror();
+    void* process = dlopen(0, RTLD_NOW);
+    void* found = process ? dlsym(process, "lua_newstate") : 0;
+    Dl_info foundInfo;
+    Dl_info ownInfo;
+    if (found
+        && dladdr(found, &foundInfo)
+        && dladdr((void*) &plua_newstate, &ownInfo)
+        && foundInfo.dli_fbase != ownInfo.dli_fbase)   /* Not the wrapper below */
+      dl = process;
+    else
+    {
+      pModuleManager->ErrorPrintf("[LuaImports] Unable to open deathmatch.so: %s\n", error);
+      return false;
+    }
   }
 
   /*
@@ -389,9 +413,18 @@ EXTERN_C bool ImportLua()
   SAFE_IMPORT(luaL_addstring);
   SAFE_IMPORT(luaL_addvalue);
   SAFE_IMPORT(luaL_pushresult);
+
+  /*
+   ** Standard libraries (the server may not export them, opening is skipped then)
+   */
+  OPTIONAL_IMPORT(luaopen_base);
+  OPTIONAL_IMPORT(luaopen_table);
+  OPTIONAL_IMPORT(luaopen_string);
+  OPTIONAL_IMPORT(luaopen_math);
     return true;
 }
 #undef SAFE_IMPORT
+#undef OPTIONAL_IMPORT
 
 /** typedefs **/
 
@@ -578,6 +611,11 @@ typedef void (*luaL_addstring_t)(luaL_Buffer *B, const char *s);
 typedef void (*luaL_addvalue_t)(luaL_Buffer *B);
 typedef void (*luaL_pushresult_t)(luaL_Buffer *B);
 
+typedef int (*luaopen_base_t)(lua_State *ls);
+typedef int (*luaopen_table_t)(lua_State *ls);
+typedef int (*luaopen_string_t)(lua_State *ls);
+typedef int (*luaopen_math_t)(lua_State *ls);
+
 
 /** functions **/
 
@@ -586,8 +624,21 @@ EXTERN_C_BLOCK_START
 /*
 ** state manipulation
 */
-#define LRET(f, ...) return ((f ## _t)p ## f)(__VA_ARGS__)
-#define LCALL(f, ...) ((f ## _t)p ## f)(__VA_ARGS__)
+#ifdef MODULE_SDK_COUNTERS
+static thread_local LuaImportsCounters counters = {0, 0};
+
+LuaImportsCounters* GetLuaImportsCounters()
+{
+  return &counters;
+}
+
+#define LCOUNT() counters.calls++
+#else
+#define LCOUNT()
+#endif
+
+#define LRET(f, ...) LCOUNT(); return ((f ## _t)p ## f)(__VA_ARGS__)
+#define LCALL(f, ...) LCOUNT(); ((f ## _t)p ## f)(__VA_ARGS__)
 lua_State *(lua_newstate) (lua_Alloc f, void *ud)
 {
   LRET(lua_newstate, f, ud);
@@ -846,6 +897,9 @@ void  (lua_rawgeti) (lua_State *ls, int idx, int n)
 
 void  (lua_createtable) (lua_State *ls, int narr, int nrec)
 {
+#ifdef MODULE_SDK_COUNTERS
+  counters.tables++;
+#endif
   LCALL(lua_createtable, ls, narr, nrec);
 }
 
@@ -1243,8 +1297,37 @@ void (luaL_pushresult) (luaL_Buffer *B)
   LCALL(luaL_pushresult, B);
 }
 
+
+/**
+ ** Standard libraries (no-op, if not exported by the server)
+ **/
+int (luaopen_base) (lua_State *ls)
+{
+  if (!pluaopen_base) return 0;
+  LRET(luaopen_base, ls);
+}
+
+int (luaopen_table) (lua_State *ls)
+{
+  if (!pluaopen_table) return 0;
+  LRET(luaopen_table, ls);
+}
+
+int (luaopen_string) (lua_State *ls)
+{
+  if (!pluaopen_string) return 0;
+  LRET(luaopen_string, ls);
+}
+
+int (luaopen_math) (lua_State *ls)
+{
+  if (!pluaopen_math) return 0;
+  LRET(luaopen_math, ls);
+}
+
 EXTERN_C_BLOCK_END
 
 #undef LRET
 #undef LCALL
+#undef LCOUNT
 
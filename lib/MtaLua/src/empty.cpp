@@ -1 +1,10 @@
-// nothing here
\ No newline at end of file
+#include "lua/LuaImports.h"
+
+#ifdef MODULE_SDK_COUNTERS
+// Lua is linked directly, imported calls are not counted
+LuaImportsCounters* GetLuaImportsCounters()
+{
+  static thread_local LuaImportsCounters counters = {0, 0};
+  return &counters;
+}
+#endif
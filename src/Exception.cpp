@@ -8,16 +8,17 @@ void LuaException::move(LuaException &&luaException) noexcept
 
 void LuaException::copy(const LuaException &luaException)
 {
-    if (!luaException.what()) {
+    if (!luaException.message) {
         return;
     }
 
     destroy();
-    this->message = new char[std::strlen(luaException.message)];
+    this->message = new char[std::strlen(luaException.message) + 1];
     std::strcpy(this->message, luaException.message);
 }
 
 void LuaException::destroy() noexcept
 {
     delete[] message;
+    message = nullptr;
 }
@@ -1,57 +1,267 @@
 #include "ModuleSdk/LuaArgument.h"
+#include <stdexcept>
 
-size_t LuaArgumentHash::operator()(const LuaArgument &argument) const
+/**
+ * @brief Type-dependent LuaArgument operations (entries of LuaArgument::OPERATIONS)
+ */
+struct LuaArgumentOperations
 {
-    size_t hashType = std::hash<LuaArgumentType>()(argument.type);         ///< Hashed type
+    using Storage = LuaArgument::Storage;
+
+    // Inline values and userdata pointers
+
+    static void copyInline(Storage &destination, const Storage &source)
+    {
+        destination = source;
+    }
+
+    static void destroyNothing(Storage &)
+    {}
+
+    static bool equalNil(const Storage &, const Storage &)
+    {
+        return true;
+    }
+
+    static bool equalBoolean(const Storage &left, const Storage &right)
+    {
+        return left.boolean == right.boolean;
+    }
+
+    static bool equalNumber(const Storage &left, const Storage &right)
+    {
+        return left.number == right.number;
+    }
+
+    static bool equalInteger(const Storage &left, const Storage &right)
+    {
+        return left.integer == right.integer;
+    }
 
-    if (argument.type == LuaArgumentType::LuaTypeLightUserdata || argument.type == LuaArgumentType::LuaTypeUserdata) {
-        return hashType ^ reinterpret_cast<uintptr_t>(argument.value);
+    static bool equalPointer(const Storage &left, const Storage &right)
+    {
+        return left.pointer == right.pointer;
     }
-    if (argument.type == LuaArgumentType::LuaTypeBoolean) {
-        bool boolean = *reinterpret_cast<bool *>(argument.value);
-        return hashType ^ static_cast<unsigned int>(boolean);
+
+    static size_t hashNil(const Storage &)
+    {
+        return 0;
+    }
+
+    static size_t hashBoolean(const Storage &storage)
+    {
+        return static_cast<size_t>(storage.boolean);
     }
-    if (argument.type == LuaArgumentType::LuaTypeNumber) {
-        return hashType ^ static_cast<size_t>(*reinterpret_cast<double *>(argument.value));
+
+    static size_t hashNumber(const Storage &storage)
+    {
+        return std::hash<double>()(storage.number);
     }
-    if (argument.type == LuaArgumentType::LuaTypeInteger) {
-        return hashType ^ static_cast<size_t>(*reinterpret_cast<int *>(argument.value));
+
+    static size_t hashInteger(const Storage &storage)
+    {
+        return std::hash<int>()(storage.integer);
+    }
+
+    static size_t hashPointer(const Storage &storage)
+    {
+        return std::hash<void *>()(storage.pointer);
     }
-    if (argument.type == LuaArgumentType::LuaTypeString) {
-        return hashType ^ std::hash<std::string>()(*reinterpret_cast<std::string *>(argument.value));
+
+    // Allocated values
+
+    template<typename T>
+    static void copyAllocated(Storage &destination, const Storage &source)
+    {
+        LUA_COUNTERS_ADD(allocations, 1);
+        LUA_COUNTERS_ADD(bytesCopied, sizeof(T));
+        destination.pointer = new T(*reinterpret_cast<T *>(source.pointer));
+    }
+
+    template<typename T>
+    static void destroyAllocated(Storage &storage)
+    {
+        delete reinterpret_cast<T *>(storage.pointer);
+    }
+
+    template<typename T>
+    static bool equalAllocated(const Storage &left, const Storage &right)
+    {
+        return *reinterpret_cast<T *>(left.pointer) == *reinterpret_cast<T *>(right.pointer);
     }
-    // TODO: hash for tables
-    return hashType ^ reinterpret_cast<uintptr_t>(argument.value);
+
+    // Shared strings
+
+    static void copyString(Storage &destination, const Storage &source)
+    {
+        reinterpret_cast<LuaArgument::SharedString *>(source.pointer)->references++;
+        destination.pointer = source.pointer;
+    }
+
+    static void destroyString(Storage &storage)
+    {
+        auto *string = reinterpret_cast<LuaArgument::SharedString *>(storage.pointer);
+        if (--string->references == 0) {
+            delete string;
+        }
+    }
+
+    static bool equalString(const Storage &left, const Storage &right)
+    {
+        auto *leftString = reinterpret_cast<LuaArgument::SharedString *>(left.pointer);
+        auto *rightString = reinterpret_cast<LuaArgument::SharedString *>(right.pointer);
+        return leftString == rightString
+            || (leftString->hash == rightString->hash && leftString->value == rightString->value);
+    }
+
+    static size_t hashString(const Storage &storage)
+    {
+        return reinterpret_cast<LuaArgument::SharedString *>(storage.pointer)->hash;
+    }
+
+    static size_t hashObject(const Storage &storage)
+    {
+        return std::hash<unsigned long>()(reinterpret_cast<LuaObject *>(storage.pointer)->getObjectId().id);
+    }
+
+    // Shared tables
+
+    template<typename T>
+    static void copyTable(Storage &destination, const Storage &source)
+    {
+        // Share immutable table
+        reinterpret_cast<LuaArgument::SharedTable<T> *>(source.pointer)->references++;
+        destination.pointer = source.pointer;
+    }
+
+    template<typename T>
+    static void destroyTable(Storage &storage)
+    {
+        auto *table = reinterpret_cast<LuaArgument::SharedTable<T> *>(storage.pointer);
+        if (--table->references == 0) {
+            delete table;
+        }
+    }
+
+    template<typename T>
+    static bool equalTable(const Storage &left, const Storage &right)
+    {
+        return left.pointer == right.pointer
+            || reinterpret_cast<LuaArgument::SharedTable<T> *>(left.pointer)->table
+                == reinterpret_cast<LuaArgument::SharedTable<T> *>(right.pointer)->table;
+    }
+
+    template<typename T>
+    static size_t hashTable(const Storage &storage)
+    {
+        // Equal tables must have equal hashes, so the hash depends on contents size only
+        return std::hash<size_t>()(reinterpret_cast<LuaArgument::SharedTable<T> *>(storage.pointer)->table.size());
+    }
+};
+
+using Op = LuaArgumentOperations;
+
+const LuaArgument::Operations LuaArgument::OPERATIONS[static_cast<int>(LuaTypeIndex::Count)] = {
+    // Nil
+    {Op::copyInline, Op::destroyNothing, Op::equalNil, Op::hashNil},
+    // Boolean
+    {Op::copyInline, Op::destroyNothing, Op::equalBoolean, Op::hashBoolean},
+    // LightUserdata
+    {Op::copyInline, Op::destroyNothing, Op::equalPointer, Op::hashPointer},
+    // Number
+    {Op::copyInline, Op::destroyNothing, Op::equalNumber, Op::hashNumber},
+    // String
+    {Op::copyString, Op::destroyString, Op::equalString, Op::hashString},
+    // Userdata
+    {Op::copyInline, Op::destroyNothing, Op::equalPointer, Op::hashPointer},
+    // TableMap
+    {Op::copyTable<TableMapType>, Op::destroyTable<TableMapType>, Op::equalTable<TableMapType>, Op::hashTable<TableMapType>},
+    // Integer
+    {Op::copyInline, Op::destroyNothing, Op::equalInteger, Op::hashInteger},
+    // Object
+    {Op::copyAllocated<LuaObject>, Op::destroyAllocated<LuaObject>, Op::equalAllocated<LuaObject>, Op::hashObject},
+    // TableList
+    {Op::copyTable<TableListType>, Op::destroyTable<TableListType>, Op::equalTable<TableListType>, Op::hashTable<TableListType>},
+    // DoubleArray
+    {Op::copyTable<DoubleArrayType>, Op::destroyTable<DoubleArrayType>, Op::equalTable<DoubleArrayType>, Op::hashTable<DoubleArrayType>},
+    // FloatArray
+    {Op::copyTable<FloatArrayType>, Op::destroyTable<FloatArrayType>, Op::equalTable<FloatArrayType>, Op::hashTable<FloatArrayType>},
+    // Int32Array
+    {Op::copyTable<Int32ArrayType>, Op::destroyTable<Int32ArrayType>, Op::equalTable<Int32ArrayType>, Op::hashTable<Int32ArrayType>},
+};
+
+size_t LuaArgumentHash::operator()(const LuaArgument &argument) const
+{
+    size_t hashType = std::hash<unsigned int>()(static_cast<unsigned int>(argument.index));         ///< Hashed type
+
+    return hashType ^ LuaArgument::OPERATIONS[static_cast<int>(argument.index)].hash(argument.storage);
+}
+
+namespace
+{
+
+/**
+ * @brief Convert typed array elements into numbers
+ */
+template<typename T>
+LuaArgument::TableListType typedArrayToList(const std::vector<T> &array)
+{
+    LuaArgument::TableListType result;
+    result.reserve(array.size());
+    for (T value : array) {
+        result.emplace_back(static_cast<double>(value));
+    }
+    return result;
+}
 
 }
 
 LuaArgument::TableMapType LuaArgument::toMap() const
 {
-    if (this->type == LuaArgumentType::LuaTypeTableMap) {
-        return *reinterpret_cast<TableMapType *>(value);
+    if (this->index == LuaTypeIndex::TableMap) {
+        return this->getTable<TableMapType>();
     }
-    if (this->type != LuaArgumentType::LuaTypeTableList) {
-        throw LuaUnexpectedArgumentType(LuaArgumentType::LuaTypeTableList, this->type);
+
+    TableListType converted;                        ///< Typed array elements
+    const TableListType *original = &converted;
+    if (this->index == LuaTypeIndex::TableList) {
+        original = &this->getTable<TableListType>();
+    } else if (
+        this->index == LuaTypeIndex::DoubleArray
+            || this->index == LuaTypeIndex::FloatArray
+            || this->index == LuaTypeIndex::Int32Array
+    ) {
+        converted = this->toList();
+    } else {
+        throw LuaUnexpectedArgumentType(LuaArgumentType::LuaTypeTableList, this->getType());
     }
 
-    TableListType &original = *reinterpret_cast<TableListType *>(value);
     TableMapType result;
-    for (size_t i = 0; i < original.size(); i++) {
-        result[LuaArgument(i + 1.)] = original[i];
+    result.reserve(original->size());
+    for (size_t i = 0; i < original->size(); i++) {
+        result[LuaArgument(i + 1.)] = (*original)[i];
     }
     return result;
 }
 
 LuaArgument::TableListType LuaArgument::toList() const
 {
-    if (this->type == LuaArgumentType::LuaTypeTableList) {
-        return *reinterpret_cast<TableListType *>(value);
-    }
-    if (this->type != LuaArgumentType::LuaTypeTableMap) {
-        throw LuaUnexpectedArgumentType(LuaArgumentType::LuaTypeTableMap, this->type);
+    switch (this->index) {
+        case LuaTypeIndex::TableList:
+            return this->getTable<TableListType>();
+        case LuaTypeIndex::DoubleArray:
+            return typedArrayToList(this->getTable<DoubleArrayType>());
+        case LuaTypeIndex::FloatArray:
+            return typedArrayToList(this->getTable<FloatArrayType>());
+        case LuaTypeIndex::Int32Array:
+            return typedArrayToList(this->getTable<Int32ArrayType>());
+        case LuaTypeIndex::TableMap:
+            break;
+        default:
+            throw LuaUnexpectedArgumentType(LuaArgumentType::LuaTypeTableMap, this->getType());
     }
 
-    const auto &original = *reinterpret_cast<TableMapType *>(value);
+    const auto &original = this->getTable<TableMapType>();
     TableListType result(original.size());
     for (size_t i = 0; i < original.size(); i++) {
         try {
@@ -65,154 +275,62 @@ LuaArgument::TableListType LuaArgument::toList() const
 
 void *LuaArgument::toPointer() const
 {
-    if (!(
-        this->type == LuaArgumentType::LuaTypeLightUserdata
-            || this->type == LuaArgumentType::LuaTypeUserdata
-    )) {
-        throw LuaUnexpectedArgumentType(LuaArgumentType::LuaTypeLightUserdata, this->type);
+    if (!(this->index == LuaTypeIndex::LightUserdata || this->index == LuaTypeIndex::Userdata)) {
+        throw LuaUnexpectedArgumentType(LuaArgumentType::LuaTypeLightUserdata, this->getType());
     }
 
-    return value;
+    return storage.pointer;
 }
 
 LuaObject &LuaArgument::extractObject(const std::string &stringClass)
 {
-    if (this->type == LuaArgumentType::LuaTypeObject) {
-        return *reinterpret_cast<LuaObject *>(this->value);
+    if (this->index == LuaTypeIndex::Object) {
+        return *reinterpret_cast<LuaObject *>(storage.pointer);
     }
 
-    if (!(this->type == LuaArgumentType::LuaTypeUserdata || this->type == LuaArgumentType::LuaTypeLightUserdata)) {
-        throw LuaUnexpectedArgumentType(LuaArgumentType::LuaTypeLightUserdata, this->type);
+    if (!(this->index == LuaTypeIndex::Userdata || this->index == LuaTypeIndex::LightUserdata)) {
+        throw LuaUnexpectedArgumentType(LuaArgumentType::LuaTypeLightUserdata, this->getType());
     }
 
     // Do not need to clear memory
 
-    ObjectId id(*reinterpret_cast<unsigned long *>(this->value));
-    this->value = new LuaObject(
+    ObjectId id(*reinterpret_cast<unsigned long *>(storage.pointer));
+    LUA_COUNTERS_ADD(allocations, 1);
+    storage.pointer = new LuaObject(
         id,
         stringClass
     );
-    this->type = LuaArgumentType::LuaTypeObject;
+    this->index = LuaTypeIndex::Object;
 
-    return *reinterpret_cast<LuaObject *>(this->value);
+    return *reinterpret_cast<LuaObject *>(storage.pointer);
 }
 
 void LuaArgument::move(LuaArgument &&argument) noexcept
 {
     // Move value and type
-    this->value = argument.value;
-    this->type = argument.type;
+    this->storage = argument.storage;
+    this->index = argument.index;
 
     // Clear old argument
-    argument.value = nullptr;
-    argument.type = LuaArgumentType::LuaTypeNil;
+    argument.storage.pointer = nullptr;
+    argument.index = LuaTypeIndex::Nil;
 }
 
 void LuaArgument::copy(const LuaArgument &argument)
 {
-    if (!argument.value) {                          // Nil
-        this->type = LuaArgumentType::LuaTypeNil;
-        this->value = nullptr;
-        return;
-    }
-
-    this->type = argument.type;
-    if (type == LuaArgumentType::LuaTypeBoolean) {
-        this->value = new bool(*reinterpret_cast<bool *>(argument.value));
-
-    } else if (type == LuaArgumentType::LuaTypeNumber) {
-        this->value = new double(*reinterpret_cast<double *>(argument.value));
-
-    } else if (type == LuaArgumentType::LuaTypeInteger) {
-        this->value = new int(*reinterpret_cast<int *>(argument.value));
-
-    } else if (type == LuaArgumentType::LuaTypeString) {
-        this->value = new std::string(*reinterpret_cast<std::string *>(argument.value));
-
-    } else if (
-        type == LuaArgumentType::LuaTypeLightUserdata
-            || type == LuaArgumentType::LuaTypeUserdata) {
-        this->value = argument.value;
-
-    } else if (type == LuaArgumentType::LuaTypeObject) {
-        this->value = new LuaObject(*reinterpret_cast<LuaObject *>(argument.value));
-
-    } else if (type == LuaArgumentType::LuaTypeTableList) {
-        this->value = new TableListType(*reinterpret_cast<TableListType *>(argument.value));
-
-    } else if (type == LuaArgumentType::LuaTypeTableMap) {
-        this->value = new TableMapType(*reinterpret_cast<TableMapType *>(argument.value));
-
-    } else {
-        this->value = nullptr;
-    }
+    LUA_COUNTERS_ADD(bytesCopied, sizeof(Storage));
+    OPERATIONS[static_cast<int>(argument.index)].copy(this->storage, argument.storage);
+    this->index = argument.index;
 }
 
 void LuaArgument::destroy() noexcept
 {
-    if (!this->value) {
-        return;
-    }
-
-    if (type == LuaArgumentType::LuaTypeBoolean) {
-        delete reinterpret_cast<bool *>(value);
-
-    } else if (type == LuaArgumentType::LuaTypeNumber) {
-        delete reinterpret_cast<double *>(value);
-
-    } else if (type == LuaArgumentType::LuaTypeInteger) {
-        delete reinterpret_cast<int *>(value);
-
-    } else if (type == LuaArgumentType::LuaTypeString) {
-        delete reinterpret_cast<std::string *>(value);
-
-    } else if (type == LuaArgumentType::LuaTypeObject) {
-        delete reinterpret_cast<LuaObject *>(value);
-
-    } else if (type == LuaArgumentType::LuaTypeTableList) {
-        delete reinterpret_cast<TableListType *>(value);
-
-    } else if (type == LuaArgumentType::LuaTypeTableMap) {
-        delete reinterpret_cast<TableMapType *>(value);
-
-    } else {
-        // LuaTypeNil
-        // LuaTypeLightUserdata
-        // LuaTypeUserdata
-
-        return;
-    }
+    OPERATIONS[static_cast<int>(this->index)].destroy(this->storage);
+    this->index = LuaTypeIndex::Nil;
 }
 
 bool operator==(const LuaArgument &left, const LuaArgument &right)
 {
-    if (left.type != right.type) {
-        return false;
-    }
-
-    if (left.type == LuaArgumentType::LuaTypeBoolean) {
-        return *reinterpret_cast<bool *>(left.value) == *reinterpret_cast<bool *>(right.value);
-    }
-    if (left.type == LuaArgumentType::LuaTypeNumber) {
-        return *reinterpret_cast<double *>(left.value) == *reinterpret_cast<double *>(right.value);
-    }
-    if (left.type == LuaArgumentType::LuaTypeInteger) {
-        return *reinterpret_cast<int *>(left.value) == *reinterpret_cast<int *>(right.value);
-    }
-    if (left.type == LuaArgumentType::LuaTypeString) {
-        return *reinterpret_cast<std::string *>(left.value) == *reinterpret_cast<std::string *>(right.value);
-    }
-    if (left.type == LuaArgumentType::LuaTypeObject) {
-        return *reinterpret_cast<LuaObject *>(left.value) == *reinterpret_cast<LuaObject *>(right.value);
-    }
-    if (left.type == LuaArgumentType::LuaTypeTableList) {
-        return *reinterpret_cast<LuaArgument::TableListType *>(left.value)
-            == *reinterpret_cast<LuaArgument::TableListType *>(right.value);
-    }
-    if (left.type == LuaArgumentType::LuaTypeTableMap) {
-        return *reinterpret_cast<LuaArgument::TableMapType *>(left.value)
-            == *reinterpret_cast<LuaArgument::TableMapType *>(right.value);
-    }
-    return left.value == right.value;
-
-}
\ No newline at end of file
+    return left.index == right.index
+        && LuaArgument::OPERATIONS[static_cast<int>(left.index)].equal(left.storage, right.storage);
+}
@@ -0,0 +1,245 @@
+#include "ModuleSdk/LuaCoroutines.h"
+#include "ModuleSdk/LuaVmExtended.h"
+#include "lua/lauxlib.h"
+#include <list>
+
+namespace
+{
+
+char TOKENS_KEY;                                    ///< Registry key of thread -> task ID table (weak keys)
+
+}
+
+bool LuaPromise::Awaiter::await_ready() const
+{
+    std::lock_guard<std::mutex> lock(state->mutex);
+    return state->settled;
+}
+
+bool LuaPromise::Awaiter::await_suspend(std::coroutine_handle<LuaAsync::promise_type> handle)
+{
+    std::lock_guard<std::mutex> lock(state->mutex);
+    if (state->settled) {
+        return false;                               // Settled after await_ready
+    }
+
+    state->owner = handle.promise().owner;
+    state->waiter = handle.promise().id;
+    return true;
+}
+
+std::vector<LuaArgument> LuaPromise::Awaiter::await_resume()
+{
+    std::lock_guard<std::mutex> lock(state->mutex);
+    if (!state->success) {
+        throw LuaAsyncException(state->error);
+    }
+    return std::move(state->results);
+}
+
+bool LuaPromise::settle(bool success, std::vector<LuaArgument> results, std::string error)
+{
+    LuaCoroutines *owner;
+    uint64_t waiter;
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        if (state->settled) {
+            return false;
+        }
+
+        state->settled = true;
+        state->success = success;
+        state->results = std::move(results);
+        state->error = std::move(error);
+        owner = state->owner;
+        waiter = state->waiter;
+    }
+
+    if (owner) {
+        owner->ready.push(waiter);
+    }
+    return true;
+}
+
+int LuaCoroutines::call(lua_State *luaVm, LuaAsync task)
+{
+    // Main thread can't be yielded
+    const bool mainThread = lua_pushthread(luaVm) == 1;
+    lua_pop(luaVm, 1);
+    if (mainThread) {
+        LuaVmExtended lua(luaVm);
+        std::list<LuaArgument> result{LuaArgument(false), LuaArgument("Async function must be called from a coroutine")};
+        return lua.pushArguments(result.cbegin(), result.cend());
+    }
+
+    LuaAsync::promise_type &promise = task.handle.promise();
+    promise.owner = this;
+    promise.id = nextId++;
+
+    task.handle.resume();
+    if (task.handle.done()) {
+        return finish(luaVm, promise);
+    }
+
+    // The task is owned by the entry before the yield: it raises an error through pcall or a metamethod,
+    // which unwinds the C stack without destructors. Such entry is dropped by pulse (the thread is not yielded).
+    // Lua 5.1 only marks the thread here, it is yielded after the function returns
+    const uint64_t id = promise.id;
+    setToken(luaVm, id);
+    lua_pushthread(luaVm);
+    const int reference = luaL_ref(luaVm, LUA_REGISTRYINDEX);
+    suspended.emplace(id, Suspended{std::move(task), luaVm, reference, getRegistry(luaVm), getFunction(luaVm)});
+    return lua_yield(luaVm, 0);
+}
+
+size_t LuaCoroutines::pulse()
+{
+    size_t resumed = 0;
+    ready.drain(
+        [this, &resumed](uint64_t id)
+        {
+            auto found = suspended.find(id);
+            if (found == suspended.end()) {
+                return;                             // Resource has been stopped
+            }
+
+            if (!isYielded(found->second, id)) {
+                Suspended entry = std::move(found->second);
+                suspended.erase(found);
+                if (errorHandler) {
+                    errorHandler(entry.thread, "Async function coroutine is not yielded by the call (yield failed or resumed by the script)");
+                }
+                luaL_unref(entry.thread, LUA_REGISTRYINDEX, entry.reference);
+                return;
+            }
+
+            found->second.task.handle.resume();
+            resumed++;
+            if (!found->second.task.handle.done()) {
+                return;                             // Awaits the next promise
+            }
+
+            Suspended entry = std::move(found->second);
+            suspended.erase(found);
+            setToken(entry.thread, 0);
+
+            // Results become return values of the yielded lua function call
+            const int size = finish(entry.thread, entry.task.handle.promise());
+            const int state = lua_resume(entry.thread, size);
+            if (state != 0 && state != LUA_YIELD) {
+                size_t length = 0;
+                const char *message = lua_tolstring(entry.thread, -1, &length);
+                if (errorHandler) {
+                    errorHandler(
+                        entry.thread,
+                        LuaCallException(state, message ? std::string(message, length) : "Error object is not a string").what()
+                    );
+                }
+                lua_pop(entry.thread, 1);
+            }
+            luaL_unref(entry.thread, LUA_REGISTRYINDEX, entry.reference);
+        }
+    );
+    return resumed;
+}
+
+void LuaCoroutines::resourceStopped(lua_State *luaVm)
+{
+    // The VM is closed with its coroutines and registry references
+    const void *registry = getRegistry(luaVm);
+    for (auto it = suspended.begin(); it != suspended.end();) {
+        if (it->second.registry == registry) {
+            it = suspended.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+int LuaCoroutines::finish(lua_State *luaVm, LuaAsync::promise_type &promise)
+{
+    LuaVmExtended lua(luaVm);
+    std::string error;
+    if (promise.exception) {
+        try {
+            std::rethrow_exception(promise.exception);
+        } catch (const std::exception &e) {
+            error = e.what();
+        } catch (...) {
+            error = "Unknown error";
+        }
+    } else {
+        try {
+            lua.pushArgument(LuaArgument(true));
+            return 1 + lua.pushArguments(promise.results.cbegin(), promise.results.cend());
+        } catch (const LuaException &e) {
+            lua_pop(luaVm, 1);                      // Status
+            error = e.what();
+        }
+    }
+
+    std::list<LuaArgument> result{LuaArgument(false), LuaArgument(std::move(error))};
+    return lua.pushArguments(result.cbegin(), result.cend());
+}
+
+const void *LuaCoroutines::getRegistry(lua_State *luaVm)
+{
+    return lua_topointer(luaVm, LUA_REGISTRYINDEX);
+}
+
+bool LuaCoroutines::isYielded(const Suspended &entry, uint64_t id)
+{
+    lua_State *thread = entry.thread;
+    if (lua_status(thread) != LUA_YIELD || getFunction(thread) != entry.function) {
+        return false;
+    }
+
+    lua_pushlightuserdata(thread, &TOKENS_KEY);
+    lua_rawget(thread, LUA_REGISTRYINDEX);
+    if (!lua_istable(thread, -1)) {
+        lua_pop(thread, 1);
+        return false;
+    }
+    lua_pushthread(thread);
+    lua_rawget(thread, -2);
+    const bool result = lua_tonumber(thread, -1) == static_cast<lua_Number>(id);
+    lua_pop(thread, 2);
+    return result;
+}
+
+void LuaCoroutines::setToken(lua_State *thread, uint64_t id)
+{
+    lua_pushlightuserdata(thread, &TOKENS_KEY);
+    lua_rawget(thread, LUA_REGISTRYINDEX);
+    if (!lua_istable(thread, -1)) {
+        lua_pop(thread, 1);
+        lua_newtable(thread);
+        lua_createtable(thread, 0, 1);
+        lua_pushstring(thread, "k");
+        lua_setfield(thread, -2, "__mode");
+        lua_setmetatable(thread, -2);
+        lua_pushlightuserdata(thread, &TOKENS_KEY);
+        lua_pushvalue(thread, -2);
+        lua_rawset(thread, LUA_REGISTRYINDEX);
+    }
+
+    lua_pushthread(thread);
+    if (id) {
+        lua_pushnumber(thread, static_cast<lua_Number>(id));
+    } else {
+        lua_pushnil(thread);
+    }
+    lua_rawset(thread, -3);
+    lua_pop(thread, 1);
+}
+
+const void *LuaCoroutines::getFunction(lua_State *thread)
+{
+    lua_Debug debug;
+    if (!lua_getstack(thread, 0, &debug) || !lua_getinfo(thread, "f", &debug)) {
+        return nullptr;
+    }
+    const void *result = lua_topointer(thread, -1);
+    lua_pop(thread, 1);
+    return result;
+}
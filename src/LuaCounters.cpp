@@ -0,0 +1,101 @@
+#include "ModuleSdk/LuaCounters.h"
+#include "lua/LuaImports.h"
+#include <mutex>
+
+namespace
+{
+
+std::mutex functionsMutex;                          ///< Protects functions totals
+
+std::map<std::string, LuaCounterValues> &getTotals()
+{
+    static std::map<std::string, LuaCounterValues> totals;
+    return totals;
+}
+
+void pushCounter(lua_State *luaVm, const char *name, uint64_t value)
+{
+    lua_pushnumber(luaVm, static_cast<lua_Number>(value));
+    lua_setfield(luaVm, -2, name);
+}
+
+}
+
+LuaCounterValues &LuaCounterValues::operator+=(const LuaCounterValues &other)
+{
+    calls += other.calls;
+    apiCalls += other.apiCalls;
+    tablesCreated += other.tablesCreated;
+    allocations += other.allocations;
+    bytesCopied += other.bytesCopied;
+    return *this;
+}
+
+LuaCounterValues operator-(LuaCounterValues left, const LuaCounterValues &right)
+{
+    left.calls -= right.calls;
+    left.apiCalls -= right.apiCalls;
+    left.tablesCreated -= right.tablesCreated;
+    left.allocations -= right.allocations;
+    left.bytesCopied -= right.bytesCopied;
+    return left;
+}
+
+LuaCounterValues LuaCounters::current()
+{
+    LuaCounterValues values = local();
+#ifdef MODULE_SDK_COUNTERS
+    const LuaImportsCounters *imports = GetLuaImportsCounters();
+    values.apiCalls = imports->calls;
+    values.tablesCreated = imports->tables;
+#endif
+    return values;
+}
+
+LuaCounterValues &LuaCounters::local()
+{
+    thread_local LuaCounterValues values;
+    return values;
+}
+
+std::map<std::string, LuaCounterValues> LuaCounters::getFunctions()
+{
+    std::lock_guard<std::mutex> lock(functionsMutex);
+    return getTotals();
+}
+
+void LuaCounters::reset()
+{
+    std::lock_guard<std::mutex> lock(functionsMutex);
+    getTotals().clear();
+}
+
+int LuaCounters::luaGetCounters(lua_State *luaVm)
+{
+    const bool clear = lua_toboolean(luaVm, 1) != 0;
+    const std::map<std::string, LuaCounterValues> functions = getFunctions();
+    if (clear) {
+        reset();
+    }
+
+    lua_createtable(luaVm, 0, static_cast<int>(functions.size()));
+    for (const auto &pair : functions) {
+        lua_createtable(luaVm, 0, 5);
+        pushCounter(luaVm, "calls", pair.second.calls);
+        pushCounter(luaVm, "apiCalls", pair.second.apiCalls);
+        pushCounter(luaVm, "tablesCreated", pair.second.tablesCreated);
+        pushCounter(luaVm, "allocations", pair.second.allocations);
+        pushCounter(luaVm, "bytesCopied", pair.second.bytesCopied);
+        lua_setfield(luaVm, -2, pair.first.c_str());
+    }
+    return 1;
+}
+
+LuaCounters::Scope::~Scope()
+{
+    LuaCounterValues spent = current() - started;
+    spent.calls = 1;
+
+    std::lock_guard<std::mutex> lock(functionsMutex);
+    getTotals()[name] += spent;
+}
@@ -0,0 +1,158 @@
+#include "ModuleSdk/LuaEventBatcher.h"
+#include "ModuleSdk/LuaVmExtended.h"
+#include "lua/lauxlib.h"
+#include <list>
+
+LuaEventBatcher::SubscriptionId LuaEventBatcher::subscribe(lua_State *luaVm, int callbackIndex)
+{
+    if (lua_type(luaVm, callbackIndex) != LUA_TFUNCTION) {
+        throw LuaBadType(lua_type(luaVm, callbackIndex));
+    }
+
+    lua_pushvalue(luaVm, callbackIndex);
+    const int reference = luaL_ref(luaVm, LUA_REGISTRYINDEX);  // Pops the copy
+
+    const SubscriptionId id = nextId++;
+    subscriptions.emplace(id, Subscription{luaVm, reference, {}, {}, 0});
+    return id;
+}
+
+bool LuaEventBatcher::unsubscribe(SubscriptionId id)
+{
+    auto subscription = subscriptions.find(id);
+    if (subscription == subscriptions.end()) {
+        return false;
+    }
+
+    pending -= subscription->second.events.size();
+    luaL_unref(subscription->second.luaVm, LUA_REGISTRYINDEX, subscription->second.reference);
+    subscriptions.erase(subscription);
+    return true;
+}
+
+bool LuaEventBatcher::post(SubscriptionId id, LuaArgument event)
+{
+    Subscription *subscription = this->prepare(id);
+    if (!subscription) {
+        return false;
+    }
+
+    subscription->events.push_back(std::move(event));
+    pending++;
+    return true;
+}
+
+bool LuaEventBatcher::post(SubscriptionId id, const LuaArgument &key, LuaArgument event)
+{
+    Subscription *subscription = this->prepare(id);
+    if (!subscription) {
+        return false;
+    }
+
+    auto merged = subscription->keys.emplace(key, subscription->events.size());
+    if (!merged.second) {
+        subscription->events[merged.first->second] = std::move(event);
+        return true;
+    }
+
+    subscription->events.push_back(std::move(event));
+    pending++;
+    return true;
+}
+
+size_t LuaEventBatcher::flush()
+{
+    // Callbacks may post and unsubscribe, new events are delivered on the next flush
+    std::vector<SubscriptionId> current;
+    current.swap(dirty);
+
+    size_t called = 0;
+    for (SubscriptionId id : current) {
+        auto found = subscriptions.find(id);
+        if (found == subscriptions.end()) {
+            continue;
+        }
+
+        Subscription &subscription = found->second;
+        lua_State *luaVm = subscription.luaVm;
+        const int reference = subscription.reference;
+
+        pending -= subscription.events.size();
+        subscription.lastBatch = subscription.events.size();
+        std::vector<LuaArgument> arguments{LuaArgument(std::move(subscription.events))};
+        subscription.events = {};
+        subscription.keys.clear();
+
+        try {
+            LuaVmExtended(luaVm).callReference(reference, arguments);
+        } catch (const LuaException &e) {
+            if (errorHandler) {
+                errorHandler(luaVm, e.what());
+            }
+        }
+        called++;
+    }
+    return called;
+}
+
+void LuaEventBatcher::resourceStopped(lua_State *luaVm)
+{
+    // The VM is closed with its registry references
+    for (auto it = subscriptions.begin(); it != subscriptions.end();) {
+        if (it->second.luaVm == luaVm) {
+            pending -= it->second.events.size();
+            it = subscriptions.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+int LuaEventBatcher::luaSubscribe(lua_State *luaVm)
+{
+    LuaVmExtended lua(luaVm);
+    SubscriptionId id;
+    try {
+        id = this->subscribe(luaVm, 1);
+    } catch (const LuaException &e) {
+        std::list<LuaArgument> result{LuaArgument(false), LuaArgument(e.what())};
+        return lua.pushArguments(result.cbegin(), result.cend());
+    }
+
+    lua.pushArgument(LuaArgument(static_cast<double>(id)));
+    return 1;
+}
+
+int LuaEventBatcher::luaUnsubscribe(lua_State *luaVm)
+{
+    LuaVmExtended lua(luaVm);
+    bool unsubscribed = false;
+    if (lua_type(luaVm, 1) == LUA_TNUMBER) {
+        double id = lua_tonumber(luaVm, 1);
+        if (id >= 1) {
+            auto subscription = subscriptions.find(static_cast<SubscriptionId>(id));
+            // Lua can't unsubscribe other resources
+            if (subscription != subscriptions.end() && subscription->second.luaVm == luaVm) {
+                unsubscribed = this->unsubscribe(subscription->first);
+            }
+        }
+    }
+
+    lua.pushArgument(LuaArgument(unsubscribed));
+    return 1;
+}
+
+LuaEventBatcher::Subscription *LuaEventBatcher::prepare(SubscriptionId id)
+{
+    auto found = subscriptions.find(id);
+    if (found == subscriptions.end()) {
+        return nullptr;
+    }
+
+    Subscription &subscription = found->second;
+    if (subscription.events.empty()) {
+        subscription.events.reserve(subscription.lastBatch);
+        dirty.push_back(id);
+    }
+    return &subscription;
+}
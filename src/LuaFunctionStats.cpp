@@ -0,0 +1,355 @@
+#include "ModuleSdk/LuaFunctionStats.h"
+#include "ModuleSdk/LuaVmExtended.h"
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+
+constexpr int PROMETHEUS_FIRST_BOUND = 10;          ///< 2^10 ns (about 1 us)
+constexpr int PROMETHEUS_LAST_BOUND = 34;           ///< 2^34 ns (about 17 s)
+
+std::string escape(const std::string &value)
+{
+    std::string result;
+    result.reserve(value.size());
+    for (char symbol : value) {
+        if (symbol == '"' || symbol == '\\') {
+            result += '\\';
+            result += symbol;
+        } else if (symbol == '\n') {
+            result += "\\n";
+        } else {
+            result += symbol;
+        }
+    }
+    return result;
+}
+
+std::string labels(const LuaFunctionStats::Summary &summary)
+{
+    return "function=\"" + escape(summary.function) + "\",resource=\"" + escape(summary.resource) + "\"";
+}
+
+}
+
+void LuaLatencyHistogram::record(uint64_t nanoseconds)
+{
+    buckets[getIndex(nanoseconds)]++;
+    count++;
+    sum += nanoseconds;
+    if (nanoseconds > max) {
+        max = nanoseconds;
+    }
+}
+
+void LuaLatencyHistogram::merge(const LuaLatencyHistogram &other)
+{
+    for (size_t i = 0; i < buckets.size(); i++) {
+        buckets[i] += other.buckets[i];
+    }
+    count += other.count;
+    sum += other.sum;
+    if (other.max > max) {
+        max = other.max;
+    }
+}
+
+void LuaLatencyHistogram::clear()
+{
+    buckets.fill(0);
+    count = 0;
+    sum = 0;
+    max = 0;
+}
+
+uint64_t LuaLatencyHistogram::getPercentile(double fraction) const
+{
+    if (count == 0) {
+        return 0;
+    }
+
+    const auto target = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(count * fraction)));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < buckets.size(); i++) {
+        seen += buckets[i];
+        if (seen >= target) {
+            return std::min(getUpperBound(i) - 1, max);
+        }
+    }
+    return max;
+}
+
+uint64_t LuaLatencyHistogram::countBelow(uint64_t bound) const
+{
+    uint64_t result = 0;
+    for (size_t i = 0; i < buckets.size() && getUpperBound(i) <= bound; i++) {
+        result += buckets[i];
+    }
+    return result;
+}
+
+size_t LuaLatencyHistogram::getIndex(uint64_t value)
+{
+    if (value < static_cast<uint64_t>(SUB_BUCKETS)) {
+        return static_cast<size_t>(value);
+    }
+
+    int magnitude = 63;
+    while (!(value >> magnitude)) {
+        magnitude--;
+    }
+    if (magnitude >= MAGNITUDES) {
+        return BUCKETS - 1;
+    }
+
+    const uint64_t subBucket = (value >> (magnitude - SUB_BUCKETS_BITS)) & (SUB_BUCKETS - 1);
+    return static_cast<size_t>((magnitude - SUB_BUCKETS_BITS + 1) * SUB_BUCKETS + subBucket);
+}
+
+uint64_t LuaLatencyHistogram::getLowerBound(size_t index)
+{
+    if (index < static_cast<size_t>(SUB_BUCKETS)) {
+        return index;
+    }
+
+    const int magnitude = static_cast<int>(index / SUB_BUCKETS) + SUB_BUCKETS_BITS - 1;
+    const uint64_t subBucket = index % SUB_BUCKETS;
+    return (SUB_BUCKETS + subBucket) << (magnitude - SUB_BUCKETS_BITS);
+}
+
+uint64_t LuaLatencyHistogram::getUpperBound(size_t index)
+{
+    if (index < static_cast<size_t>(SUB_BUCKETS)) {
+        return index + 1;
+    }
+
+    const int magnitude = static_cast<int>(index / SUB_BUCKETS) + SUB_BUCKETS_BITS - 1;
+    return getLowerBound(index) + (static_cast<uint64_t>(1) << (magnitude - SUB_BUCKETS_BITS));
+}
+
+bool LuaFunctionStats::registerFunction(ILuaModuleManager10 *manager,
+                                        lua_State *luaVm,
+                                        const char *name,
+                                        lua_CFunction function)
+{
+    if (!manager->RegisterFunction(luaVm, name, function)) {
+        return false;
+    }
+    if (!enabled) {
+        return true;
+    }
+
+    char resource[MAX_INFO_LENGTH] = {};
+    if (!manager->GetResourceName(luaVm, resource, sizeof(resource))) {
+        strncpy(resource, "unknown", sizeof(resource));
+    }
+
+    Entry &entry = entries[std::make_pair(std::string(name), std::string(resource))];
+    entry.owner = this;
+    entry.function = function;
+
+    // Same global, the server keeps its registration
+    lua_pushlightuserdata(luaVm, &entry);
+    lua_pushcclosure(luaVm, trampoline, 1);
+    lua_setglobal(luaVm, name);
+    return true;
+}
+
+std::vector<LuaFunctionStats::Summary> LuaFunctionStats::getSummaries(bool byResource) const
+{
+    const char marker = 0;
+    this->unwind(reinterpret_cast<uintptr_t>(&marker));
+
+    std::vector<Summary> result;
+    for (const auto &pair : entries) {
+        const Entry &entry = pair.second;
+        if (!byResource && !result.empty() && result.back().function == pair.first.first) {
+            // Entries are sorted by function name
+            result.back().calls += entry.calls;
+            result.back().errors += entry.errors;
+            result.back().latency.merge(entry.latency);
+            continue;
+        }
+
+        result.push_back(
+            {
+                pair.first.first,
+                byResource ? pair.first.second : std::string(),
+                entry.calls,
+                entry.errors,
+                entry.latency
+            }
+        );
+    }
+    return result;
+}
+
+void LuaFunctionStats::reset()
+{
+    for (auto &pair : entries) {
+        pair.second.calls = 0;
+        pair.second.errors = 0;
+        pair.second.latency.clear();
+    }
+}
+
+std::string LuaFunctionStats::toPrometheus() const
+{
+    const std::vector<Summary> summaries = this->getSummaries();
+    std::string result;
+
+    result += "# HELP module_function_calls_total Calls of module functions\n";
+    result += "# TYPE module_function_calls_total counter\n";
+    for (const Summary &summary : summaries) {
+        result += "module_function_calls_total{" + labels(summary) + "} " + std::to_string(summary.calls) + "\n";
+    }
+
+    result += "# HELP module_function_errors_total Lua errors raised by module functions\n";
+    result += "# TYPE module_function_errors_total counter\n";
+    for (const Summary &summary : summaries) {
+        result += "module_function_errors_total{" + labels(summary) + "} " + std::to_string(summary.errors) + "\n";
+    }
+
+    result += "# HELP module_function_latency_seconds Latency of successful module function calls\n";
+    result += "# TYPE module_function_latency_seconds histogram\n";
+    for (const Summary &summary : summaries) {
+        const std::string names = labels(summary);
+        for (int power = PROMETHEUS_FIRST_BOUND; power <= PROMETHEUS_LAST_BOUND; power += 2) {
+            const uint64_t bound = static_cast<uint64_t>(1) << power;
+            result += "module_function_latency_seconds_bucket{" + names + ",le=\""
+                + LuaStatsOutput::formatNumber("%.9g", bound / 1e9) + "\"} " + std::to_string(summary.latency.countBelow(bound)) + "\n";
+        }
+        result += "module_function_latency_seconds_bucket{" + names + ",le=\"+Inf\"} "
+            + std::to_string(summary.latency.getCount()) + "\n";
+        result += "module_function_latency_seconds_sum{" + names + "} "
+            + LuaStatsOutput::formatNumber("%.9g", summary.latency.getSum() / 1e9) + "\n";
+        result += "module_function_latency_seconds_count{" + names + "} "
+            + std::to_string(summary.latency.getCount()) + "\n";
+    }
+    return result;
+}
+
+std::string LuaFunctionStats::toJson() const
+{
+    const std::vector<Summary> summaries = this->getSummaries();
+    std::string result = "{\n  \"functions\": [\n";
+    for (size_t i = 0; i < summaries.size(); i++) {
+        const Summary &summary = summaries[i];
+        const LuaLatencyHistogram &latency = summary.latency;
+        result += "    {\"function\": \"" + escape(summary.function)
+            + "\", \"resource\": \"" + escape(summary.resource)
+            + "\", \"calls\": " + std::to_string(summary.calls)
+            + ", \"errors\": " + std::to_string(summary.errors)
+            + ", \"total_us\": " + LuaStatsOutput::formatNumber("%.1f", latency.getSum() / 1e3)
+            + ", \"p50_us\": " + LuaStatsOutput::formatNumber("%.1f", latency.getPercentile(0.5) / 1e3)
+            + ", \"p90_us\": " + LuaStatsOutput::formatNumber("%.1f", latency.getPercentile(0.9) / 1e3)
+            + ", \"p99_us\": " + LuaStatsOutput::formatNumber("%.1f", latency.getPercentile(0.99) / 1e3)
+            + ", \"max_us\": " + LuaStatsOutput::formatNumber("%.1f", latency.getMax() / 1e3)
+            + "}" + (i + 1 < summaries.size() ? "," : "") + "\n";
+    }
+    result += "  ]\n}\n";
+    return result;
+}
+
+bool LuaFunctionStats::dump(const std::string &path, Format format) const
+{
+    return writeFile(path, format == Format::Json ? this->toJson() : this->toPrometheus());
+}
+
+int LuaFunctionStats::luaGetStats(lua_State *luaVm)
+{
+    const bool byResource = lua_type(luaVm, 1) == LUA_TNONE || lua_toboolean(luaVm, 1);
+    const std::vector<Summary> summaries = this->getSummaries(byResource);
+
+    lua_createtable(luaVm, static_cast<int>(summaries.size()), 0);
+    for (size_t i = 0; i < summaries.size(); i++) {
+        const Summary &summary = summaries[i];
+        lua_createtable(luaVm, 0, 8);
+        lua_pushstring(luaVm, summary.function.c_str());
+        lua_setfield(luaVm, -2, "function");
+        if (byResource) {
+            lua_pushstring(luaVm, summary.resource.c_str());
+            lua_setfield(luaVm, -2, "resource");
+        }
+        lua_pushnumber(luaVm, static_cast<lua_Number>(summary.calls));
+        lua_setfield(luaVm, -2, "calls");
+        lua_pushnumber(luaVm, static_cast<lua_Number>(summary.errors));
+        lua_setfield(luaVm, -2, "errors");
+        lua_pushnumber(luaVm, summary.latency.getPercentile(0.5) / 1e6);
+        lua_setfield(luaVm, -2, "p50");
+        lua_pushnumber(luaVm, summary.latency.getPercentile(0.9) / 1e6);
+        lua_setfield(luaVm, -2, "p90");
+        lua_pushnumber(luaVm, summary.latency.getPercentile(0.99) / 1e6);
+        lua_setfield(luaVm, -2, "p99");
+        lua_pushnumber(luaVm, summary.latency.getMax() / 1e6);
+        lua_setfield(luaVm, -2, "max");
+        lua_rawseti(luaVm, -2, static_cast<int>(i + 1));
+    }
+    return 1;
+}
+
+int LuaFunctionStats::luaDump(lua_State *luaVm)
+{
+    std::string formatName = "json";
+    if (lua_type(luaVm, 2) != LUA_TNONE && lua_type(luaVm, 2) != LUA_TNIL) {
+        try {
+            formatName = LuaVmExtended(luaVm).parseArgument(2, LuaArgumentType::LuaTypeString).toString();
+        } catch (const LuaException &e) {
+            return pushError(luaVm, e.what());
+        }
+    }
+    if (formatName != "json" && formatName != "prometheus") {
+        return pushError(luaVm, "Unknown format " + formatName);
+    }
+
+    const Format format = formatName == "json" ? Format::Json : Format::Prometheus;
+    return this->luaDumpFile(
+        luaVm,
+        1,
+        [this, format](const std::string &path)
+        {
+            return this->dump(path, format);
+        }
+    );
+}
+
+int LuaFunctionStats::trampoline(lua_State *luaVm)
+{
+    auto *entry = static_cast<Entry *>(lua_touserdata(luaVm, lua_upvalueindex(1)));
+    LuaFunctionStats &stats = *entry->owner;
+
+    // Calls, which are not callers of this one, have been left by errors
+    const char marker = 0;
+    const auto address = reinterpret_cast<uintptr_t>(&marker);
+    stats.unwind(address);
+    stats.frames.push_back({entry, address});
+    entry->calls++;
+
+    const auto started = std::chrono::steady_clock::now();
+    const int result = entry->function(luaVm);
+    const auto elapsed = std::chrono::steady_clock::now() - started;
+
+    // Nested calls left by errors caught inside the function
+    while (!stats.frames.empty() && stats.frames.back().address != address) {
+        stats.frames.back().entry->errors++;
+        stats.frames.pop_back();
+    }
+    if (!stats.frames.empty()) {
+        stats.frames.pop_back();
+    }
+
+    entry->latency.record(
+        static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count())
+    );
+    return result;
+}
+
+void LuaFunctionStats::unwind(uintptr_t address) const
+{
+    while (!frames.empty() && frames.back().address <= address) {
+        frames.back().entry->errors++;
+        frames.pop_back();
+    }
+}
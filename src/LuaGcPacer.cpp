@@ -0,0 +1,228 @@
+#include "ModuleSdk/LuaGcPacer.h"
+#include "lua/lauxlib.h"
+#include <algorithm>
+
+bool LuaGcPacer::enable(lua_State *luaVm, const Options &options)
+{
+    if (options.budget.count() <= 0 || options.stepSize <= 0 || options.trigger < 100
+        || options.minPause <= options.trigger || options.minPause > options.maxPause
+        || options.stepMultiplier <= 0 || options.stepMultiplier > options.maxStepMultiplier) {
+        return false;
+    }
+
+    std::unique_ptr<State> &state = states[getRegistry(luaVm)];
+    const int pause = options.adaptive ? options.minPause : options.maxPause;
+    if (!state) {
+        // Steps run on the thread after the call, so a coroutine must stay alive
+        state.reset(new State());
+        lua_pushthread(luaVm);
+        state->luaVm = luaVm;
+        state->reference = luaL_ref(luaVm, LUA_REGISTRYINDEX);
+        state->originalPause = lua_gc(luaVm, LUA_GCSETPAUSE, pause);
+        state->originalStepMultiplier = lua_gc(luaVm, LUA_GCSETSTEPMUL, options.stepMultiplier);
+        state->baseline = getBytes(luaVm);
+        state->lastBytes = state->baseline;
+        state->window = Clock::now();
+    } else {
+        lua_gc(luaVm, LUA_GCSETPAUSE, pause);
+        lua_gc(luaVm, LUA_GCSETSTEPMUL, options.stepMultiplier);
+    }
+
+    state->options = options;
+    state->stats.pause = pause;
+    state->stats.stepMultiplier = options.stepMultiplier;
+    state->stats.bytes = state->lastBytes;
+    return true;
+}
+
+bool LuaGcPacer::disable(lua_State *luaVm)
+{
+    auto it = states.find(getRegistry(luaVm));
+    if (it == states.end()) {
+        return false;
+    }
+
+    lua_gc(luaVm, LUA_GCSETPAUSE, it->second->originalPause);
+    lua_gc(luaVm, LUA_GCSETSTEPMUL, it->second->originalStepMultiplier);
+    luaL_unref(luaVm, LUA_REGISTRYINDEX, it->second->reference);
+    states.erase(it);
+    return true;
+}
+
+LuaGcPacer::Stats LuaGcPacer::getStats(lua_State *luaVm) const
+{
+    auto it = states.find(getRegistry(luaVm));
+    return it == states.end() ? Stats() : it->second->stats;
+}
+
+std::chrono::nanoseconds LuaGcPacer::getTotalGcTime() const
+{
+    std::chrono::nanoseconds result{0};
+    for (const auto &pair : states) {
+        result += pair.second->stats.gcTime;
+    }
+    return result;
+}
+
+size_t LuaGcPacer::pulse(Clock::time_point now)
+{
+    size_t steps = 0;
+    for (auto &pair : states) {
+        State &state = *pair.second;
+        steps += this->step(state);
+        state.stats.pulses++;
+        state.windowPulses++;
+
+        const double elapsed = std::chrono::duration<double>(now - state.window).count();
+        if (elapsed >= 1) {
+            adapt(state, elapsed);
+            state.window = now;
+            state.windowAllocated = 0;
+            state.windowPulses = 0;
+        }
+    }
+    return steps;
+}
+
+void LuaGcPacer::resourceStopped(lua_State *luaVm)
+{
+    // The VM is closed with its collector settings and the thread reference
+    states.erase(getRegistry(luaVm));
+}
+
+int LuaGcPacer::luaEnable(lua_State *luaVm)
+{
+    Options options;
+    if (lua_type(luaVm, 1) == LUA_TNUMBER) {
+        options.budget = std::chrono::microseconds(static_cast<int64_t>(lua_tonumber(luaVm, 1)));
+    }
+
+    lua_pushboolean(luaVm, this->enable(luaVm, options));
+    return 1;
+}
+
+int LuaGcPacer::luaDisable(lua_State *luaVm)
+{
+    lua_pushboolean(luaVm, this->disable(luaVm));
+    return 1;
+}
+
+int LuaGcPacer::luaGetStats(lua_State *luaVm)
+{
+    if (!this->isEnabled(luaVm)) {
+        lua_pushboolean(luaVm, false);
+        return 1;
+    }
+
+    const Stats stats = this->getStats(luaVm);
+    lua_createtable(luaVm, 0, 9);
+    LuaStatsOutput::pushCounter(luaVm, "gcTime", stats.gcTime.count() / 1e6);
+    LuaStatsOutput::pushCounter(luaVm, "lastPulseTime", stats.lastPulseTime.count() / 1e6);
+    LuaStatsOutput::pushCounter(luaVm, "steps", static_cast<double>(stats.steps));
+    LuaStatsOutput::pushCounter(luaVm, "cycles", static_cast<double>(stats.cycles));
+    LuaStatsOutput::pushCounter(luaVm, "pulses", static_cast<double>(stats.pulses));
+    LuaStatsOutput::pushCounter(luaVm, "bytes", static_cast<double>(stats.bytes));
+    LuaStatsOutput::pushCounter(luaVm, "allocationRate", stats.allocationRate);
+    LuaStatsOutput::pushCounter(luaVm, "pause", stats.pause);
+    LuaStatsOutput::pushCounter(luaVm, "stepMultiplier", stats.stepMultiplier);
+    return 1;
+}
+
+size_t LuaGcPacer::getBytes(lua_State *luaVm)
+{
+    return static_cast<size_t>(lua_gc(luaVm, LUA_GCCOUNT, 0)) * 1024
+        + static_cast<size_t>(lua_gc(luaVm, LUA_GCCOUNTB, 0));
+}
+
+const void *LuaGcPacer::getRegistry(lua_State *luaVm)
+{
+    return lua_topointer(luaVm, LUA_REGISTRYINDEX);
+}
+
+size_t LuaGcPacer::step(State &state)
+{
+    // Memory growth between pulses is made by scripts (minus automatic collection)
+    lua_State *luaVm = state.luaVm;
+    const size_t bytes = getBytes(luaVm);
+    state.windowAllocated += bytes > state.lastBytes ? bytes - state.lastBytes : 0;
+
+    // Memory dropped, because automatic steps between pulses swept a cycle. Scripts drive the collector
+    // during a pacer cycle too, so the cycle is finished without the pacer, which waits for the trigger again
+    // (otherwise the next step would start a new cycle at once)
+    if (bytes < state.lastBytes) {
+        state.collecting = false;
+        state.baseline = bytes;
+    }
+
+    if (!state.collecting && bytes * 100 >= state.baseline * static_cast<size_t>(state.options.trigger)) {
+        state.collecting = true;
+        state.cycleBytes = bytes;
+        state.cycleTime = std::chrono::nanoseconds(0);
+    }
+
+    size_t steps = 0;
+    std::chrono::nanoseconds spent{0};
+    const Clock::time_point started = Clock::now();
+    while (state.collecting && spent < state.options.budget) {
+        const bool finished = lua_gc(luaVm, LUA_GCSTEP, state.options.stepSize) != 0;
+        spent = Clock::now() - started;
+        steps++;
+
+        if (finished) {
+            state.collecting = false;
+            state.cycleTime += spent;
+            state.stats.cycles++;
+            state.baseline = getBytes(luaVm);
+
+            const double seconds = std::chrono::duration<double>(state.cycleTime).count();
+            if (seconds > 0) {
+                const double throughput = state.cycleBytes / seconds;
+                state.throughput = state.throughput > 0 ? (state.throughput + throughput) / 2 : throughput;
+            }
+        }
+    }
+    if (state.collecting) {
+        state.cycleTime += spent;
+    }
+
+    state.lastBytes = getBytes(luaVm);
+    state.stats.bytes = state.lastBytes;
+    state.stats.steps += steps;
+    state.stats.gcTime += spent;
+    state.stats.lastPulseTime = spent;
+    return steps;
+}
+
+void LuaGcPacer::adapt(State &state, double elapsed)
+{
+    lua_State *luaVm = state.luaVm;
+    const double rate = state.windowAllocated / elapsed;
+    state.stats.allocationRate = state.stats.allocationRate > 0 ? (state.stats.allocationRate + rate) / 2 : rate;
+
+    const Options &options = state.options;
+    if (!options.adaptive || state.throughput <= 0) {
+        return;
+    }
+
+    // Step time per second the pacer needs: cycles to keep up with the rate, each collects the triggered heap
+    const double triggered = std::max<double>(state.baseline, 1) * options.trigger / 100;
+    const double growth = std::max<double>(triggered - state.baseline, 1);
+    const double required = state.stats.allocationRate / growth * (triggered / state.throughput);
+    const double available = std::chrono::duration<double>(options.budget).count() * state.windowPulses / elapsed;
+    const double ratio = required > 0 ? available / required : 2;
+
+    const double headroom = std::min(std::max(ratio - 1, 0.0), 1.0);
+    const int pause = options.minPause + static_cast<int>((options.maxPause - options.minPause) * headroom);
+    const int stepMultiplier = ratio >= 1
+        ? options.stepMultiplier
+        : std::min(options.maxStepMultiplier, static_cast<int>(options.stepMultiplier / std::max(ratio, 0.01)));
+
+    if (pause != state.stats.pause) {
+        lua_gc(luaVm, LUA_GCSETPAUSE, pause);
+        state.stats.pause = pause;
+    }
+    if (stepMultiplier != state.stats.stepMultiplier) {
+        lua_gc(luaVm, LUA_GCSETSTEPMUL, stepMultiplier);
+        state.stats.stepMultiplier = stepMultiplier;
+    }
+}
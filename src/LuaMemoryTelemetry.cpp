@@ -0,0 +1,277 @@
+#include "ModuleSdk/LuaMemoryTelemetry.h"
+#include <algorithm>
+#include <cstring>
+
+thread_local unsigned int LuaMemoryTelemetry::Attribution::depth = 0;
+
+bool LuaMemoryTelemetry::enable(lua_State *luaVm, const std::string &name)
+{
+    if (this->isEnabled(luaVm)) {
+        return false;
+    }
+
+    std::unique_ptr<Tracker> tracker(new Tracker());
+    tracker->allocator = lua_getallocf(luaVm, &tracker->userdata);
+    tracker->stats.name = name;
+
+    // Blocks allocated before are freed through the wrapper too
+    tracker->stats.liveBytes = static_cast<int64_t>(lua_gc(luaVm, LUA_GCCOUNT, 0)) * 1024
+        + lua_gc(luaVm, LUA_GCCOUNTB, 0);
+    tracker->stats.peakBytes = tracker->stats.liveBytes;
+
+    lua_setallocf(luaVm, allocate, tracker.get());
+    trackers.emplace(getRegistry(luaVm), std::move(tracker));
+    return true;
+}
+
+bool LuaMemoryTelemetry::disable(lua_State *luaVm)
+{
+    auto it = trackers.find(getRegistry(luaVm));
+    if (it == trackers.end() || !restore(luaVm, it->second.get())) {
+        return false;
+    }
+
+    trackers.erase(it);
+    return true;
+}
+
+LuaMemoryTelemetry::Stats LuaMemoryTelemetry::getStats(lua_State *luaVm) const
+{
+    auto it = trackers.find(getRegistry(luaVm));
+    return it == trackers.end() ? Stats() : it->second->stats;
+}
+
+std::vector<LuaMemoryTelemetry::Stats> LuaMemoryTelemetry::getAllStats() const
+{
+    std::vector<Stats> result;
+    result.reserve(trackers.size());
+    for (const auto &pair : trackers) {
+        result.push_back(pair.second->stats);
+    }
+
+    std::sort(
+        result.begin(),
+        result.end(),
+        [](const Stats &left, const Stats &right)
+        {
+            return left.name < right.name;
+        }
+    );
+    return result;
+}
+
+void LuaMemoryTelemetry::pulse(Clock::time_point now)
+{
+    const double elapsed = std::chrono::duration<double>(now - rateWindow).count();
+    if (elapsed < 1) {
+        return;
+    }
+    rateWindow = now;
+
+    for (auto &pair : trackers) {
+        Tracker &tracker = *pair.second;
+        tracker.stats.allocationRate = (tracker.stats.allocatedBytes - tracker.rateAllocatedBytes) / elapsed;
+        tracker.stats.allocationsPerSecond = (tracker.stats.allocations - tracker.rateAllocations) / elapsed;
+        tracker.rateAllocatedBytes = tracker.stats.allocatedBytes;
+        tracker.rateAllocations = tracker.stats.allocations;
+    }
+}
+
+void LuaMemoryTelemetry::resourceStopped(lua_State *luaVm)
+{
+    auto it = trackers.find(getRegistry(luaVm));
+    if (it == trackers.end()) {
+        return;
+    }
+
+    // A foreign wrapper still forwards to the tracker, which must outlive the VM then
+    if (!restore(luaVm, it->second.get())) {
+        it->second.release();
+    }
+    trackers.erase(it);
+}
+
+std::string LuaMemoryTelemetry::toJson() const
+{
+    const std::vector<Stats> all = this->getAllStats();
+    std::string result = "{\n  \"resources\": [\n";
+    for (size_t i = 0; i < all.size(); i++) {
+        const Stats &stats = all[i];
+        std::string name;
+        for (char symbol : stats.name) {
+            if (symbol == '"' || symbol == '\\') {
+                name += '\\';
+            }
+            name += symbol;
+        }
+
+        std::string sizeClasses;
+        for (size_t sizeClass = 0; sizeClass < SIZE_CLASSES; sizeClass++) {
+            sizeClasses += (sizeClass ? ", " : "") + std::to_string(stats.sizeClasses[sizeClass]);
+        }
+
+        result += "    {\"name\": \"" + name
+            + "\", \"live_bytes\": " + std::to_string(stats.liveBytes)
+            + ", \"peak_bytes\": " + std::to_string(stats.peakBytes)
+            + ", \"allocations\": " + std::to_string(stats.allocations)
+            + ", \"reallocations\": " + std::to_string(stats.reallocations)
+            + ", \"frees\": " + std::to_string(stats.frees)
+            + ", \"allocated_bytes\": " + std::to_string(stats.allocatedBytes)
+            + ", \"module_allocations\": " + std::to_string(stats.moduleAllocations)
+            + ", \"module_bytes\": " + std::to_string(stats.moduleBytes)
+            + ", \"allocation_rate\": " + formatNumber("%.1f", stats.allocationRate)
+            + ", \"allocations_per_second\": " + formatNumber("%.1f", stats.allocationsPerSecond)
+            + ", \"size_classes\": [" + sizeClasses + "]"
+            + "}" + (i + 1 < all.size() ? "," : "") + "\n";
+    }
+    result += "  ]\n}\n";
+    return result;
+}
+
+bool LuaMemoryTelemetry::dump(const std::string &path) const
+{
+    return writeFile(path, this->toJson());
+}
+
+size_t LuaMemoryTelemetry::getSizeClass(size_t size)
+{
+    size_t sizeClass = 0;
+    while (sizeClass < SIZE_CLASSES - 1 && (static_cast<size_t>(1) << sizeClass) < size) {
+        sizeClass++;
+    }
+    return sizeClass;
+}
+
+int LuaMemoryTelemetry::luaEnable(lua_State *luaVm, ILuaModuleManager10 *manager)
+{
+    char name[MAX_INFO_LENGTH] = {};
+    if (!manager || !manager->GetResourceName(luaVm, name, sizeof(name))) {
+        strncpy(name, "vm", sizeof(name));
+    }
+
+    lua_pushboolean(luaVm, this->enable(luaVm, name));
+    return 1;
+}
+
+int LuaMemoryTelemetry::luaDisable(lua_State *luaVm)
+{
+    lua_pushboolean(luaVm, this->disable(luaVm));
+    return 1;
+}
+
+int LuaMemoryTelemetry::luaGetStats(lua_State *luaVm)
+{
+    if (!lua_toboolean(luaVm, 1)) {
+        if (!this->isEnabled(luaVm)) {
+            lua_pushboolean(luaVm, false);
+            return 1;
+        }
+        pushStats(luaVm, this->getStats(luaVm));
+        return 1;
+    }
+
+    const std::vector<Stats> all = this->getAllStats();
+    lua_createtable(luaVm, 0, static_cast<int>(all.size()));
+    for (const Stats &stats : all) {
+        pushStats(luaVm, stats);
+        lua_setfield(luaVm, -2, stats.name.c_str());
+    }
+    return 1;
+}
+
+int LuaMemoryTelemetry::luaDump(lua_State *luaVm)
+{
+    return this->luaDumpFile(
+        luaVm,
+        1,
+        [this](const std::string &path)
+        {
+            return this->dump(path);
+        }
+    );
+}
+
+void *LuaMemoryTelemetry::allocate(void *userdata, void *pointer, size_t oldSize, size_t newSize)
+{
+    auto *tracker = static_cast<Tracker *>(userdata);
+    void *result = tracker->allocator(tracker->userdata, pointer, oldSize, newSize);
+    Stats &stats = tracker->stats;
+
+    if (newSize == 0) {
+        if (pointer) {
+            stats.frees++;
+            stats.liveBytes -= static_cast<int64_t>(oldSize);
+        }
+        return result;
+    }
+    if (!result) {
+        return result;
+    }
+
+    const bool attributed = Attribution::depth > 0;
+    if (!pointer) {
+        stats.allocations++;
+        stats.sizeClasses[getSizeClass(newSize)]++;
+        stats.moduleAllocations += attributed;
+        oldSize = 0;
+    } else {
+        stats.reallocations++;
+    }
+
+    if (newSize > oldSize) {
+        stats.allocatedBytes += newSize - oldSize;
+        if (attributed) {
+            stats.moduleBytes += newSize - oldSize;
+        }
+    }
+    stats.liveBytes += static_cast<int64_t>(newSize) - static_cast<int64_t>(oldSize);
+    if (stats.liveBytes > stats.peakBytes) {
+        stats.peakBytes = stats.liveBytes;
+    }
+    return result;
+}
+
+const void *LuaMemoryTelemetry::getRegistry(lua_State *luaVm)
+{
+    return lua_topointer(luaVm, LUA_REGISTRYINDEX);
+}
+
+bool LuaMemoryTelemetry::restore(lua_State *luaVm, Tracker *tracker)
+{
+    void *userdata = nullptr;
+    if (lua_getallocf(luaVm, &userdata) != allocate || userdata != tracker) {
+        return false;
+    }
+
+    lua_setallocf(luaVm, tracker->allocator, tracker->userdata);
+    return true;
+}
+
+void LuaMemoryTelemetry::pushStats(lua_State *luaVm, const Stats &stats)
+{
+    lua_createtable(luaVm, 0, 11);
+    pushCounter(luaVm, "liveBytes", static_cast<double>(stats.liveBytes));
+    pushCounter(luaVm, "peakBytes", static_cast<double>(stats.peakBytes));
+    pushCounter(luaVm, "allocations", static_cast<double>(stats.allocations));
+    pushCounter(luaVm, "reallocations", static_cast<double>(stats.reallocations));
+    pushCounter(luaVm, "frees", static_cast<double>(stats.frees));
+    pushCounter(luaVm, "allocatedBytes", static_cast<double>(stats.allocatedBytes));
+    pushCounter(luaVm, "moduleAllocations", static_cast<double>(stats.moduleAllocations));
+    pushCounter(luaVm, "moduleBytes", static_cast<double>(stats.moduleBytes));
+    pushCounter(luaVm, "allocationRate", stats.allocationRate);
+    pushCounter(luaVm, "allocationsPerSecond", stats.allocationsPerSecond);
+
+    lua_createtable(luaVm, 0, static_cast<int>(SIZE_CLASSES));
+    for (size_t sizeClass = 0; sizeClass < SIZE_CLASSES; sizeClass++) {
+        if (!stats.sizeClasses[sizeClass]) {
+            continue;
+        }
+        // Bigger blocks are keyed by the last bound + 1
+        const size_t bound = sizeClass < SIZE_CLASSES - 1
+            ? static_cast<size_t>(1) << sizeClass
+            : (static_cast<size_t>(1) << (SIZE_CLASSES - 2)) + 1;
+        lua_pushnumber(luaVm, static_cast<lua_Number>(stats.sizeClasses[sizeClass]));
+        lua_rawseti(luaVm, -2, static_cast<int>(bound));
+    }
+    lua_setfield(luaVm, -2, "sizeClasses");
+}
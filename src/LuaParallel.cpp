@@ -0,0 +1,196 @@
+#include "ModuleSdk/LuaParallel.h"
+#include <algorithm>
+
+namespace
+{
+
+constexpr size_t CHUNKS_PER_THREAD = 8;             ///< Default grain gives thieves something to steal
+
+thread_local bool insideLoop = false;               ///< Nested loops run serially
+
+}
+
+LuaParallel::LuaParallel(unsigned int threads, size_t serialThreshold)
+    : threadsAmount(threads ? threads : std::max(1u, std::thread::hardware_concurrency())),
+      serialThreshold(serialThreshold),
+      slots(new Slot[threadsAmount])
+{}
+
+LuaParallel &LuaParallel::getDefault()
+{
+    static LuaParallel pool;
+    return pool;
+}
+
+LuaParallel::~LuaParallel()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    condition.notify_all();
+
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+}
+
+void LuaParallel::run(size_t count, size_t grain, Invoke invoke, void *context)
+{
+    if (count == 0) {
+        return;
+    }
+    if (count < serialThreshold || threadsAmount == 1 || insideLoop) {
+        invoke(context, 0, count);
+        return;
+    }
+
+    std::lock_guard<std::mutex> runLock(runMutex);
+    if (workers.empty()) {
+        this->start();
+    }
+
+    Job current;
+    current.invoke = invoke;
+    current.context = context;
+    current.grain = grain ? grain : std::max<size_t>(1, count / (threadsAmount * CHUNKS_PER_THREAD));
+
+    // Equal initial ranges, stealing balances the rest
+    for (unsigned int i = 0; i < threadsAmount; i++) {
+        std::lock_guard<std::mutex> lock(slots[i].mutex);
+        slots[i].begin = count * i / threadsAmount;
+        slots[i].end = count * (i + 1) / threadsAmount;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        job = &current;
+        generation++;
+    }
+    condition.notify_all();
+
+    insideLoop = true;
+    this->participate(current, 0);
+    insideLoop = false;
+
+    // All ranges are taken, wait for chunks running on workers
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        job = nullptr;
+        finished.wait(
+            lock,
+            [this]()
+            {
+                return active == 0;
+            }
+        );
+    }
+
+    if (current.exception) {
+        std::rethrow_exception(current.exception);
+    }
+}
+
+void LuaParallel::participate(Job &current, unsigned int self)
+{
+    size_t begin;
+    size_t end;
+    while (!current.cancelled.load(std::memory_order_relaxed) && this->take(current, self, begin, end)) {
+        try {
+            current.invoke(current.context, begin, end);
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(current.exceptionMutex);
+            if (!current.exception) {
+                current.exception = std::current_exception();
+            }
+            current.cancelled.store(true, std::memory_order_relaxed);
+        }
+    }
+}
+
+bool LuaParallel::take(Job &current, unsigned int self, size_t &begin, size_t &end)
+{
+    {
+        Slot &own = slots[self];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (own.begin < own.end) {
+            begin = own.begin;
+            end = std::min(own.end, own.begin + current.grain);
+            own.begin = end;
+            return true;
+        }
+    }
+
+    for (unsigned int i = 1; i < threadsAmount; i++) {
+        Slot &victim = slots[(self + i) % threadsAmount];
+        size_t stolenBegin;
+        size_t stolenEnd;
+        {
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            const size_t left = victim.end - victim.begin;
+            if (left == 0) {
+                continue;
+            }
+
+            // Half of the rest from the back, the victim keeps its front
+            const size_t stolen = left > current.grain ? left / 2 : left;
+            stolenEnd = victim.end;
+            stolenBegin = victim.end - stolen;
+            victim.end = stolenBegin;
+        }
+
+        begin = stolenBegin;
+        end = std::min(stolenEnd, stolenBegin + current.grain);
+        if (end < stolenEnd) {
+            // Keep the stolen rest as own range, so it can be stolen again
+            Slot &own = slots[self];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            own.begin = end;
+            own.end = stolenEnd;
+        }
+        return true;
+    }
+    return false;
+}
+
+void LuaParallel::work(unsigned int self)
+{
+    insideLoop = true;
+    uint64_t seen = 0;
+    while (true) {
+        Job *current;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            condition.wait(
+                lock,
+                [this, seen]()
+                {
+                    return stopping || (job && generation != seen);
+                }
+            );
+            if (stopping) {
+                return;
+            }
+
+            seen = generation;
+            current = job;
+            active++;
+        }
+
+        this->participate(*current, self);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            active--;
+        }
+        finished.notify_one();
+    }
+}
+
+void LuaParallel::start()
+{
+    workers.reserve(threadsAmount - 1);
+    for (unsigned int i = 1; i < threadsAmount; i++) {
+        workers.emplace_back(&LuaParallel::work, this, i);
+    }
+}
@@ -0,0 +1,284 @@
+#include "ModuleSdk/LuaProfiler.h"
+#include <cstdio>
+#include <cstring>
+
+namespace
+{
+
+constexpr uint32_t UNKNOWN_FRAME = 0;
+
+char SESSION_KEY;                                   ///< Registry key of the VM session
+
+size_t roundUp(size_t value)
+{
+    size_t result = 1;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+}
+
+LuaProfiler::LuaProfiler(size_t bufferSize, size_t maxFrames)
+    : ring(roundUp(bufferSize < 2 ? 2 : bufferSize)),
+      mask(ring.size() - 1),
+      frames(new std::string[maxFrames < 1 ? 1 : maxFrames]),
+      maxFrames(maxFrames < 1 ? 1 : maxFrames)
+{
+    frames[UNKNOWN_FRAME] = "[unknown]";
+    frameCount.store(1, std::memory_order_release);
+}
+
+bool LuaProfiler::start(lua_State *luaVm, const std::string &name, const Options &options)
+{
+    if (options.instructions <= 0 || options.maxDepth == 0 || options.maxDepth > MAX_DEPTH) {
+        return false;
+    }
+    const lua_Hook current = lua_gethook(luaVm);
+    if (current && current != hook) {
+        return false;
+    }
+
+    std::unique_ptr<Session> &session = sessions[getRegistry(luaVm)];
+    if (!session) {
+        session.reset(new Session(this, this->intern(name), options));
+    }
+    session->options = options;
+    session->running = true;
+    session->window = Clock::now();
+    session->windowSamples = 0;
+
+    lua_pushlightuserdata(luaVm, &SESSION_KEY);
+    lua_pushlightuserdata(luaVm, session.get());
+    lua_rawset(luaVm, LUA_REGISTRYINDEX);
+
+    lua_sethook(luaVm, hook, LUA_MASKCOUNT, options.instructions);
+    return true;
+}
+
+bool LuaProfiler::stop(lua_State *luaVm)
+{
+    auto it = sessions.find(getRegistry(luaVm));
+    if (it == sessions.end() || !it->second->running) {
+        return false;
+    }
+    it->second->running = false;
+
+    lua_sethook(luaVm, nullptr, 0, 0);
+    lua_pushlightuserdata(luaVm, &SESSION_KEY);
+    lua_pushnil(luaVm);
+    lua_rawset(luaVm, LUA_REGISTRYINDEX);
+    return true;
+}
+
+bool LuaProfiler::isRunning(lua_State *luaVm) const
+{
+    auto it = sessions.find(getRegistry(luaVm));
+    return it != sessions.end() && it->second->running;
+}
+
+LuaProfiler::Stats LuaProfiler::getStats(lua_State *luaVm) const
+{
+    auto it = sessions.find(getRegistry(luaVm));
+    return it == sessions.end() ? Stats() : it->second->stats;
+}
+
+size_t LuaProfiler::collect()
+{
+    const size_t last = head.load(std::memory_order_acquire);
+    size_t current = tail.load(std::memory_order_relaxed);
+    const size_t count = last - current;
+
+    const size_t names = frameCount.load(std::memory_order_acquire);
+    std::string stack;
+    for (; current != last; current++) {
+        const Sample &sample = ring[current & mask];
+
+        // Folded stacks start with the outermost frame
+        stack = frames[sample.root < names ? sample.root : UNKNOWN_FRAME];
+        for (uint32_t i = sample.depth; i > 0; i--) {
+            const uint32_t frame = sample.frames[i - 1];
+            stack += ';';
+            stack += frames[frame < names ? frame : UNKNOWN_FRAME];
+        }
+        folded[stack]++;
+    }
+
+    tail.store(current, std::memory_order_release);
+    return count;
+}
+
+std::string LuaProfiler::toFolded()
+{
+    this->collect();
+
+    const std::map<std::string, uint64_t> sorted(folded.cbegin(), folded.cend());
+    std::string result;
+    for (const auto &pair : sorted) {
+        result += pair.first + " " + std::to_string(pair.second) + "\n";
+    }
+    return result;
+}
+
+bool LuaProfiler::dump(const std::string &path)
+{
+    return writeFile(path, this->toFolded());
+}
+
+void LuaProfiler::reset()
+{
+    this->collect();
+    folded.clear();
+}
+
+void LuaProfiler::resourceStopped(lua_State *luaVm)
+{
+    // The VM is being closed, the hook goes with it
+    sessions.erase(getRegistry(luaVm));
+}
+
+int LuaProfiler::luaStart(lua_State *luaVm, ILuaModuleManager10 *manager)
+{
+    Options options;
+    if (lua_type(luaVm, 1) == LUA_TNUMBER) {
+        options.instructions = static_cast<int>(lua_tonumber(luaVm, 1));
+    }
+    if (lua_type(luaVm, 2) == LUA_TNUMBER) {
+        options.samplesPerSecond = static_cast<unsigned int>(lua_tonumber(luaVm, 2));
+    }
+    if (lua_type(luaVm, 3) == LUA_TNUMBER) {
+        options.maxDepth = static_cast<size_t>(lua_tonumber(luaVm, 3));
+    }
+
+    char name[MAX_INFO_LENGTH] = {};
+    if (!manager || !manager->GetResourceName(luaVm, name, sizeof(name))) {
+        strncpy(name, "vm", sizeof(name));
+    }
+
+    if (!this->start(luaVm, name, options)) {
+        return pushError(luaVm, "Invalid options or the VM is hooked by another debugger");
+    }
+
+    lua_pushboolean(luaVm, true);
+    return 1;
+}
+
+int LuaProfiler::luaStop(lua_State *luaVm)
+{
+    lua_pushboolean(luaVm, this->stop(luaVm));
+    return 1;
+}
+
+int LuaProfiler::luaGetStats(lua_State *luaVm)
+{
+    const Stats stats = this->getStats(luaVm);
+
+    lua_createtable(luaVm, 0, 5);
+    lua_pushboolean(luaVm, this->isRunning(luaVm));
+    lua_setfield(luaVm, -2, "running");
+    pushCounter(luaVm, "samples", static_cast<double>(stats.samples));
+    pushCounter(luaVm, "skipped", static_cast<double>(stats.skipped));
+    pushCounter(luaVm, "dropped", static_cast<double>(stats.dropped));
+    pushCounter(luaVm, "hookTime", stats.hookTime.count() / 1e6);
+    return 1;
+}
+
+int LuaProfiler::luaDump(lua_State *luaVm)
+{
+    return this->luaDumpFile(
+        luaVm,
+        1,
+        [this](const std::string &path)
+        {
+            return this->dump(path);
+        }
+    );
+}
+
+void LuaProfiler::hook(lua_State *luaVm, lua_Debug *)
+{
+    lua_pushlightuserdata(luaVm, &SESSION_KEY);
+    lua_rawget(luaVm, LUA_REGISTRYINDEX);
+    auto *session = static_cast<Session *>(lua_touserdata(luaVm, -1));
+    lua_pop(luaVm, 1);
+
+    if (session && session->running) {
+        session->profiler->sample(luaVm, *session);
+    }
+}
+
+void LuaProfiler::sample(lua_State *luaVm, Session &session)
+{
+    const Clock::time_point started = Clock::now();
+    if (started - session.window >= std::chrono::seconds(1)) {
+        session.window = started;
+        session.windowSamples = 0;
+    }
+    if (session.options.samplesPerSecond && session.windowSamples >= session.options.samplesPerSecond) {
+        session.stats.skipped++;
+        return;
+    }
+    session.windowSamples++;
+
+    const size_t position = head.load(std::memory_order_relaxed);
+    if (position - tail.load(std::memory_order_acquire) > mask) {
+        session.stats.dropped++;
+        return;
+    }
+
+    Sample &slot = ring[position & mask];
+    slot.root = session.root;
+    slot.depth = 0;
+
+    lua_Debug debug;
+    for (int level = 0; slot.depth < session.options.maxDepth && lua_getstack(luaVm, level, &debug); level++) {
+        if (!lua_getinfo(luaVm, "Sn", &debug)) {
+            break;
+        }
+
+        frameName.clear();
+        if (debug.what && !strcmp(debug.what, "C")) {
+            frameName += debug.name ? debug.name : "?";
+            frameName += " [C]";
+        } else if (debug.what && !strcmp(debug.what, "main")) {
+            frameName += debug.short_src;
+        } else {
+            frameName += debug.name ? debug.name : "?";
+            frameName += '@';
+            frameName += debug.short_src;
+            char line[16];
+            snprintf(line, sizeof(line), ":%d", debug.linedefined);
+            frameName += line;
+        }
+        slot.frames[slot.depth++] = this->intern(frameName);
+    }
+
+    head.store(position + 1, std::memory_order_release);
+    session.stats.samples++;
+    session.stats.hookTime += Clock::now() - started;
+}
+
+const void *LuaProfiler::getRegistry(lua_State *luaVm)
+{
+    return lua_topointer(luaVm, LUA_REGISTRYINDEX);
+}
+
+uint32_t LuaProfiler::intern(const std::string &name)
+{
+    auto it = frameIds.find(name);
+    if (it != frameIds.end()) {
+        return it->second;
+    }
+
+    const size_t id = frameCount.load(std::memory_order_relaxed);
+    if (id >= maxFrames) {
+        return UNKNOWN_FRAME;
+    }
+
+    // Published before the samples, which refer to it
+    frames[id] = name;
+    frameCount.store(id + 1, std::memory_order_release);
+    frameIds.emplace(name, static_cast<uint32_t>(id));
+    return static_cast<uint32_t>(id);
+}
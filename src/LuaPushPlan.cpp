@@ -0,0 +1,102 @@
+#include "ModuleSdk/LuaPushPlan.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+
+/**
+ * @brief Get array index from key
+ * @return Index, or 0 if key is not a positive integer
+ */
+size_t arrayIndex(const LuaArgument &key)
+{
+    if (key.getTypeIndex() == LuaTypeIndex::Integer) {
+        int index = key.toInteger();
+        return index > 0 ? static_cast<size_t>(index) : 0;
+    }
+    if (key.getTypeIndex() == LuaTypeIndex::Number) {
+        double index = key.toNumber();
+        if (index >= 1 && std::floor(index) == index) {
+            return static_cast<size_t>(index);
+        }
+    }
+    return 0;
+}
+
+}
+
+void LuaPushPlan::add(const LuaArgument &argument)
+{
+    // Previous arguments stay on the stack
+    stackSize = std::max(stackSize, pushed + plan(argument));
+    pushed++;
+}
+
+LuaPushPlan::TableSize LuaPushPlan::nextTable()
+{
+    if (position >= tables.size()) {
+        throw LuaOutOfRange("Table has not been planned");
+    }
+    return tables[position++];
+}
+
+int LuaPushPlan::plan(const LuaArgument &argument)
+{
+    if (argument.getTypeIndex() == LuaTypeIndex::Object) {
+        return 4;                               // Userdata cache and metatable lookup
+    }
+
+    if (argument.getTypeIndex() == LuaTypeIndex::TableList) {
+        const auto &list = argument.getList();
+        tables.push_back({static_cast<int>(list.size()), 0});
+
+        int stack = 0;                          ///< Stack over the table
+        for (const LuaArgument &value : list) {
+            stack = std::max(stack, plan(value));
+        }
+        return 1 + stack;
+    }
+
+    if (argument.getTypeIndex() == LuaTypeIndex::TableMap) {
+        const auto &map = argument.getMap();
+        size_t position = tables.size();
+        tables.push_back({0, 0});
+
+        // Keys 1..n would be placed into the array part
+        size_t arraySize = 0;
+        int stack = 0;                          ///< Stack over the table
+        for (const auto &pair : map) {
+            size_t index = arrayIndex(pair.first);
+            if (index > 0 && index <= map.size()) {
+                arraySize++;
+            }
+            int keyStack = plan(pair.first);    // Key is pushed before value
+            int valueStack = 1 + plan(pair.second);
+            stack = std::max(stack, std::max(keyStack, valueStack));
+        }
+
+        size_t inArray = 0;                     ///< Keys inside the created array part
+        if (arraySize > 0) {
+            for (const auto &pair : map) {
+                size_t index = arrayIndex(pair.first);
+                if (index > 0 && index <= arraySize) {
+                    inArray++;
+                }
+            }
+        }
+
+        tables[position] = {static_cast<int>(arraySize), static_cast<int>(map.size() - inArray)};
+        return 1 + stack;
+    }
+
+    if (
+        argument.getTypeIndex() == LuaTypeIndex::DoubleArray
+            || argument.getTypeIndex() == LuaTypeIndex::FloatArray
+            || argument.getTypeIndex() == LuaTypeIndex::Int32Array
+    ) {
+        return 2;                               // Table and element (size is known without planning)
+    }
+
+    return 1;
+}
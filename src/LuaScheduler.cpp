@@ -0,0 +1,348 @@
+#include "ModuleSdk/LuaScheduler.h"
+#include "ModuleSdk/LuaVmExtended.h"
+#include "lua/lauxlib.h"
+#include <algorithm>
+#include <exception>
+#include <limits>
+#include <list>
+
+LuaScheduler::LuaScheduler(std::chrono::microseconds budget)
+    : start(Clock::now()), budget(budget)
+{}
+
+LuaScheduler::TimerId LuaScheduler::setTimer(Callback callback, unsigned int interval, unsigned int repeats)
+{
+    std::unique_ptr<Timer> timer(new Timer{});
+    timer->callback = std::move(callback);
+    timer->interval = std::max(1u, interval);
+    timer->repeats = repeats;
+    return this->add(std::move(timer));
+}
+
+LuaScheduler::TimerId LuaScheduler::setTimer(
+    lua_State *luaVm, int callbackIndex, unsigned int interval, unsigned int repeats, std::vector<LuaArgument> arguments
+)
+{
+    if (lua_type(luaVm, callbackIndex) != LUA_TFUNCTION) {
+        throw LuaBadType(lua_type(luaVm, callbackIndex));
+    }
+
+    std::unique_ptr<Timer> timer(new Timer{});
+    timer->interval = std::max(1u, interval);
+    timer->repeats = repeats;
+    timer->luaVm = luaVm;
+    timer->arguments = std::move(arguments);
+
+    lua_pushvalue(luaVm, callbackIndex);
+    timer->reference = luaL_ref(luaVm, LUA_REGISTRYINDEX);     // Pops the copy
+    return this->add(std::move(timer));
+}
+
+bool LuaScheduler::killTimer(TimerId id)
+{
+    if (timers.find(id) == timers.end()) {
+        return false;
+    }
+    this->remove(id, true);
+    return true;
+}
+
+void LuaScheduler::defer(Task task)
+{
+    tasks.push_back(std::move(task));
+}
+
+size_t LuaScheduler::pulse(Clock::time_point now)
+{
+    this->advance(this->getTick(now));
+
+    const Clock::time_point begin = Clock::now();
+    auto spent = [this, begin]()
+    {
+        return budget.count() > 0 && Clock::now() - begin >= budget;
+    };
+
+    // Expired timers first, at least one per pulse
+    size_t count = 0;
+    while (!due.empty()) {
+        auto timer = timers.find(due.front());
+        due.pop_front();
+        if (timer == timers.end()) {
+            continue;                               // Killed after expiration
+        }
+
+        this->fire(timer->second.get());
+        count++;
+        if (spent()) {
+            break;
+        }
+    }
+
+    // Task steps in round robin, at least one per pulse. Unlimited budget runs one round
+    const size_t round = tasks.size();
+    size_t steps = 0;
+    while (!tasks.empty()) {
+        if (budget.count() <= 0 && steps >= round) {
+            break;
+        }
+
+        Task task = std::move(tasks.front());
+        tasks.pop_front();
+        try {
+            if (!task()) {
+                tasks.push_back(std::move(task));
+            }
+        } catch (const std::exception &e) {
+            if (errorHandler) {
+                errorHandler(nullptr, e.what());
+            }
+        }
+        steps++;
+        if (spent()) {
+            break;
+        }
+    }
+    return count + steps;
+}
+
+void LuaScheduler::resourceStopped(lua_State *luaVm)
+{
+    std::vector<TimerId> stopped;
+    for (const auto &timer : timers) {
+        if (timer.second->luaVm == luaVm) {
+            stopped.push_back(timer.first);
+        }
+    }
+
+    // The VM is closed with its registry references
+    for (TimerId id : stopped) {
+        this->remove(id, false);
+    }
+}
+
+int LuaScheduler::luaSetTimer(lua_State *luaVm)
+{
+    LuaVmExtended lua(luaVm);
+    TimerId id;
+    try {
+        double interval = lua.parseArgument(2, LuaArgumentType::LuaTypeNumber).toNumber();
+        double repeats = lua.parseArgument(3, LuaArgumentType::LuaTypeNumber).toNumber();
+        if (!(interval >= 1 && interval <= std::numeric_limits<unsigned int>::max())) {
+            throw LuaOutOfRange("Interval must be between 1 and " + std::to_string(std::numeric_limits<unsigned int>::max()));
+        }
+        if (!(repeats >= 0 && repeats <= std::numeric_limits<unsigned int>::max())) {
+            throw LuaOutOfRange("Times to execute must be between 0 and " + std::to_string(std::numeric_limits<unsigned int>::max()));
+        }
+
+        std::vector<LuaArgument> arguments;
+        const int top = lua_gettop(luaVm);
+        for (int i = 4; i <= top; i++) {
+            arguments.push_back(lua.parseArgument(i));
+        }
+
+        id = this->setTimer(
+            luaVm, 1, static_cast<unsigned int>(interval), static_cast<unsigned int>(repeats), std::move(arguments)
+        );
+    } catch (const LuaException &e) {
+        std::list<LuaArgument> result{LuaArgument(false), LuaArgument(e.what())};
+        return lua.pushArguments(result.cbegin(), result.cend());
+    }
+
+    lua.pushArgument(LuaArgument(static_cast<double>(id)));
+    return 1;
+}
+
+int LuaScheduler::luaKillTimer(lua_State *luaVm)
+{
+    LuaVmExtended lua(luaVm);
+    bool killed = false;
+    if (lua_type(luaVm, 1) == LUA_TNUMBER) {
+        double id = lua_tonumber(luaVm, 1);
+        if (id >= 1) {
+            auto timer = timers.find(static_cast<TimerId>(id));
+            // Lua can't kill timers of other resources
+            if (timer != timers.end() && timer->second->luaVm == luaVm) {
+                killed = this->killTimer(timer->first);
+            }
+        }
+    }
+
+    lua.pushArgument(LuaArgument(killed));
+    return 1;
+}
+
+LuaScheduler::TimerId LuaScheduler::add(std::unique_ptr<Timer> timer)
+{
+    Timer *pointer = timer.get();
+    pointer->id = nextId++;
+    pointer->expires = std::max(this->getTick(Clock::now()), current) + pointer->interval;
+    timers.emplace(pointer->id, std::move(timer));
+    this->insert(pointer);
+    return pointer->id;
+}
+
+void LuaScheduler::insert(Timer *timer)
+{
+    // Level is chosen by distance, slot by expiration bits of the level
+    uint64_t expires = timer->expires;
+    const uint64_t delta = expires - current;
+    unsigned int level = 0;
+    while (level < LEVELS - 1 && delta >= (uint64_t(1) << (SLOT_BITS * (level + 1)))) {
+        level++;
+    }
+    const uint64_t range = uint64_t(1) << (SLOT_BITS * LEVELS);
+    if (delta >= range) {
+        expires = current + range - 1;              // Re-inserted on cascade until in range
+    }
+
+    Timer *&head = wheel[level][(expires >> (SLOT_BITS * level)) & (SLOTS - 1)];
+    timer->previous = nullptr;
+    timer->next = head;
+    if (head) {
+        head->previous = timer;
+    }
+    head = timer;
+    timer->slot = &head;
+    scheduled++;
+}
+
+void LuaScheduler::unlink(Timer *timer)
+{
+    if (!timer->slot) {
+        return;
+    }
+
+    if (timer->previous) {
+        timer->previous->next = timer->next;
+    } else {
+        *timer->slot = timer->next;
+    }
+    if (timer->next) {
+        timer->next->previous = timer->previous;
+    }
+    timer->previous = nullptr;
+    timer->next = nullptr;
+    timer->slot = nullptr;
+}
+
+void LuaScheduler::advance(uint64_t tick)
+{
+    while (current < tick) {
+        if (scheduled == 0) {
+            current = tick;                         // Nothing to expire on the way
+            return;
+        }
+
+        current++;
+        const unsigned int index = current & (SLOTS - 1);
+        if (index == 0) {
+            for (unsigned int level = 1; level < LEVELS; level++) {
+                this->cascade(level);
+                if ((current >> (SLOT_BITS * level)) & (SLOTS - 1)) {
+                    break;
+                }
+            }
+        }
+
+        Timer *timer = wheel[0][index];
+        wheel[0][index] = nullptr;
+        while (timer) {
+            Timer *next = timer->next;
+            timer->previous = nullptr;
+            timer->next = nullptr;
+            timer->slot = nullptr;
+            scheduled--;
+            due.push_back(timer->id);
+            timer = next;
+        }
+    }
+}
+
+void LuaScheduler::cascade(unsigned int level)
+{
+    Timer *&head = wheel[level][(current >> (SLOT_BITS * level)) & (SLOTS - 1)];
+    Timer *timer = head;
+    head = nullptr;
+    while (timer) {
+        Timer *next = timer->next;
+        timer->slot = nullptr;
+        scheduled--;
+        this->insert(timer);
+        timer = next;
+    }
+}
+
+void LuaScheduler::fire(Timer *timer)
+{
+    const TimerId id = timer->id;
+    firing = id;
+    firingKilled = false;
+
+    if (timer->luaVm) {
+        try {
+            LuaVmExtended(timer->luaVm).callReference(timer->reference, timer->arguments);
+        } catch (const LuaException &e) {
+            if (errorHandler) {
+                errorHandler(timer->luaVm, e.what());
+            }
+        }
+    } else {
+        try {
+            timer->callback();
+        } catch (const std::exception &e) {
+            if (errorHandler) {
+                errorHandler(nullptr, e.what());
+            }
+        }
+    }
+
+    firing = 0;
+    if (firingKilled) {
+        timers.erase(id);                           // Removal has been delayed until callback return
+        return;
+    }
+
+    if (timer->repeats == 1) {
+        this->remove(id, true);
+        return;
+    }
+    if (timer->repeats > 1) {
+        timer->repeats--;
+    }
+
+    // Keep the period, but don't expire in the past after a long pulse
+    timer->expires = std::max(timer->expires + timer->interval, current + 1);
+    this->insert(timer);
+}
+
+void LuaScheduler::remove(TimerId id, bool releaseReference)
+{
+    auto found = timers.find(id);
+    if (found == timers.end()) {
+        return;
+    }
+
+    Timer *timer = found->second.get();
+    if (timer->slot) {
+        unlink(timer);
+        scheduled--;
+    }
+    if (releaseReference && timer->luaVm) {
+        luaL_unref(timer->luaVm, LUA_REGISTRYINDEX, timer->reference);
+    }
+
+    if (id == firing) {
+        firingKilled = true;
+        timer->luaVm = nullptr;                     // Reference has been handled
+        return;
+    }
+    timers.erase(found);
+}
+
+uint64_t LuaScheduler::getTick(Clock::time_point time) const
+{
+    if (time <= start) {
+        return 0;
+    }
+    return std::chrono::duration_cast<std::chrono::milliseconds>(time - start).count();
+}
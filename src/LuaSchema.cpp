@@ -0,0 +1,452 @@
+#include "ModuleSdk/LuaSchema.h"
+#include "ModuleSdk/LuaVmExtended.h"
+#include "lua/lauxlib.h"
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+
+namespace
+{
+
+const size_t NO_FIELD = std::numeric_limits<size_t>::max();
+
+/**
+ * @brief Check stack value type (same rules as LuaVmExtended::parseArgument)
+ */
+bool checkType(lua_State *luaVm, int index, LuaArgumentType type)
+{
+    switch (type) {
+        case LuaArgumentType::LuaTypeBoolean:
+            return lua_isboolean(luaVm, index);
+        case LuaArgumentType::LuaTypeNumber:
+        case LuaArgumentType::LuaTypeInteger:
+            return lua_isnumber(luaVm, index) != 0;
+        case LuaArgumentType::LuaTypeString:
+            return lua_isstring(luaVm, index) != 0;
+        case LuaArgumentType::LuaTypeUserdata:
+        case LuaArgumentType::LuaTypeLightUserdata:
+        case LuaArgumentType::LuaTypeObject:
+            return lua_isuserdata(luaVm, index) != 0;
+        case LuaArgumentType::LuaTypeTableMap:
+        case LuaArgumentType::LuaTypeTableList:
+        case LuaArgumentType::LuaTypeDoubleArray:
+        case LuaArgumentType::LuaTypeFloatArray:
+        case LuaArgumentType::LuaTypeInt32Array:
+            return lua_istable(luaVm, index);
+        case LuaArgumentType::LuaTypeNil:
+            return true;
+    }
+    return false;
+}
+
+bool isTypedArray(LuaArgumentType type)
+{
+    return type == LuaArgumentType::LuaTypeDoubleArray
+        || type == LuaArgumentType::LuaTypeFloatArray
+        || type == LuaArgumentType::LuaTypeInt32Array;
+}
+
+/**
+ * @brief Check typed array element (same rules as LuaVmExtended::parseArgument)
+ */
+bool checkElement(lua_State *luaVm, int index, LuaArgumentType type)
+{
+    if (lua_type(luaVm, index) != LUA_TNUMBER) {
+        return false;
+    }
+    const lua_Number value = lua_tonumber(luaVm, index);
+    return type != LuaArgumentType::LuaTypeInt32Array
+        || (value > static_cast<lua_Number>(INT32_MIN) - 1 && value < static_cast<lua_Number>(INT32_MAX) + 1);
+}
+
+/**
+ * @brief Parse stack value with already checked type
+ */
+LuaArgument parseValue(lua_State *luaVm, int index, LuaArgumentType type)
+{
+    LuaVmExtended lua(luaVm);
+    if (type == LuaArgumentType::LuaTypeTableList) {
+        return LuaArgument(lua.parseArgument(index, LuaArgumentType::LuaTypeTableMap, true).toList());
+    }
+    if (type == LuaArgumentType::LuaTypeLightUserdata) {
+        return LuaArgument(lua_touserdata(luaVm, index), LuaArgument::PointerLightuserdata);
+    }
+    return lua.parseArgument(index, type, true);
+}
+
+}
+
+LuaSchema &LuaSchema::field(std::string name, LuaArgumentType type, bool optional)
+{
+    fields.push_back(Field{Kind::Scalar, std::move(name), type, optional, nullptr});
+    return *this;
+}
+
+LuaSchema &LuaSchema::field(std::string name, const LuaSchema &record, bool optional)
+{
+    fields.push_back(Field{
+        Kind::Record,
+        std::move(name),
+        LuaArgumentType::LuaTypeTableMap,
+        optional,
+        std::make_shared<const LuaSchema>(record)
+    });
+    return *this;
+}
+
+LuaSchema &LuaSchema::list(std::string name, LuaArgumentType type, bool optional)
+{
+    fields.push_back(Field{Kind::ScalarList, std::move(name), type, optional, nullptr});
+    return *this;
+}
+
+LuaSchema &LuaSchema::list(std::string name, const LuaSchema &record, bool optional)
+{
+    fields.push_back(Field{
+        Kind::RecordList,
+        std::move(name),
+        LuaArgumentType::LuaTypeTableMap,
+        optional,
+        std::make_shared<const LuaSchema>(record)
+    });
+    return *this;
+}
+
+LuaCompiledSchema LuaSchema::compile(lua_State *luaVm) const
+{
+    return LuaCompiledSchema(luaVm, *this);
+}
+
+LuaCompiledSchema::LuaCompiledSchema(lua_State *luaVm, const LuaSchema &schema)
+    : luaVm(luaVm)
+{
+    std::unordered_map<std::string, int> interned;
+    try {
+        this->emit(schema, 0, interned);
+    } catch (...) {
+        this->release();
+        throw;
+    }
+}
+
+LuaCompiledSchema::LuaCompiledSchema(LuaCompiledSchema &&schema) noexcept
+    : luaVm(schema.luaVm),
+      instructions(std::move(schema.instructions)),
+      names(std::move(schema.names)),
+      nameArguments(std::move(schema.nameArguments)),
+      keys(std::move(schema.keys)),
+      maxDepth(schema.maxDepth)
+{
+    schema.keys.clear();
+}
+
+LuaCompiledSchema &LuaCompiledSchema::operator=(LuaCompiledSchema &&schema) noexcept
+{
+    this->release();
+
+    luaVm = schema.luaVm;
+    instructions = std::move(schema.instructions);
+    names = std::move(schema.names);
+    nameArguments = std::move(schema.nameArguments);
+    keys = std::move(schema.keys);
+    maxDepth = schema.maxDepth;
+    schema.keys.clear();
+
+    return *this;
+}
+
+LuaCompiledSchema::~LuaCompiledSchema()
+{
+    this->release();
+}
+
+LuaArgument LuaCompiledSchema::extract(int index) const
+{
+    return this->run(index, true);
+}
+
+bool LuaCompiledSchema::validate(int index, std::string *path) const
+{
+    try {
+        this->run(index, false);
+    } catch (const LuaSchemaMismatch &e) {
+        if (path) {
+            *path = e.getPath();
+        }
+        return false;
+    }
+    return true;
+}
+
+void LuaCompiledSchema::emit(const LuaSchema &schema,
+                             unsigned int depth,
+                             std::unordered_map<std::string, int> &interned)
+{
+    maxDepth = std::max(maxDepth, depth);
+
+    for (const LuaSchema::Field &field : schema.fields) {
+        auto it = interned.find(field.name);
+        if (it == interned.end()) {
+            lua_pushlstring(luaVm, field.name.c_str(), field.name.size());
+            keys.push_back(luaL_ref(luaVm, LUA_REGISTRYINDEX));
+            it = interned.emplace(field.name, keys.back()).first;
+        }
+
+        Opcode opcode = Opcode::Scalar;
+        unsigned int nestedDepth = depth;
+        if (field.kind == LuaSchema::Kind::Record) {
+            opcode = Opcode::Record;
+            nestedDepth = depth + 1;                            // Record table
+        } else if (field.kind == LuaSchema::Kind::ScalarList) {
+            opcode = Opcode::ScalarList;
+        } else if (field.kind == LuaSchema::Kind::RecordList) {
+            opcode = Opcode::RecordList;
+            nestedDepth = depth + 2;                            // List and element tables
+        }
+
+        size_t position = instructions.size();
+        instructions.push_back(Instruction{opcode, it->second, names.size(), field.type, field.optional, 0});
+        names.push_back(field.name);
+        nameArguments.emplace_back(field.name);
+
+        if (field.record) {
+            this->emit(*field.record, nestedDepth, interned);
+            instructions.push_back(Instruction{Opcode::End, LUA_NOREF, 0, LuaArgumentType::LuaTypeNil, false, 0});
+            instructions[position].end = instructions.size() - 1;
+        }
+    }
+}
+
+LuaArgument LuaCompiledSchema::run(int index, bool store) const
+{
+    /// Opened table
+    struct Context
+    {
+        size_t opener;                              ///< Opening instruction (NO_FIELD for root)
+        int table;                                  ///< Absolute stack index
+        int element;                                ///< Current element (lists)
+        bool isList;
+        LuaArgument::TableMapType record;           ///< Extracted record
+        LuaArgument::TableListType list;            ///< Extracted list
+    };
+
+    if (index < 0 && index > LUA_REGISTRYINDEX) {
+        index = lua_gettop(luaVm) + index + 1;
+    }
+    if (!lua_istable(luaVm, index)) {
+        throw LuaSchemaMismatch(
+            "(root)",
+            LuaArgumentType::LuaTypeTableMap,
+            static_cast<LuaArgumentType>(lua_type(luaVm, index))
+        );
+    }
+    if (!lua_checkstack(luaVm, static_cast<int>(maxDepth) + 3)) {     // Tables, key, list and element
+        throw LuaParseLimitExceeded("Lua stack limit exceeded");
+    }
+
+    const int top = lua_gettop(luaVm);
+    std::vector<Context> contexts;
+    contexts.reserve(maxDepth + 1);
+    contexts.push_back(Context{NO_FIELD, index, 0, false, {}, {}});
+
+    // Field path is built on failure only
+    auto path = [&](size_t field, int element) -> std::string
+    {
+        std::string result;
+        for (size_t i = 1; i < contexts.size(); i++) {
+            if (contexts[i - 1].isList) {
+                result += "[" + std::to_string(contexts[i - 1].element) + "]";
+                continue;
+            }
+            if (!result.empty()) {
+                result += ".";
+            }
+            result += names[instructions[contexts[i].opener].name];
+        }
+        if (field != NO_FIELD) {
+            if (!result.empty()) {
+                result += ".";
+            }
+            result += names[instructions[field].name];
+        }
+        if (element > 0) {
+            result += "[" + std::to_string(element) + "]";
+        }
+        return result;
+    };
+
+    // Enters the next list element or leaves the list. Returns next instruction
+    auto nextElement = [&]() -> size_t
+    {
+        Context &list = contexts.back();
+        const Instruction &instruction = instructions[list.opener];
+
+        list.element++;
+        lua_rawgeti(luaVm, list.table, list.element);
+        int type = lua_type(luaVm, -1);
+        if (type == LUA_TNIL) {
+            lua_pop(luaVm, 2);                      // Nil and list
+            LuaArgument value;
+            if (store) {
+                value = LuaArgument(std::move(list.list));
+            }
+            contexts.pop_back();
+            if (store) {
+                contexts.back().record.emplace(nameArguments[instruction.name], std::move(value));
+            }
+            return instruction.end + 1;
+        }
+        if (type != LUA_TTABLE) {
+            throw LuaSchemaMismatch(
+                path(NO_FIELD, list.element),
+                LuaArgumentType::LuaTypeTableMap,
+                static_cast<LuaArgumentType>(type)
+            );
+        }
+
+        size_t opener = list.opener;
+        contexts.push_back(Context{opener, lua_gettop(luaVm), 0, false, {}, {}});
+        return opener + 1;
+    };
+
+    try {
+        size_t position = 0;
+        while (position < instructions.size()) {
+            const Instruction &instruction = instructions[position];
+
+            if (instruction.opcode == Opcode::End) {
+                Context record = std::move(contexts.back());
+                contexts.pop_back();
+                lua_pop(luaVm, 1);                  // Record table
+
+                Context &parent = contexts.back();
+                if (parent.isList) {
+                    if (store) {
+                        parent.list.emplace_back(std::move(record.record));
+                    }
+                    position = nextElement();
+                } else {
+                    if (store) {
+                        parent.record.emplace(
+                            nameArguments[instructions[record.opener].name],
+                            LuaArgument(std::move(record.record))
+                        );
+                    }
+                    position++;
+                }
+                continue;
+            }
+
+            Context &current = contexts.back();
+            lua_rawgeti(luaVm, LUA_REGISTRYINDEX, instruction.key);         // Interned key
+            lua_rawget(luaVm, current.table);
+            int type = lua_type(luaVm, -1);
+
+            if (type == LUA_TNIL) {
+                lua_pop(luaVm, 1);
+                if (!instruction.optional) {
+                    throw LuaSchemaMismatch(path(position, 0));
+                }
+
+                bool block = instruction.opcode == Opcode::Record || instruction.opcode == Opcode::RecordList;
+                position = block ? instruction.end + 1 : position + 1;
+                continue;
+            }
+
+            if (instruction.opcode == Opcode::Scalar) {
+                if (!checkType(luaVm, -1, instruction.type)) {
+                    throw LuaSchemaMismatch(path(position, 0), instruction.type, static_cast<LuaArgumentType>(type));
+                }
+                if (isTypedArray(instruction.type)) {
+                    const int array = lua_gettop(luaVm);
+                    const int length = static_cast<int>(lua_objlen(luaVm, array));
+                    for (int element = 1; element <= length; element++) {
+                        lua_rawgeti(luaVm, array, element);
+                        if (!checkElement(luaVm, -1, instruction.type)) {
+                            throw LuaSchemaMismatch(
+                                path(position, element),
+                                instruction.type == LuaArgumentType::LuaTypeInt32Array
+                                    ? LuaArgumentType::LuaTypeInteger
+                                    : LuaArgumentType::LuaTypeNumber,
+                                static_cast<LuaArgumentType>(lua_type(luaVm, -1))
+                            );
+                        }
+                        lua_pop(luaVm, 1);
+                    }
+                }
+                if (store) {
+                    current.record.emplace(
+                        nameArguments[instruction.name],
+                        parseValue(luaVm, lua_gettop(luaVm), instruction.type)
+                    );
+                }
+                lua_pop(luaVm, 1);
+                position++;
+                continue;
+            }
+
+            if (type != LUA_TTABLE) {
+                throw LuaSchemaMismatch(
+                    path(position, 0),
+                    LuaArgumentType::LuaTypeTableMap,
+                    static_cast<LuaArgumentType>(type)
+                );
+            }
+
+            if (instruction.opcode == Opcode::ScalarList) {
+                int list = lua_gettop(luaVm);
+                LuaArgument::TableListType result;
+                if (store) {
+                    result.reserve(lua_objlen(luaVm, list));
+                }
+
+                for (int element = 1;; element++) {
+                    lua_rawgeti(luaVm, list, element);
+                    int elementType = lua_type(luaVm, -1);
+                    if (elementType == LUA_TNIL) {
+                        lua_pop(luaVm, 1);
+                        break;
+                    }
+                    if (!checkType(luaVm, -1, instruction.type)) {
+                        throw LuaSchemaMismatch(
+                            path(position, element),
+                            instruction.type,
+                            static_cast<LuaArgumentType>(elementType)
+                        );
+                    }
+                    if (store) {
+                        result.push_back(parseValue(luaVm, lua_gettop(luaVm), instruction.type));
+                    }
+                    lua_pop(luaVm, 1);
+                }
+
+                lua_pop(luaVm, 1);                  // List
+                if (store) {
+                    current.record.emplace(nameArguments[instruction.name], LuaArgument(std::move(result)));
+                }
+                position++;
+                continue;
+            }
+
+            bool isList = instruction.opcode == Opcode::RecordList;
+            contexts.push_back(Context{position, lua_gettop(luaVm), 0, isList, {}, {}});
+            position = isList ? nextElement() : position + 1;
+        }
+    } catch (...) {
+        lua_settop(luaVm, top);
+        throw;
+    }
+
+    if (!store) {
+        return LuaArgument();
+    }
+    return LuaArgument(std::move(contexts.front().record));
+}
+
+void LuaCompiledSchema::release() noexcept
+{
+    for (int key : keys) {
+        luaL_unref(luaVm, LUA_REGISTRYINDEX, key);
+    }
+    keys.clear();
+}
@@ -0,0 +1,470 @@
+#include "ModuleSdk/LuaSnapshot.h"
+#include <cstring>
+#include <limits>
+#include <new>
+
+/// Tree node. Table children are stored contiguously (map children are key, value pairs)
+struct LuaSnapshot::Node
+{
+    LuaTypeIndex type;
+    uint32_t size;                                  ///< String length, list items, map pairs or array elements
+    uint64_t offset;                                ///< Bytes offset (strings, arrays, object class) or first child node (tables)
+    union
+    {
+        bool boolean;
+        double number;
+        int integer;
+        uintptr_t handle;
+        unsigned long objectId;
+    } value;
+};
+
+/// Block header, followed by nodes (root is the first) and bytes
+struct LuaSnapshot::Header
+{
+    std::atomic<size_t> references;
+    size_t nodes;
+    size_t bytes;
+
+    const Node *getNodes() const
+    {
+        return reinterpret_cast<const Node *>(this + 1);
+    }
+
+    Node *getNodes()
+    {
+        return reinterpret_cast<Node *>(this + 1);
+    }
+
+    const char *getBytes() const
+    {
+        return reinterpret_cast<const char *>(this->getNodes() + nodes);
+    }
+
+    char *getBytes()
+    {
+        return reinterpret_cast<char *>(this->getNodes() + nodes);
+    }
+
+    size_t getMemorySize() const
+    {
+        return sizeof(Header) + nodes * sizeof(Node) + bytes;
+    }
+};
+
+namespace
+{
+
+/**
+ * @brief Round bytes amount up to 8 (keeps typed arrays aligned)
+ */
+size_t align(size_t size)
+{
+    return (size + 7) & ~size_t(7);
+}
+
+uint32_t checkSize(size_t size)
+{
+    if (size > std::numeric_limits<uint32_t>::max()) {
+        throw LuaOutOfRange("Snapshot table or string is too big");
+    }
+    return static_cast<uint32_t>(size);
+}
+
+}
+
+/// Two passes: measure the tree, then fill the allocated block
+struct LuaSnapshot::Builder
+{
+    static const Node NIL;                          ///< Node of nil views (nil snapshot root, missing map key)
+
+    size_t nodes = 0;
+    size_t bytes = 0;
+    Header *block = nullptr;
+    size_t nextNode = 1;
+    size_t nextByte = 0;
+
+    void measure(const LuaArgument &argument)
+    {
+        nodes++;
+        switch (argument.getTypeIndex()) {
+            case LuaTypeIndex::String:
+                bytes += align(argument.toString().size() + 1);
+                break;
+            case LuaTypeIndex::Object:
+                bytes += align(argument.toObject().getStringClass().size() + 1);
+                break;
+            case LuaTypeIndex::TableList:
+                for (const LuaArgument &item : argument.getList()) {
+                    this->measure(item);
+                }
+                break;
+            case LuaTypeIndex::TableMap:
+                for (const auto &pair : argument.getMap()) {
+                    this->measure(pair.first);
+                    this->measure(pair.second);
+                }
+                break;
+            case LuaTypeIndex::DoubleArray:
+                bytes += align(argument.toDoubleArray().size() * sizeof(double));
+                break;
+            case LuaTypeIndex::FloatArray:
+                bytes += align(argument.toFloatArray().size() * sizeof(float));
+                break;
+            case LuaTypeIndex::Int32Array:
+                bytes += align(argument.toInt32Array().size() * sizeof(int32_t));
+                break;
+            default:
+                break;
+        }
+    }
+
+    /**
+     * @brief Copy bytes into the block
+     * @return Bytes offset
+     */
+    uint64_t store(const void *data, size_t size, bool terminate)
+    {
+        char *target = block->getBytes() + nextByte;
+        if (size) {
+            std::memcpy(target, data, size);
+        }
+        if (terminate) {
+            target[size] = '\0';
+        }
+
+        const uint64_t offset = nextByte;
+        nextByte += align(size + (terminate ? 1 : 0));
+        return offset;
+    }
+
+    void fill(size_t index, const LuaArgument &argument)
+    {
+        Node &node = block->getNodes()[index];
+        node.type = argument.getTypeIndex();
+        node.size = 0;
+        node.offset = 0;
+        node.value.handle = 0;
+
+        switch (node.type) {
+            case LuaTypeIndex::Boolean:
+                node.value.boolean = argument.toBool();
+                break;
+            case LuaTypeIndex::Number:
+                node.value.number = argument.toNumber();
+                break;
+            case LuaTypeIndex::Integer:
+                node.value.integer = argument.toInteger();
+                break;
+            case LuaTypeIndex::LightUserdata:
+            case LuaTypeIndex::Userdata:
+                node.value.handle = reinterpret_cast<uintptr_t>(argument.toPointer());
+                break;
+            case LuaTypeIndex::String: {
+                const std::string &string = argument.toString();
+                node.size = checkSize(string.size());
+                node.offset = this->store(string.data(), string.size(), true);
+                break;
+            }
+            case LuaTypeIndex::Object: {
+                const LuaObject &object = argument.toObject();
+                node.value.objectId = object.getObjectId().id;
+                node.size = checkSize(object.getStringClass().size());
+                node.offset = this->store(object.getStringClass().data(), object.getStringClass().size(), true);
+                break;
+            }
+            case LuaTypeIndex::TableList: {
+                const auto &list = argument.getList();
+                node.size = checkSize(list.size());
+                node.offset = nextNode;
+                nextNode += list.size();
+
+                size_t child = node.offset;
+                for (const LuaArgument &item : list) {
+                    this->fill(child++, item);
+                }
+                break;
+            }
+            case LuaTypeIndex::TableMap: {
+                const auto &map = argument.getMap();
+                node.size = checkSize(map.size());
+                node.offset = nextNode;
+                nextNode += map.size() * 2;
+
+                size_t child = node.offset;
+                for (const auto &pair : map) {
+                    this->fill(child++, pair.first);
+                    this->fill(child++, pair.second);
+                }
+                break;
+            }
+            case LuaTypeIndex::DoubleArray: {
+                const auto &array = argument.toDoubleArray();
+                node.size = checkSize(array.size());
+                node.offset = this->store(array.data(), array.size() * sizeof(double), false);
+                break;
+            }
+            case LuaTypeIndex::FloatArray: {
+                const auto &array = argument.toFloatArray();
+                node.size = checkSize(array.size());
+                node.offset = this->store(array.data(), array.size() * sizeof(float), false);
+                break;
+            }
+            case LuaTypeIndex::Int32Array: {
+                const auto &array = argument.toInt32Array();
+                node.size = checkSize(array.size());
+                node.offset = this->store(array.data(), array.size() * sizeof(int32_t), false);
+                break;
+            }
+            default:
+                node.type = LuaTypeIndex::Nil;
+                break;
+        }
+    }
+};
+
+const LuaSnapshot::Node LuaSnapshot::Builder::NIL = {LuaTypeIndex::Nil, 0, 0, {false}};
+
+LuaSnapshot::LuaSnapshot(const LuaArgument &argument)
+{
+    Builder builder;
+    builder.measure(argument);
+
+    void *memory = ::operator new(sizeof(Header) + builder.nodes * sizeof(Node) + builder.bytes);
+    builder.block = new(memory) Header{{1}, builder.nodes, builder.bytes};
+    try {
+        builder.fill(0, argument);
+    } catch (...) {
+        builder.block->~Header();
+        ::operator delete(memory);
+        throw;
+    }
+    block = builder.block;
+}
+
+LuaSnapshot::LuaSnapshot(const LuaSnapshot &snapshot) noexcept
+    : block(snapshot.block)
+{
+    if (block) {
+        block->references.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+LuaSnapshot &LuaSnapshot::operator=(const LuaSnapshot &snapshot) noexcept
+{
+    if (block != snapshot.block) {
+        if (snapshot.block) {
+            snapshot.block->references.fetch_add(1, std::memory_order_relaxed);
+        }
+        this->release();
+        block = snapshot.block;
+    }
+    return *this;
+}
+
+LuaSnapshot &LuaSnapshot::operator=(LuaSnapshot &&snapshot) noexcept
+{
+    if (this != &snapshot) {
+        this->release();
+        block = snapshot.block;
+        snapshot.block = nullptr;
+    }
+    return *this;
+}
+
+size_t LuaSnapshot::getMemorySize() const
+{
+    return block ? block->getMemorySize() : 0;
+}
+
+LuaSnapshot::~LuaSnapshot()
+{
+    this->release();
+}
+
+void LuaSnapshot::release() noexcept
+{
+    if (block && block->references.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        block->~Header();
+        ::operator delete(block);
+    }
+    block = nullptr;
+}
+
+LuaSnapshot::View LuaSnapshot::getRoot() const
+{
+    return block ? View(block->getNodes(), block) : View(&Builder::NIL, nullptr);
+}
+
+LuaTypeIndex LuaSnapshot::View::getTypeIndex() const
+{
+    return node->type;
+}
+
+size_t LuaSnapshot::View::size() const
+{
+    return node->size;
+}
+
+bool LuaSnapshot::View::toBool() const
+{
+    this->check(LuaTypeIndex::Boolean);
+    return node->value.boolean;
+}
+
+double LuaSnapshot::View::toNumber() const
+{
+    this->check(LuaTypeIndex::Number);
+    return node->value.number;
+}
+
+int LuaSnapshot::View::toInteger() const
+{
+    this->check(LuaTypeIndex::Integer);
+    return node->value.integer;
+}
+
+const char *LuaSnapshot::View::toString() const
+{
+    this->check(LuaTypeIndex::String);
+    return this->getBytes();
+}
+
+LuaSnapshotHandle LuaSnapshot::View::toHandle() const
+{
+    if (!(node->type == LuaTypeIndex::LightUserdata || node->type == LuaTypeIndex::Userdata)) {
+        throw LuaUnexpectedArgumentType(LuaArgumentType::LuaTypeLightUserdata, this->getType());
+    }
+    return LuaSnapshotHandle{node->value.handle};
+}
+
+LuaObject LuaSnapshot::View::toObject() const
+{
+    this->check(LuaTypeIndex::Object);
+    return LuaObject(ObjectId(node->value.objectId), std::string(this->getBytes(), node->size));
+}
+
+const double *LuaSnapshot::View::toDoubleArray() const
+{
+    this->check(LuaTypeIndex::DoubleArray);
+    return reinterpret_cast<const double *>(this->getBytes());
+}
+
+const float *LuaSnapshot::View::toFloatArray() const
+{
+    this->check(LuaTypeIndex::FloatArray);
+    return reinterpret_cast<const float *>(this->getBytes());
+}
+
+const int32_t *LuaSnapshot::View::toInt32Array() const
+{
+    this->check(LuaTypeIndex::Int32Array);
+    return reinterpret_cast<const int32_t *>(this->getBytes());
+}
+
+LuaSnapshot::View LuaSnapshot::View::operator[](size_t index) const
+{
+    this->check(LuaTypeIndex::TableList);
+    if (index >= node->size) {
+        throw LuaOutOfRange("List index " + std::to_string(index) + " is out of range");
+    }
+    return this->child(index);
+}
+
+LuaSnapshot::View LuaSnapshot::View::getKey(size_t index) const
+{
+    this->check(LuaTypeIndex::TableMap);
+    if (index >= node->size) {
+        throw LuaOutOfRange("Map pair index " + std::to_string(index) + " is out of range");
+    }
+    return this->child(index * 2);
+}
+
+LuaSnapshot::View LuaSnapshot::View::getValue(size_t index) const
+{
+    this->check(LuaTypeIndex::TableMap);
+    if (index >= node->size) {
+        throw LuaOutOfRange("Map pair index " + std::to_string(index) + " is out of range");
+    }
+    return this->child(index * 2 + 1);
+}
+
+LuaSnapshot::View LuaSnapshot::View::find(const std::string &key) const
+{
+    this->check(LuaTypeIndex::TableMap);
+    for (size_t i = 0; i < node->size; i++) {
+        View candidate = this->child(i * 2);
+        if (candidate.node->type == LuaTypeIndex::String && candidate.node->size == key.size()
+            && std::memcmp(candidate.getBytes(), key.data(), key.size()) == 0) {
+            return this->child(i * 2 + 1);
+        }
+    }
+    return View(&Builder::NIL, block);
+}
+
+LuaArgument LuaSnapshot::View::toArgument() const
+{
+    switch (node->type) {
+        case LuaTypeIndex::Boolean:
+            return LuaArgument(node->value.boolean);
+        case LuaTypeIndex::Number:
+            return LuaArgument(node->value.number);
+        case LuaTypeIndex::Integer:
+            return LuaArgument(node->value.integer);
+        case LuaTypeIndex::LightUserdata:
+            return LuaArgument(reinterpret_cast<void *>(node->value.handle), LuaArgument::PointerLightuserdata);
+        case LuaTypeIndex::Userdata:
+            return LuaArgument(reinterpret_cast<void *>(node->value.handle), LuaArgument::PointerUserdata);
+        case LuaTypeIndex::String:
+            return LuaArgument(std::string(this->getBytes(), node->size));
+        case LuaTypeIndex::Object:
+            return LuaArgument(this->toObject());
+        case LuaTypeIndex::TableList: {
+            LuaArgument::TableListType list;
+            list.reserve(node->size);
+            for (size_t i = 0; i < node->size; i++) {
+                list.push_back(this->child(i).toArgument());
+            }
+            return LuaArgument(std::move(list));
+        }
+        case LuaTypeIndex::TableMap: {
+            LuaArgument::TableMapType map;
+            map.reserve(node->size);
+            for (size_t i = 0; i < node->size; i++) {
+                map.emplace(this->child(i * 2).toArgument(), this->child(i * 2 + 1).toArgument());
+            }
+            return LuaArgument(std::move(map));
+        }
+        case LuaTypeIndex::DoubleArray: {
+            const double *data = this->toDoubleArray();
+            return LuaArgument(LuaArgument::DoubleArrayType(data, data + node->size));
+        }
+        case LuaTypeIndex::FloatArray: {
+            const float *data = this->toFloatArray();
+            return LuaArgument(LuaArgument::FloatArrayType(data, data + node->size));
+        }
+        case LuaTypeIndex::Int32Array: {
+            const int32_t *data = this->toInt32Array();
+            return LuaArgument(LuaArgument::Int32ArrayType(data, data + node->size));
+        }
+        default:
+            return LuaArgument();
+    }
+}
+
+void LuaSnapshot::View::check(LuaTypeIndex type) const
+{
+    if (node->type != type) {
+        throw LuaUnexpectedArgumentType(TYPE_BY_INDEX[static_cast<int>(type)], this->getType());
+    }
+}
+
+LuaSnapshot::View LuaSnapshot::View::child(size_t index) const
+{
+    return View(block->getNodes() + node->offset + index, block);
+}
+
+const char *LuaSnapshot::View::getBytes() const
+{
+    return block->getBytes() + node->offset;
+}
@@ -0,0 +1,55 @@
+#include "ModuleSdk/LuaStackView.h"
+#include "ModuleSdk/LuaVmExtended.h"
+
+bool LuaStackValue::toBool() const
+{
+    if (!this->isBool()) {
+        throw LuaUnexpectedType(LuaArgumentType::LuaTypeBoolean, this->getType(), index);
+    }
+    return lua_toboolean(luaVm, index) != 0;
+}
+
+double LuaStackValue::toNumber() const
+{
+    if (!this->isNumber()) {
+        throw LuaUnexpectedType(LuaArgumentType::LuaTypeNumber, this->getType(), index);
+    }
+    return static_cast<double>(lua_tonumber(luaVm, index));
+}
+
+int LuaStackValue::toInteger() const
+{
+    if (!this->isNumber()) {
+        throw LuaUnexpectedType(LuaArgumentType::LuaTypeInteger, this->getType(), index);
+    }
+    return static_cast<int>(lua_tointeger(luaVm, index));
+}
+
+const char *LuaStackValue::toString(size_t *length) const
+{
+    if (!this->isString()) {
+        throw LuaUnexpectedType(LuaArgumentType::LuaTypeString, this->getType(), index);
+    }
+    return lua_tolstring(luaVm, index, length);
+}
+
+void *LuaStackValue::toPointer() const
+{
+    if (!this->isUserdata()) {
+        throw LuaUnexpectedType(LuaArgumentType::LuaTypeUserdata, this->getType(), index);
+    }
+    return lua_touserdata(luaVm, index);
+}
+
+LuaArgument LuaStackValue::parse() const
+{
+    return LuaVmExtended(luaVm).parseArgument(index);
+}
+
+LuaStackValue LuaStackView::at(size_t position) const
+{
+    if (position >= this->size()) {
+        throw LuaOutOfRange("Stack view position " + std::to_string(position) + " is out of range");
+    }
+    return (*this)[position];
+}
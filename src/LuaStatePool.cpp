@@ -0,0 +1,413 @@
+#include "ModuleSdk/LuaStatePool.h"
+#include "ModuleSdk/LuaVmExtended.h"
+#include "lua/lauxlib.h"
+#include "lua/lualib.h"
+#include <cstring>
+#include <list>
+#include <stdexcept>
+
+namespace
+{
+
+constexpr int HOOK_INSTRUCTIONS = 1000;             ///< Instructions between limit checks
+
+char CHUNKS_CACHE_KEY;                              ///< Registry key of compiled chunks (code -> function)
+char ENVIRONMENT_KEY;                               ///< Registry key of the chunk environment metatable
+char LIBRARIES_KEY;                                 ///< Registry key of library proxy metatables (name -> metatable)
+char CALL_ENVIRONMENT_KEY;                          ///< Registry key of the current call environment
+
+/// Globals, which are not copied to chunk environments (file access, environments, binary chunks)
+const char *const HIDDEN_GLOBALS[] = {"_G", "dofile", "loadfile", "load", "getfenv", "setfenv"};
+
+bool isBinary(const char *code, size_t size)
+{
+    return size > 0 && code[0] == LUA_SIGNATURE[0];
+}
+
+/**
+ * @brief loadstring of chunks: source only, loaded functions get the current call environment
+ */
+int loadString(lua_State *luaVm)
+{
+    size_t size = 0;
+    const char *code = luaL_checklstring(luaVm, 1, &size);
+    const char *name = luaL_optstring(luaVm, 2, code);
+    if (isBinary(code, size)) {
+        lua_pushnil(luaVm);
+        lua_pushstring(luaVm, "Binary chunks are not allowed");
+        return 2;
+    }
+    if (luaL_loadbuffer(luaVm, code, size, name) != 0) {
+        lua_pushnil(luaVm);
+        lua_insert(luaVm, -2);
+        return 2;
+    }
+
+    lua_pushlightuserdata(luaVm, &CALL_ENVIRONMENT_KEY);
+    lua_rawget(luaVm, LUA_REGISTRYINDEX);
+    lua_setfenv(luaVm, -2);
+    return 1;
+}
+
+/**
+ * @brief Lua state of the current worker thread
+ * @details Chunks run in a fresh environment per call, which reads base functions from a private copy
+ * and gets its own proxies of library tables. Nothing written by a call is seen by the next one
+ * (the state is shared by resources). Binary chunks are rejected.
+ */
+struct WorkerState
+{
+    lua_State *luaVm;
+    size_t chunks = 0;                              ///< Cached chunks amount
+    size_t instructionsLeft = 0;                    ///< Current call budget
+
+    WorkerState()
+        : luaVm(luaL_newstate())
+    {
+        if (!luaVm) {
+            return;
+        }
+
+        this->open(luaopen_base, "");
+        this->open(luaopen_table, LUA_TABLIBNAME);
+        this->open(luaopen_string, LUA_STRLIBNAME);
+        this->open(luaopen_math, LUA_MATHLIBNAME);
+
+        this->createSandbox();
+        this->resetCache();
+    }
+
+    WorkerState(const WorkerState &) = delete;
+
+    WorkerState &operator=(const WorkerState &) = delete;
+
+    ~WorkerState()
+    {
+        if (luaVm) {
+            lua_close(luaVm);
+        }
+    }
+
+    void open(lua_CFunction function, const char *name)
+    {
+        lua_pushcfunction(luaVm, function);
+        lua_pushstring(luaVm, name);
+        lua_call(luaVm, 1, 0);
+    }
+
+    void createSandbox()
+    {
+        // String methods are reached through the string metatable
+        lua_pushliteral(luaVm, "");
+        lua_getmetatable(luaVm, -1);
+        lua_pushboolean(luaVm, 0);
+        lua_setfield(luaVm, -2, "__metatable");
+        lua_pop(luaVm, 2);
+
+        lua_newtable(luaVm);                        // Functions
+        lua_newtable(luaVm);                        // Library metatables
+        lua_pushnil(luaVm);
+        while (lua_next(luaVm, LUA_GLOBALSINDEX) != 0) {
+            if (lua_type(luaVm, -2) != LUA_TSTRING || isHidden(lua_tostring(luaVm, -2))) {
+                lua_pop(luaVm, 1);
+                continue;
+            }
+
+            lua_pushvalue(luaVm, -2);
+            if (lua_istable(luaVm, -2)) {
+                lua_createtable(luaVm, 0, 2);
+                lua_pushvalue(luaVm, -3);
+                lua_setfield(luaVm, -2, "__index");
+                lua_pushboolean(luaVm, 0);
+                lua_setfield(luaVm, -2, "__metatable");
+                lua_rawset(luaVm, -5);
+            } else {
+                lua_pushvalue(luaVm, -2);
+                lua_rawset(luaVm, -6);
+            }
+            lua_pop(luaVm, 1);                      // Value
+        }
+
+        lua_pushcfunction(luaVm, loadString);
+        lua_setfield(luaVm, -3, "loadstring");
+
+        lua_pushlightuserdata(luaVm, &LIBRARIES_KEY);
+        lua_insert(luaVm, -2);
+        lua_rawset(luaVm, LUA_REGISTRYINDEX);
+
+        lua_createtable(luaVm, 0, 2);
+        lua_insert(luaVm, -2);
+        lua_setfield(luaVm, -2, "__index");
+        lua_pushboolean(luaVm, 0);
+        lua_setfield(luaVm, -2, "__metatable");
+        lua_pushlightuserdata(luaVm, &ENVIRONMENT_KEY);
+        lua_insert(luaVm, -2);
+        lua_rawset(luaVm, LUA_REGISTRYINDEX);
+    }
+
+    static bool isHidden(const char *name)
+    {
+        for (const char *hidden : HIDDEN_GLOBALS) {
+            if (!strcmp(name, hidden)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * @brief Set a fresh environment of the chunk at the stack top
+     */
+    void setEnvironment()
+    {
+        lua_newtable(luaVm);
+        lua_pushlightuserdata(luaVm, &LIBRARIES_KEY);
+        lua_rawget(luaVm, LUA_REGISTRYINDEX);
+        lua_pushnil(luaVm);
+        while (lua_next(luaVm, -2) != 0) {
+            lua_newtable(luaVm);
+            lua_insert(luaVm, -2);
+            lua_setmetatable(luaVm, -2);
+            lua_pushvalue(luaVm, -2);
+            lua_insert(luaVm, -2);
+            lua_rawset(luaVm, -5);
+        }
+        lua_pop(luaVm, 1);                          // Library metatables
+
+        lua_pushvalue(luaVm, -1);
+        lua_setfield(luaVm, -2, "_G");
+        lua_pushlightuserdata(luaVm, &ENVIRONMENT_KEY);
+        lua_rawget(luaVm, LUA_REGISTRYINDEX);
+        lua_setmetatable(luaVm, -2);
+
+        lua_pushlightuserdata(luaVm, &CALL_ENVIRONMENT_KEY);
+        lua_pushvalue(luaVm, -2);
+        lua_rawset(luaVm, LUA_REGISTRYINDEX);
+        lua_setfenv(luaVm, -2);
+    }
+
+    void resetCache()
+    {
+        lua_pushlightuserdata(luaVm, &CHUNKS_CACHE_KEY);
+        lua_newtable(luaVm);
+        lua_rawset(luaVm, LUA_REGISTRYINDEX);
+        chunks = 0;
+    }
+
+    /**
+     * @brief Push compiled chunk
+     * @throws std::runtime_error Syntax error
+     */
+    void pushChunk(const std::string &code, size_t cacheSize)
+    {
+        lua_pushlightuserdata(luaVm, &CHUNKS_CACHE_KEY);
+        lua_rawget(luaVm, LUA_REGISTRYINDEX);
+        lua_pushlstring(luaVm, code.data(), code.size());
+        lua_rawget(luaVm, -2);
+        if (lua_type(luaVm, -1) == LUA_TFUNCTION) {
+            lua_remove(luaVm, -2);
+            return;
+        }
+        lua_pop(luaVm, 2);
+
+        if (isBinary(code.data(), code.size())) {
+            throw std::runtime_error("Binary chunks are not allowed");
+        }
+        if (luaL_loadbuffer(luaVm, code.data(), code.size(), "=worker") != 0) {
+            std::string message = lua_tostring(luaVm, -1);
+            lua_pop(luaVm, 1);
+            throw std::runtime_error(message);
+        }
+
+        if (chunks >= cacheSize) {
+            this->resetCache();
+        }
+        lua_pushlightuserdata(luaVm, &CHUNKS_CACHE_KEY);
+        lua_rawget(luaVm, LUA_REGISTRYINDEX);
+        lua_pushlstring(luaVm, code.data(), code.size());
+        lua_pushvalue(luaVm, -3);
+        lua_rawset(luaVm, -3);
+        lua_pop(luaVm, 1);
+        chunks++;
+    }
+};
+
+WorkerState &getWorkerState()
+{
+    thread_local WorkerState state;
+    return state;
+}
+
+void limitHook(lua_State *luaVm, lua_Debug *)
+{
+    WorkerState &state = getWorkerState();
+    if (state.instructionsLeft <= HOOK_INSTRUCTIONS) {
+        luaL_error(luaVm, "Instructions limit exceeded");
+    }
+    state.instructionsLeft -= HOOK_INSTRUCTIONS;
+}
+
+/**
+ * @brief Push snapshot node without building LuaArgument
+ */
+void pushView(lua_State *luaVm, const LuaSnapshot::View &view)
+{
+    if (!lua_checkstack(luaVm, 3)) {
+        throw LuaOutOfRange("Lua stack limit exceeded");
+    }
+
+    switch (view.getTypeIndex()) {
+        case LuaTypeIndex::Nil:
+            lua_pushnil(luaVm);
+            break;
+        case LuaTypeIndex::Boolean:
+            lua_pushboolean(luaVm, view.toBool());
+            break;
+        case LuaTypeIndex::Number:
+            lua_pushnumber(luaVm, view.toNumber());
+            break;
+        case LuaTypeIndex::Integer:
+            lua_pushnumber(luaVm, view.toInteger());
+            break;
+        case LuaTypeIndex::String:
+            lua_pushlstring(luaVm, view.toString(), view.size());
+            break;
+        case LuaTypeIndex::LightUserdata:
+        case LuaTypeIndex::Userdata:
+            lua_pushlightuserdata(luaVm, reinterpret_cast<void *>(view.toHandle().value));
+            break;
+        case LuaTypeIndex::TableList:
+            lua_createtable(luaVm, static_cast<int>(view.size()), 0);
+            for (size_t i = 0; i < view.size(); i++) {
+                pushView(luaVm, view[i]);
+                lua_rawseti(luaVm, -2, static_cast<int>(i + 1));
+            }
+            break;
+        case LuaTypeIndex::TableMap:
+            lua_createtable(luaVm, 0, static_cast<int>(view.size()));
+            for (size_t i = 0; i < view.size(); i++) {
+                pushView(luaVm, view.getKey(i));
+                pushView(luaVm, view.getValue(i));
+                lua_rawset(luaVm, -3);
+            }
+            break;
+        case LuaTypeIndex::Object:
+            throw std::runtime_error("Worker arguments can't contain MTASA objects");
+        default:
+            LuaVmExtended(luaVm).pushArgument(view.toArgument());   // Typed arrays
+            break;
+    }
+}
+
+/**
+ * @brief Check, that result does not refer to the worker state
+ */
+void checkResult(const LuaArgument &argument)
+{
+    switch (argument.getTypeIndex()) {
+        case LuaTypeIndex::Userdata:
+        case LuaTypeIndex::Object:
+            throw std::runtime_error("Worker results can't contain userdata");
+        case LuaTypeIndex::TableList:
+            for (const LuaArgument &item : argument.getList()) {
+                checkResult(item);
+            }
+            break;
+        case LuaTypeIndex::TableMap:
+            for (const auto &pair : argument.getMap()) {
+                checkResult(pair.first);
+                checkResult(pair.second);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+}
+
+LuaStatePool::LuaStatePool(unsigned int threads, size_t instructionsLimit, size_t chunksCacheSize)
+    : pool(threads), instructionsLimit(instructionsLimit), chunksCacheSize(chunksCacheSize ? chunksCacheSize : 1)
+{}
+
+void LuaStatePool::submit(lua_State *luaVm, int callbackIndex, std::string code, LuaSnapshot arguments)
+{
+    const size_t limit = instructionsLimit;
+    const size_t cacheSize = chunksCacheSize;
+    pool.submit(
+        luaVm,
+        callbackIndex,
+        [code, arguments, limit, cacheSize]() -> std::vector<LuaArgument>
+        {
+            WorkerState &state = getWorkerState();
+            if (!state.luaVm) {
+                throw std::runtime_error("Unable to create worker lua state");
+            }
+
+            lua_State *worker = state.luaVm;
+            lua_settop(worker, 0);
+            state.pushChunk(code, cacheSize);
+            state.setEnvironment();
+
+            int size = 0;
+            const LuaSnapshot::View root = arguments.getRoot();
+            if (root.getTypeIndex() == LuaTypeIndex::TableList) {
+                for (size_t i = 0; i < root.size(); i++) {
+                    pushView(worker, root[i]);
+                }
+                size = static_cast<int>(root.size());
+            } else if (!root.isNil()) {
+                pushView(worker, root);
+                size = 1;
+            }
+
+            if (limit) {
+                state.instructionsLeft = limit;
+                lua_sethook(worker, limitHook, LUA_MASKCOUNT, HOOK_INSTRUCTIONS);
+            }
+            const int status = lua_pcall(worker, size, LUA_MULTRET, 0);
+            if (limit) {
+                lua_sethook(worker, nullptr, 0, 0);
+            }
+            if (status != 0) {
+                const char *message = lua_tostring(worker, -1);
+                std::string error = message ? message : "Error object is not a string";
+                lua_settop(worker, 0);
+                throw std::runtime_error(error);
+            }
+
+            std::vector<LuaArgument> results;
+            LuaVmExtended lua(worker);
+            const int top = lua_gettop(worker);
+            results.reserve(top);
+            for (int i = 1; i <= top; i++) {
+                results.push_back(lua.parseArgument(i));
+                checkResult(results.back());
+            }
+            lua_settop(worker, 0);
+            return results;
+        }
+    );
+}
+
+int LuaStatePool::luaRun(lua_State *luaVm)
+{
+    LuaVmExtended lua(luaVm);
+    try {
+        std::string code = lua.parseArgument(1, LuaArgumentType::LuaTypeString).toString();
+
+        LuaArgument::TableListType arguments;
+        const int top = lua_gettop(luaVm);
+        for (int i = 3; i <= top; i++) {
+            arguments.push_back(lua.parseArgument(i));
+        }
+
+        this->submit(luaVm, 2, std::move(code), LuaSnapshot(LuaArgument(std::move(arguments))));
+    } catch (const LuaException &e) {
+        std::list<LuaArgument> result{LuaArgument(false), LuaArgument(e.what())};
+        return lua.pushArguments(result.cbegin(), result.cend());
+    }
+
+    lua.pushArgument(LuaArgument(true));
+    return 1;
+}
@@ -0,0 +1,60 @@
+#include "ModuleSdk/LuaStatsOutput.h"
+#include "ModuleSdk/LuaVmExtended.h"
+#include <cstdio>
+#include <fstream>
+#include <list>
+
+std::string LuaStatsOutput::formatNumber(const char *format, double value)
+{
+    char buffer[64];
+    snprintf(buffer, sizeof(buffer), format, value);
+    return buffer;
+}
+
+void LuaStatsOutput::pushCounter(lua_State *luaVm, const char *name, double value)
+{
+    lua_pushnumber(luaVm, static_cast<lua_Number>(value));
+    lua_setfield(luaVm, -2, name);
+}
+
+bool LuaStatsOutput::writeFile(const std::string &path, const std::string &text)
+{
+    std::ofstream file(path, std::ios::trunc);
+    if (!file) {
+        return false;
+    }
+
+    file << text;
+    return static_cast<bool>(file);
+}
+
+int LuaStatsOutput::luaDumpFile(lua_State *luaVm,
+                                int index,
+                                const std::function<bool(const std::string &path)> &dump) const
+{
+    LuaVmExtended lua(luaVm);
+    std::string fileName;
+    try {
+        fileName = lua.parseArgument(index, LuaArgumentType::LuaTypeString).toString();
+    } catch (const LuaException &e) {
+        return pushError(luaVm, e.what());
+    }
+
+    if (fileName.empty() || fileName.find('/') != std::string::npos || fileName.find('\\') != std::string::npos
+        || fileName.find("..") != std::string::npos) {
+        return pushError(luaVm, "File name can't contain directories");
+    }
+    if (!dump(dumpDirectory + "/" + fileName)) {
+        return pushError(luaVm, "Unable to write " + fileName);
+    }
+
+    lua.pushArgument(LuaArgument(true));
+    return 1;
+}
+
+int LuaStatsOutput::pushError(lua_State *luaVm, const std::string &message)
+{
+    LuaVmExtended lua(luaVm);
+    std::list<LuaArgument> result{LuaArgument(false), LuaArgument(message)};
+    return lua.pushArguments(result.cbegin(), result.cend());
+}
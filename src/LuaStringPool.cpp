@@ -0,0 +1,74 @@
+#include "ModuleSdk/LuaStringPool.h"
+#include <cstring>
+
+bool LuaStringPool::KeyEqual::operator()(const Key &left, const Key &right) const
+{
+    return left.length == right.length
+        && (left.data == right.data || std::memcmp(left.data, right.data, left.length) == 0);
+}
+
+LuaArgument LuaStringPool::intern(const char *data, size_t length)
+{
+    if (length > maxLength) {
+        return LuaArgument(std::string(data, length));
+    }
+
+    size_t hash = LuaArgument::hashString(data, length);
+    auto found = strings.find(Key{data, length, hash});
+    if (found != strings.end()) {
+        return found->second.string;
+    }
+
+    if (strings.size() >= maxSize) {
+        return LuaArgument(std::string(data, length));
+    }
+
+    LUA_COUNTERS_ADD(allocations, 1);
+    LUA_COUNTERS_ADD(bytesCopied, length);
+    auto *shared = new LuaArgument::SharedString(std::string(data, length), hash);
+    LuaArgument result;
+    result.storage.pointer = shared;
+    result.index = LuaTypeIndex::String;
+
+    // Key points to the interned contents, which are kept alive by the entry
+    strings.emplace(Key{shared->value.data(), length, hash}, Entry{result, LUA_NOREF});
+    return result;
+}
+
+bool LuaStringPool::push(lua_State *target, const LuaArgument &argument)
+{
+    if (argument.index != LuaTypeIndex::String) {
+        return false;
+    }
+
+    auto *shared = reinterpret_cast<LuaArgument::SharedString *>(argument.storage.pointer);
+    auto found = strings.find(Key{shared->value.data(), shared->value.size(), shared->hash});
+    if (found == strings.end()) {
+        return false;
+    }
+
+    Entry &entry = found->second;
+    if (entry.reference != LUA_NOREF) {
+        lua_rawgeti(target, LUA_REGISTRYINDEX, entry.reference);
+        return true;
+    }
+
+    // The first push pins the lua string
+    if (!lua_checkstack(target, 2)) {
+        return false;
+    }
+    lua_pushlstring(target, shared->value.data(), shared->value.size());
+    lua_pushvalue(target, -1);
+    entry.reference = luaL_ref(target, LUA_REGISTRYINDEX);     // Pops the copy
+    return true;
+}
+
+void LuaStringPool::clear() noexcept
+{
+    for (auto &pair : strings) {
+        if (pair.second.reference != LUA_NOREF) {
+            luaL_unref(luaVm, LUA_REGISTRYINDEX, pair.second.reference);
+        }
+    }
+    strings.clear();
+}
@@ -0,0 +1,148 @@
+#include "ModuleSdk/LuaTableProxy.h"
+#include "ModuleSdk/LuaVmExtended.h"
+
+LuaTableProxy::LuaTableProxy(lua_State *luaVm, int index)
+    : luaVm(luaVm)
+{
+    if (!lua_istable(luaVm, index)) {
+        throw LuaUnexpectedType(
+            LuaArgumentType::LuaTypeTableMap,
+            static_cast<LuaArgumentType>(lua_type(luaVm, index))
+        );
+    }
+
+    lua_pushvalue(luaVm, index);
+    this->reference = luaL_ref(luaVm, LUA_REGISTRYINDEX);         // Pops the copy
+}
+
+LuaArgument LuaTableProxy::get(const LuaArgument &key) const
+{
+    this->pushField(key);
+
+    LuaArgument result;
+    try {
+        result = LuaVmExtended(luaVm).parseArgument(lua_gettop(luaVm));
+    } catch (...) {
+        lua_pop(luaVm, 2);
+        throw;
+    }
+
+    lua_pop(luaVm, 2);              // Table and value
+    return result;
+}
+
+LuaArgument LuaTableProxy::getByIndex(int index) const
+{
+    this->pushFieldByIndex(index);
+
+    LuaArgument result;
+    try {
+        result = LuaVmExtended(luaVm).parseArgument(lua_gettop(luaVm));
+    } catch (...) {
+        lua_pop(luaVm, 2);
+        throw;
+    }
+
+    lua_pop(luaVm, 2);              // Table and value
+    return result;
+}
+
+LuaTableProxy LuaTableProxy::getTable(const LuaArgument &key) const
+{
+    this->pushField(key);
+
+    try {
+        LuaTableProxy result(luaVm, -1);
+        lua_pop(luaVm, 2);
+        return result;
+    } catch (...) {
+        lua_pop(luaVm, 2);
+        throw;
+    }
+}
+
+LuaTableProxy LuaTableProxy::getTableByIndex(int index) const
+{
+    this->pushFieldByIndex(index);
+
+    try {
+        LuaTableProxy result(luaVm, -1);
+        lua_pop(luaVm, 2);
+        return result;
+    } catch (...) {
+        lua_pop(luaVm, 2);
+        throw;
+    }
+}
+
+LuaArgumentType LuaTableProxy::getType(const LuaArgument &key) const
+{
+    this->pushField(key);
+    auto type = static_cast<LuaArgumentType>(lua_type(luaVm, -1));
+    lua_pop(luaVm, 2);
+
+    return type;
+}
+
+size_t LuaTableProxy::size() const
+{
+    this->push();
+    size_t size = lua_objlen(luaVm, -1);
+    lua_pop(luaVm, 1);
+
+    return size;
+}
+
+LuaArgument LuaTableProxy::materialize() const
+{
+    this->push();
+
+    LuaArgument result;
+    try {
+        result = LuaVmExtended(luaVm).parseArgument(lua_gettop(luaVm));
+    } catch (...) {
+        lua_pop(luaVm, 1);
+        throw;
+    }
+
+    lua_pop(luaVm, 1);
+    return result;
+}
+
+void LuaTableProxy::push() const
+{
+    if (!this->isValid()) {
+        throw LuaOutOfRange("Table proxy has been released");
+    }
+
+    lua_rawgeti(luaVm, LUA_REGISTRYINDEX, this->reference);
+}
+
+void LuaTableProxy::release() noexcept
+{
+    if (!this->isValid()) {
+        return;
+    }
+
+    luaL_unref(luaVm, LUA_REGISTRYINDEX, this->reference);
+    this->reference = LUA_NOREF;
+}
+
+void LuaTableProxy::pushField(const LuaArgument &key) const
+{
+    this->push();
+    try {
+        LuaVmExtended(luaVm).pushArgument(key);
+    } catch (...) {
+        lua_pop(luaVm, 1);
+        throw;
+    }
+
+    lua_rawget(luaVm, -2);
+}
+
+void LuaTableProxy::pushFieldByIndex(int index) const
+{
+    this->push();
+    lua_rawgeti(luaVm, -1, index);
+}
@@ -0,0 +1,135 @@
+#include "ModuleSdk/LuaTaskPool.h"
+#include "ModuleSdk/LuaVmExtended.h"
+#include "lua/lauxlib.h"
+#include <algorithm>
+#include <exception>
+#include <iterator>
+
+LuaTaskPool::LuaTaskPool(unsigned int threads)
+    : threadsAmount(threads ? threads : std::max(1u, std::thread::hardware_concurrency()))
+{}
+
+void LuaTaskPool::submit(lua_State *luaVm, int callbackIndex, Job job)
+{
+    if (lua_type(luaVm, callbackIndex) != LUA_TFUNCTION) {
+        throw LuaBadType(lua_type(luaVm, callbackIndex));
+    }
+
+    auto epoch = epochs.find(luaVm);
+    if (epoch == epochs.end()) {
+        epoch = epochs.emplace(luaVm, nextEpoch++).first;
+    }
+
+    if (workers.empty()) {
+        this->start();
+    }
+
+    lua_pushvalue(luaVm, callbackIndex);
+    int callback = luaL_ref(luaVm, LUA_REGISTRYINDEX);         // Pops the copy
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        tasks.push_back(Task{std::move(job), luaVm, callback, epoch->second});
+    }
+    pending++;
+    condition.notify_one();
+}
+
+size_t LuaTaskPool::pulse()
+{
+    size_t called = 0;
+    completions.drain(
+        [this, &called](Completion &completion)
+        {
+            pending--;
+
+            auto epoch = epochs.find(completion.luaVm);
+            if (epoch == epochs.end() || epoch->second != completion.epoch) {
+                return;                             // Resource has been stopped
+            }
+
+            std::vector<LuaArgument> arguments;
+            arguments.reserve(completion.results.size() + 1);
+            arguments.emplace_back(completion.success);
+            if (completion.success) {
+                std::move(completion.results.begin(), completion.results.end(), std::back_inserter(arguments));
+            } else {
+                arguments.emplace_back(std::move(completion.error));
+            }
+
+            try {
+                LuaVmExtended(completion.luaVm).callReference(completion.callback, arguments);
+            } catch (const LuaException &e) {
+                if (errorHandler) {
+                    errorHandler(completion.luaVm, e.what());
+                }
+            }
+            luaL_unref(completion.luaVm, LUA_REGISTRYINDEX, completion.callback);
+            called++;
+        }
+    );
+    return called;
+}
+
+void LuaTaskPool::resourceStopped(lua_State *luaVm)
+{
+    // Stale epoch drops callbacks, the VM is closed with its registry references
+    epochs.erase(luaVm);
+}
+
+LuaTaskPool::~LuaTaskPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        tasks.clear();
+    }
+    condition.notify_all();
+
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+}
+
+void LuaTaskPool::work()
+{
+    while (true) {
+        Task task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            condition.wait(
+                lock,
+                [this]()
+                {
+                    return stopping || !tasks.empty();
+                }
+            );
+            if (stopping) {
+                return;
+            }
+
+            task = std::move(tasks.front());
+            tasks.pop_front();
+        }
+
+        Completion completion{task.luaVm, task.callback, task.epoch, true, {}, {}};
+        try {
+            completion.results = task.job();
+        } catch (const std::exception &e) {
+            completion.success = false;
+            completion.error = e.what();
+        } catch (...) {
+            completion.success = false;
+            completion.error = "Unknown error";
+        }
+        completions.push(std::move(completion));
+    }
+}
+
+void LuaTaskPool::start()
+{
+    workers.reserve(threadsAmount);
+    for (unsigned int i = 0; i < threadsAmount; i++) {
+        workers.emplace_back(&LuaTaskPool::work, this);
+    }
+}
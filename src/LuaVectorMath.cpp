@@ -0,0 +1,646 @@
+#include "ModuleSdk/LuaVectorMath.h"
+#include "ModuleSdk/LuaParallel.h"
+#include "ModuleSdk/LuaVmExtended.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <list>
+#include <numeric>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define VECTOR_MATH_X86
+#define VECTOR_MATH_TARGET_SSE __attribute__((target("sse2")))
+#define VECTOR_MATH_TARGET_AVX __attribute__((target("avx")))
+#include <immintrin.h>
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#define VECTOR_MATH_X86
+#define VECTOR_MATH_TARGET_SSE
+#define VECTOR_MATH_TARGET_AVX
+#include <immintrin.h>
+#include <intrin.h>
+#endif
+
+namespace
+{
+
+/// Backend kernels
+struct Kernels
+{
+    void (*distances)(const float *points, size_t count, const float *origin, float *result, bool squared);
+    void (*pairDistances)(const float *left, const float *right, size_t count, float *result);
+    size_t (*withinRadius)(const float *points, size_t count, const float *origin, float radiusSquared, int32_t *result);
+    size_t (*insideBox)(const float *points, size_t count, const float *min, const float *max, int32_t *result);
+};
+
+// Scalar kernels (also process SIMD tails, offset is the first point index)
+
+void scalarDistances(const float *points, size_t count, const float *origin, float *result, bool squared)
+{
+    for (size_t i = 0; i < count; i++) {
+        float dx = points[3 * i] - origin[0];
+        float dy = points[3 * i + 1] - origin[1];
+        float dz = points[3 * i + 2] - origin[2];
+        float distance = dx * dx + dy * dy + dz * dz;
+        result[i] = squared ? distance : std::sqrt(distance);
+    }
+}
+
+void scalarPairDistances(const float *left, const float *right, size_t count, float *result)
+{
+    for (size_t i = 0; i < count; i++) {
+        float dx = left[3 * i] - right[3 * i];
+        float dy = left[3 * i + 1] - right[3 * i + 1];
+        float dz = left[3 * i + 2] - right[3 * i + 2];
+        result[i] = std::sqrt(dx * dx + dy * dy + dz * dz);
+    }
+}
+
+size_t scalarWithinRadius(
+    const float *points, size_t count, const float *origin, float radiusSquared, int32_t *result, size_t offset = 0
+)
+{
+    size_t found = 0;
+    for (size_t i = 0; i < count; i++) {
+        float dx = points[3 * i] - origin[0];
+        float dy = points[3 * i + 1] - origin[1];
+        float dz = points[3 * i + 2] - origin[2];
+        if (dx * dx + dy * dy + dz * dz <= radiusSquared) {
+            result[found++] = static_cast<int32_t>(offset + i + 1);
+        }
+    }
+    return found;
+}
+
+size_t scalarInsideBox(
+    const float *points, size_t count, const float *min, const float *max, int32_t *result, size_t offset = 0
+)
+{
+    size_t found = 0;
+    for (size_t i = 0; i < count; i++) {
+        const float *point = points + 3 * i;
+        if (
+            point[0] >= min[0] && point[0] <= max[0]
+                && point[1] >= min[1] && point[1] <= max[1]
+                && point[2] >= min[2] && point[2] <= max[2]
+        ) {
+            result[found++] = static_cast<int32_t>(offset + i + 1);
+        }
+    }
+    return found;
+}
+
+const Kernels SCALAR_KERNELS = {
+    scalarDistances,
+    scalarPairDistances,
+    [](const float *points, size_t count, const float *origin, float radiusSquared, int32_t *result) -> size_t
+    {
+        return scalarWithinRadius(points, count, origin, radiusSquared, result);
+    },
+    [](const float *points, size_t count, const float *min, const float *max, int32_t *result) -> size_t
+    {
+        return scalarInsideBox(points, count, min, max, result);
+    },
+};
+
+/**
+ * @brief Append indices of set mask bits
+ */
+inline size_t appendMask(int mask, int width, size_t first, int32_t *result)
+{
+    size_t found = 0;
+    for (int bit = 0; bit < width; bit++) {
+        if (mask & (1 << bit)) {
+            result[found++] = static_cast<int32_t>(first + bit + 1);
+        }
+    }
+    return found;
+}
+
+#ifdef VECTOR_MATH_X86
+
+// SSE kernels
+
+/**
+ * @brief Load 4 packed points as x, y and z vectors
+ */
+VECTOR_MATH_TARGET_SSE inline void loadPoints4(const float *points, __m128 &x, __m128 &y, __m128 &z)
+{
+    __m128 m0 = _mm_loadu_ps(points);               // x0 y0 z0 x1
+    __m128 m1 = _mm_loadu_ps(points + 4);           // y1 z1 x2 y2
+    __m128 m2 = _mm_loadu_ps(points + 8);           // z2 x3 y3 z3
+
+    __m128 xy = _mm_shuffle_ps(m1, m2, _MM_SHUFFLE(2, 1, 3, 2));        // x2 y2 x3 y3
+    __m128 yz = _mm_shuffle_ps(m0, m1, _MM_SHUFFLE(1, 0, 2, 1));        // y0 z0 y1 z1
+    x = _mm_shuffle_ps(m0, xy, _MM_SHUFFLE(2, 0, 3, 0));
+    y = _mm_shuffle_ps(yz, xy, _MM_SHUFFLE(3, 1, 2, 0));
+    z = _mm_shuffle_ps(yz, m2, _MM_SHUFFLE(3, 0, 3, 1));
+}
+
+/**
+ * @brief Squared distances from 4 packed points to origin
+ */
+VECTOR_MATH_TARGET_SSE inline __m128 distanceSquared4(const float *points, __m128 ox, __m128 oy, __m128 oz)
+{
+    __m128 x, y, z;
+    loadPoints4(points, x, y, z);
+    x = _mm_sub_ps(x, ox);
+    y = _mm_sub_ps(y, oy);
+    z = _mm_sub_ps(z, oz);
+    return _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z));
+}
+
+VECTOR_MATH_TARGET_SSE void sseDistances(const float *points, size_t count, const float *origin, float *result, bool squared)
+{
+    __m128 ox = _mm_set1_ps(origin[0]);
+    __m128 oy = _mm_set1_ps(origin[1]);
+    __m128 oz = _mm_set1_ps(origin[2]);
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 distance = distanceSquared4(points + 3 * i, ox, oy, oz);
+        _mm_storeu_ps(result + i, squared ? distance : _mm_sqrt_ps(distance));
+    }
+    scalarDistances(points + 3 * i, count - i, origin, result + i, squared);
+}
+
+VECTOR_MATH_TARGET_SSE void ssePairDistances(const float *left, const float *right, size_t count, float *result)
+{
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 lx, ly, lz, rx, ry, rz;
+        loadPoints4(left + 3 * i, lx, ly, lz);
+        loadPoints4(right + 3 * i, rx, ry, rz);
+        __m128 dx = _mm_sub_ps(lx, rx);
+        __m128 dy = _mm_sub_ps(ly, ry);
+        __m128 dz = _mm_sub_ps(lz, rz);
+        __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+        _mm_storeu_ps(result + i, _mm_sqrt_ps(distance));
+    }
+    scalarPairDistances(left + 3 * i, right + 3 * i, count - i, result + i);
+}
+
+VECTOR_MATH_TARGET_SSE size_t sseWithinRadius(
+    const float *points, size_t count, const float *origin, float radiusSquared, int32_t *result
+)
+{
+    __m128 ox = _mm_set1_ps(origin[0]);
+    __m128 oy = _mm_set1_ps(origin[1]);
+    __m128 oz = _mm_set1_ps(origin[2]);
+    __m128 radius = _mm_set1_ps(radiusSquared);
+
+    size_t found = 0;
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        int mask = _mm_movemask_ps(_mm_cmple_ps(distanceSquared4(points + 3 * i, ox, oy, oz), radius));
+        if (mask) {
+            found += appendMask(mask, 4, i, result + found);
+        }
+    }
+    return found + scalarWithinRadius(points + 3 * i, count - i, origin, radiusSquared, result + found, i);
+}
+
+VECTOR_MATH_TARGET_SSE size_t sseInsideBox(
+    const float *points, size_t count, const float *min, const float *max, int32_t *result
+)
+{
+    __m128 minX = _mm_set1_ps(min[0]), minY = _mm_set1_ps(min[1]), minZ = _mm_set1_ps(min[2]);
+    __m128 maxX = _mm_set1_ps(max[0]), maxY = _mm_set1_ps(max[1]), maxZ = _mm_set1_ps(max[2]);
+
+    size_t found = 0;
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 x, y, z;
+        loadPoints4(points + 3 * i, x, y, z);
+        __m128 inside = _mm_and_ps(_mm_cmpge_ps(x, minX), _mm_cmple_ps(x, maxX));
+        inside = _mm_and_ps(inside, _mm_and_ps(_mm_cmpge_ps(y, minY), _mm_cmple_ps(y, maxY)));
+        inside = _mm_and_ps(inside, _mm_and_ps(_mm_cmpge_ps(z, minZ), _mm_cmple_ps(z, maxZ)));
+
+        int mask = _mm_movemask_ps(inside);
+        if (mask) {
+            found += appendMask(mask, 4, i, result + found);
+        }
+    }
+    return found + scalarInsideBox(points + 3 * i, count - i, min, max, result + found, i);
+}
+
+const Kernels SSE_KERNELS = {sseDistances, ssePairDistances, sseWithinRadius, sseInsideBox};
+
+// AVX kernels
+
+/**
+ * @brief Load 8 packed points as x, y and z vectors (4 points per 128-bit lane)
+ */
+VECTOR_MATH_TARGET_AVX inline void loadPoints8(const float *points, __m256 &x, __m256 &y, __m256 &z)
+{
+    __m256 m03 = _mm256_castps128_ps256(_mm_loadu_ps(points));
+    __m256 m14 = _mm256_castps128_ps256(_mm_loadu_ps(points + 4));
+    __m256 m25 = _mm256_castps128_ps256(_mm_loadu_ps(points + 8));
+    m03 = _mm256_insertf128_ps(m03, _mm_loadu_ps(points + 12), 1);
+    m14 = _mm256_insertf128_ps(m14, _mm_loadu_ps(points + 16), 1);
+    m25 = _mm256_insertf128_ps(m25, _mm_loadu_ps(points + 20), 1);
+
+    // Same shuffles as loadPoints4 in every lane
+    __m256 xy = _mm256_shuffle_ps(m14, m25, _MM_SHUFFLE(2, 1, 3, 2));
+    __m256 yz = _mm256_shuffle_ps(m03, m14, _MM_SHUFFLE(1, 0, 2, 1));
+    x = _mm256_shuffle_ps(m03, xy, _MM_SHUFFLE(2, 0, 3, 0));
+    y = _mm256_shuffle_ps(yz, xy, _MM_SHUFFLE(3, 1, 2, 0));
+    z = _mm256_shuffle_ps(yz, m25, _MM_SHUFFLE(3, 0, 3, 1));
+}
+
+/**
+ * @brief Squared distances from 8 packed points to origin
+ */
+VECTOR_MATH_TARGET_AVX inline __m256 distanceSquared8(const float *points, __m256 ox, __m256 oy, __m256 oz)
+{
+    __m256 x, y, z;
+    loadPoints8(points, x, y, z);
+    x = _mm256_sub_ps(x, ox);
+    y = _mm256_sub_ps(y, oy);
+    z = _mm256_sub_ps(z, oz);
+    return _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, x), _mm256_mul_ps(y, y)), _mm256_mul_ps(z, z));
+}
+
+VECTOR_MATH_TARGET_AVX void avxDistances(const float *points, size_t count, const float *origin, float *result, bool squared)
+{
+    __m256 ox = _mm256_set1_ps(origin[0]);
+    __m256 oy = _mm256_set1_ps(origin[1]);
+    __m256 oz = _mm256_set1_ps(origin[2]);
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 distance = distanceSquared8(points + 3 * i, ox, oy, oz);
+        _mm256_storeu_ps(result + i, squared ? distance : _mm256_sqrt_ps(distance));
+    }
+    scalarDistances(points + 3 * i, count - i, origin, result + i, squared);
+}
+
+VECTOR_MATH_TARGET_AVX void avxPairDistances(const float *left, const float *right, size_t count, float *result)
+{
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 lx, ly, lz, rx, ry, rz;
+        loadPoints8(left + 3 * i, lx, ly, lz);
+        loadPoints8(right + 3 * i, rx, ry, rz);
+        __m256 dx = _mm256_sub_ps(lx, rx);
+        __m256 dy = _mm256_sub_ps(ly, ry);
+        __m256 dz = _mm256_sub_ps(lz, rz);
+        __m256 distance = _mm256_add_ps(
+            _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)),
+            _mm256_mul_ps(dz, dz)
+        );
+        _mm256_storeu_ps(result + i, _mm256_sqrt_ps(distance));
+    }
+    scalarPairDistances(left + 3 * i, right + 3 * i, count - i, result + i);
+}
+
+VECTOR_MATH_TARGET_AVX size_t avxWithinRadius(
+    const float *points, size_t count, const float *origin, float radiusSquared, int32_t *result
+)
+{
+    __m256 ox = _mm256_set1_ps(origin[0]);
+    __m256 oy = _mm256_set1_ps(origin[1]);
+    __m256 oz = _mm256_set1_ps(origin[2]);
+    __m256 radius = _mm256_set1_ps(radiusSquared);
+
+    size_t found = 0;
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 distance = distanceSquared8(points + 3 * i, ox, oy, oz);
+        int mask = _mm256_movemask_ps(_mm256_cmp_ps(distance, radius, _CMP_LE_OQ));
+        if (mask) {
+            found += appendMask(mask, 8, i, result + found);
+        }
+    }
+    return found + scalarWithinRadius(points + 3 * i, count - i, origin, radiusSquared, result + found, i);
+}
+
+VECTOR_MATH_TARGET_AVX size_t avxInsideBox(
+    const float *points, size_t count, const float *min, const float *max, int32_t *result
+)
+{
+    __m256 minX = _mm256_set1_ps(min[0]), minY = _mm256_set1_ps(min[1]), minZ = _mm256_set1_ps(min[2]);
+    __m256 maxX = _mm256_set1_ps(max[0]), maxY = _mm256_set1_ps(max[1]), maxZ = _mm256_set1_ps(max[2]);
+
+    size_t found = 0;
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 x, y, z;
+        loadPoints8(points + 3 * i, x, y, z);
+        __m256 inside = _mm256_and_ps(_mm256_cmp_ps(x, minX, _CMP_GE_OQ), _mm256_cmp_ps(x, maxX, _CMP_LE_OQ));
+        inside = _mm256_and_ps(
+            inside,
+            _mm256_and_ps(_mm256_cmp_ps(y, minY, _CMP_GE_OQ), _mm256_cmp_ps(y, maxY, _CMP_LE_OQ))
+        );
+        inside = _mm256_and_ps(
+            inside,
+            _mm256_and_ps(_mm256_cmp_ps(z, minZ, _CMP_GE_OQ), _mm256_cmp_ps(z, maxZ, _CMP_LE_OQ))
+        );
+
+        int mask = _mm256_movemask_ps(inside);
+        if (mask) {
+            found += appendMask(mask, 8, i, result + found);
+        }
+    }
+    return found + scalarInsideBox(points + 3 * i, count - i, min, max, result + found, i);
+}
+
+const Kernels AVX_KERNELS = {avxDistances, avxPairDistances, avxWithinRadius, avxInsideBox};
+
+#endif
+
+/**
+ * @brief Check CPU features
+ */
+bool cpuSupports(LuaVectorMathBackend backend)
+{
+    if (backend == LuaVectorMathBackend::Scalar) {
+        return true;
+    }
+
+#if defined(VECTOR_MATH_X86) && defined(__GNUC__)
+    __builtin_cpu_init();
+    if (backend == LuaVectorMathBackend::Sse) {
+        return __builtin_cpu_supports("sse2");
+    }
+    return __builtin_cpu_supports("avx");
+#elif defined(VECTOR_MATH_X86)
+    int info[4];
+    __cpuid(info, 1);
+    if (backend == LuaVectorMathBackend::Sse) {
+        return (info[3] & (1 << 26)) != 0;
+    }
+    // AVX and OS support of YMM registers
+    bool avx = (info[2] & (1 << 28)) != 0 && (info[2] & (1 << 27)) != 0;
+    return avx && (_xgetbv(0) & 6) == 6;
+#else
+    return false;
+#endif
+}
+
+const Kernels &getKernels(LuaVectorMathBackend backend)
+{
+    switch (backend) {
+#ifdef VECTOR_MATH_X86
+        case LuaVectorMathBackend::Avx:
+            return AVX_KERNELS;
+        case LuaVectorMathBackend::Sse:
+            return SSE_KERNELS;
+#endif
+        default:
+            return SCALAR_KERNELS;
+    }
+}
+
+/**
+ * @brief Best supported backend
+ */
+LuaVectorMathBackend detectBackend()
+{
+    if (cpuSupports(LuaVectorMathBackend::Avx)) {
+        return LuaVectorMathBackend::Avx;
+    }
+    if (cpuSupports(LuaVectorMathBackend::Sse)) {
+        return LuaVectorMathBackend::Sse;
+    }
+    return LuaVectorMathBackend::Scalar;
+}
+
+std::atomic<LuaVectorMathBackend> &activeBackend()
+{
+    static std::atomic<LuaVectorMathBackend> backend(detectBackend());
+    return backend;
+}
+
+const Kernels &activeKernels()
+{
+    return getKernels(activeBackend().load(std::memory_order_relaxed));
+}
+
+/**
+ * @brief Push false and error message
+ */
+int pushError(lua_State *luaVm, const LuaException &exception)
+{
+    LuaVmExtended lua(luaVm);
+    std::list<LuaArgument> result{LuaArgument(false), LuaArgument(exception.what())};
+    return lua.pushArguments(result.cbegin(), result.cend());
+}
+
+/**
+ * @brief Parse 3 numbers starting from index
+ */
+void parseVector(lua_State *luaVm, int index, float *result)
+{
+    LuaVmExtended lua(luaVm);
+    for (int i = 0; i < 3; i++) {
+        result[i] = static_cast<float>(lua.parseArgument(index + i, LuaArgumentType::LuaTypeNumber).toNumber());
+    }
+}
+
+}
+
+LuaVectorMathBackend LuaVectorMath::getBackend()
+{
+    return activeBackend().load(std::memory_order_relaxed);
+}
+
+bool LuaVectorMath::setBackend(LuaVectorMathBackend backend)
+{
+    if (!isSupported(backend)) {
+        return false;
+    }
+    activeBackend().store(backend, std::memory_order_relaxed);
+    return true;
+}
+
+bool LuaVectorMath::isSupported(LuaVectorMathBackend backend)
+{
+    return cpuSupports(backend);
+}
+
+void LuaVectorMath::distances(const float *points, size_t count, const float *origin, float *result)
+{
+    activeKernels().distances(points, count, origin, result, false);
+}
+
+void LuaVectorMath::pairDistances(const float *left, const float *right, size_t count, float *result)
+{
+    activeKernels().pairDistances(left, right, count, result);
+}
+
+size_t LuaVectorMath::withinRadius(
+    const float *points, size_t count, const float *origin, float radius, int32_t *result
+)
+{
+    if (radius < 0) {
+        return 0;
+    }
+    return activeKernels().withinRadius(points, count, origin, radius * radius, result);
+}
+
+size_t LuaVectorMath::insideBox(const float *points, size_t count, const float *min, const float *max, int32_t *result)
+{
+    return activeKernels().insideBox(points, count, min, max, result);
+}
+
+size_t LuaVectorMath::nearest(const float *points, size_t count, const float *origin, size_t k, int32_t *result)
+{
+    k = std::min(k, count);
+    if (k == 0) {
+        return 0;
+    }
+
+    std::vector<float> distances(count);
+    activeKernels().distances(points, count, origin, distances.data(), true);
+
+    std::vector<int32_t> order(count);
+    std::iota(order.begin(), order.end(), 0);
+    std::partial_sort(
+        order.begin(), order.begin() + k, order.end(),
+        [&distances](int32_t left, int32_t right)
+        {
+            return distances[left] < distances[right] || (distances[left] == distances[right] && left < right);
+        }
+    );
+
+    for (size_t i = 0; i < k; i++) {
+        result[i] = order[i] + 1;
+    }
+    return k;
+}
+
+LuaArgument LuaVectorMath::parsePoints(lua_State *luaVm, int index)
+{
+    LuaArgument points = LuaVmExtended(luaVm).parseArgument(index, LuaArgumentType::LuaTypeFloatArray);
+    if (points.toFloatArray().size() % 3 != 0) {
+        throw LuaOutOfRange("Points array size must be a multiple of 3");
+    }
+    return points;
+}
+
+int LuaVectorMath::luaDistances(lua_State *luaVm)
+{
+    LuaArgument::FloatArrayType result;
+    try {
+        LuaArgument points = parsePoints(luaVm, 1);
+        float origin[3];
+        parseVector(luaVm, 2, origin);
+
+        const auto &array = points.toFloatArray();
+        result.resize(array.size() / 3);
+        LuaParallel::getDefault().parallelFor(
+            result.size(),
+            [&array, &origin, &result](size_t begin, size_t end)
+            {
+                distances(array.data() + begin * 3, end - begin, origin, result.data() + begin);
+            }
+        );
+    } catch (const LuaException &e) {
+        return pushError(luaVm, e);
+    }
+
+    LuaVmExtended(luaVm).pushArgument(LuaArgument(std::move(result)));
+    return 1;
+}
+
+int LuaVectorMath::luaPairDistances(lua_State *luaVm)
+{
+    LuaArgument::FloatArrayType result;
+    try {
+        LuaArgument left = parsePoints(luaVm, 1);
+        LuaArgument right = parsePoints(luaVm, 2);
+        if (left.toFloatArray().size() != right.toFloatArray().size()) {
+            throw LuaOutOfRange("Points arrays sizes must be equal");
+        }
+
+        result.resize(left.toFloatArray().size() / 3);
+        const float *leftData = left.toFloatArray().data();
+        const float *rightData = right.toFloatArray().data();
+        LuaParallel::getDefault().parallelFor(
+            result.size(),
+            [leftData, rightData, &result](size_t begin, size_t end)
+            {
+                pairDistances(leftData + begin * 3, rightData + begin * 3, end - begin, result.data() + begin);
+            }
+        );
+    } catch (const LuaException &e) {
+        return pushError(luaVm, e);
+    }
+
+    LuaVmExtended(luaVm).pushArgument(LuaArgument(std::move(result)));
+    return 1;
+}
+
+int LuaVectorMath::luaWithinRadius(lua_State *luaVm)
+{
+    LuaArgument::Int32ArrayType result;
+    try {
+        LuaArgument points = parsePoints(luaVm, 1);
+        float origin[3];
+        parseVector(luaVm, 2, origin);
+        auto radius = static_cast<float>(
+            LuaVmExtended(luaVm).parseArgument(5, LuaArgumentType::LuaTypeNumber).toNumber()
+        );
+
+        const auto &array = points.toFloatArray();
+        result.resize(array.size() / 3);
+        result.resize(withinRadius(array.data(), result.size(), origin, radius, result.data()));
+    } catch (const LuaException &e) {
+        return pushError(luaVm, e);
+    }
+
+    LuaVmExtended(luaVm).pushArgument(LuaArgument(std::move(result)));
+    return 1;
+}
+
+int LuaVectorMath::luaInsideBox(lua_State *luaVm)
+{
+    LuaArgument::Int32ArrayType result;
+    try {
+        LuaArgument points = parsePoints(luaVm, 1);
+        float min[3], max[3];
+        parseVector(luaVm, 2, min);
+        parseVector(luaVm, 5, max);
+
+        const auto &array = points.toFloatArray();
+        result.resize(array.size() / 3);
+        result.resize(insideBox(array.data(), result.size(), min, max, result.data()));
+    } catch (const LuaException &e) {
+        return pushError(luaVm, e);
+    }
+
+    LuaVmExtended(luaVm).pushArgument(LuaArgument(std::move(result)));
+    return 1;
+}
+
+int LuaVectorMath::luaNearest(lua_State *luaVm)
+{
+    LuaArgument::Int32ArrayType result;
+    try {
+        LuaArgument points = parsePoints(luaVm, 1);
+        float origin[3];
+        parseVector(luaVm, 2, origin);
+        int k = LuaVmExtended(luaVm).parseArgument(5, LuaArgumentType::LuaTypeInteger).toInteger();
+
+        const auto &array = points.toFloatArray();
+        result.resize(std::min(static_cast<size_t>(std::max(k, 0)), array.size() / 3));
+        nearest(array.data(), array.size() / 3, origin, result.size(), result.data());
+    } catch (const LuaException &e) {
+        return pushError(luaVm, e);
+    }
+
+    LuaVmExtended(luaVm).pushArgument(LuaArgument(std::move(result)));
+    return 1;
+}
+
+const std::vector<std::pair<std::string, lua_CFunction>> &LuaVectorMath::getLuaFunctions()
+{
+    static const std::vector<std::pair<std::string, lua_CFunction>> functions = {
+        {"vectorDistances", luaDistances},
+        {"vectorPairDistances", luaPairDistances},
+        {"vectorWithinRadius", luaWithinRadius},
+        {"vectorInsideBox", luaInsideBox},
+        {"vectorNearest", luaNearest},
+    };
+    return functions;
+}
@@ -1,11 +1,142 @@
 #include "ModuleSdk/LuaVmExtended.h"
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+
+namespace
+{
+
+/**
+ * @brief Convert stack number into typed array element
+ */
+template<typename T>
+T toElement(lua_State *luaVm, int index)
+{
+    return static_cast<T>(lua_tonumber(luaVm, index));
+}
+
+/**
+ * @brief Fractions are truncated toward zero
+ * @throws LuaOutOfRange Number is outside of int32_t range
+ */
+template<>
+int32_t toElement<int32_t>(lua_State *luaVm, int index)
+{
+    const lua_Number value = lua_tonumber(luaVm, index);
+    if (!(value > static_cast<lua_Number>(INT32_MIN) - 1 && value < static_cast<lua_Number>(INT32_MAX) + 1)) {
+        throw LuaOutOfRange("Number is out of int32 range");
+    }
+    return static_cast<int32_t>(value);
+}
+
+/**
+ * @brief Read table into typed array, if it has only keys 1..n and number values
+ * @details Pairs are read with one lua_next pass. Elements are appended while keys come in order
+ * (array part), so nothing is allocated for the border of a sparse table.
+ * Tables with hash part keys out of order are placed after the pass
+ * @param index Absolute table stack index
+ * @param maxLength Longer tables are rejected before reading
+ * @return false, if table is not a non-empty sequence of numbers (stack is unchanged)
+ */
+template<typename T>
+bool readNumberArray(lua_State *luaVm, int index, size_t maxLength, std::vector<T> &result)
+{
+    const size_t length = lua_objlen(luaVm, index);
+    if (length == 0 || length > maxLength) {
+        return false;
+    }
+
+    result.clear();
+    bool ordered = true;
+    size_t count = 0;
+    lua_pushnil(luaVm);
+    while (lua_next(luaVm, index) != 0) {
+        if (lua_type(luaVm, -2) != LUA_TNUMBER || lua_type(luaVm, -1) != LUA_TNUMBER) {
+            lua_pop(luaVm, 2);
+            return false;
+        }
+
+        lua_Number key = lua_tonumber(luaVm, -2);
+        if (key < 1 || key > static_cast<lua_Number>(length) || static_cast<lua_Number>(static_cast<size_t>(key)) != key) {
+            lua_pop(luaVm, 2);
+            return false;
+        }
+
+        ordered = ordered && static_cast<size_t>(key) == result.size() + 1;
+        if (ordered) {
+            result.push_back(toElement<T>(luaVm, -1));
+        }
+        count++;
+        lua_pop(luaVm, 1);                          // Value
+    }
+
+    // Keys are unique and inside 1..n, so n keys are exactly 1..n
+    if (count != length) {
+        return false;
+    }
+    if (!ordered) {
+        result.resize(length);
+        for (size_t i = 0; i < length; i++) {
+            lua_rawgeti(luaVm, index, static_cast<int>(i + 1));
+            result[i] = toElement<T>(luaVm, -1);
+            lua_pop(luaVm, 1);
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Read elements 1..lua_objlen into typed array
+ * @details Elements are appended one by one, the border of a sparse table is not preallocated
+ * @throws LuaUnexpectedType Element is not a number
+ * @throws LuaOutOfRange Element does not fit int32_t (Int32Array)
+ */
+template<typename T>
+std::vector<T> readSequence(lua_State *luaVm, int index)
+{
+    size_t length = lua_objlen(luaVm, index);
+    std::vector<T> result;
+    for (size_t i = 0; i < length; i++) {
+        lua_rawgeti(luaVm, index, static_cast<int>(i + 1));
+        int type = lua_type(luaVm, -1);
+        if (type != LUA_TNUMBER) {
+            lua_pop(luaVm, 1);
+            throw LuaUnexpectedType(LuaArgumentType::LuaTypeNumber, static_cast<LuaArgumentType>(type));
+        }
+        try {
+            result.push_back(toElement<T>(luaVm, -1));
+        } catch (...) {
+            lua_pop(luaVm, 1);
+            throw;
+        }
+        lua_pop(luaVm, 1);
+    }
+    return result;
+}
+
+/**
+ * @brief Push typed array as a sequence
+ */
+template<typename T>
+void pushNumberArray(lua_State *luaVm, const std::vector<T> &array)
+{
+    lua_createtable(luaVm, static_cast<int>(array.size()), 0);
+    for (size_t i = 0; i < array.size(); i++) {
+        lua_pushnumber(luaVm, static_cast<lua_Number>(array[i]));
+        lua_rawseti(luaVm, -2, static_cast<int>(i + 1));
+    }
+}
+
+}
 
 std::vector<LuaArgument> LuaVmExtended::getArguments()
 {
-    std::vector<LuaArgument> result;
+    LuaStackView view = getArgumentsView();
 
-    for (int index = 1; lua_type(luaVm, index) != LUA_TNONE; index++) {
-        result.push_back(parseArgument(index));
+    std::vector<LuaArgument> result;
+    result.reserve(view.size());
+    for (const LuaStackValue &value : view) {
+        result.push_back(parseArgument(value.getIndex()));
     }
 
     return result;
@@ -40,28 +171,68 @@ std::vector<LuaArgument> LuaVmExtended::getArguments(const std::list<LuaArgument
 
 void LuaVmExtended::pushArgument(const LuaArgument &argument) const
 {
-    if (argument.getType() == LuaArgumentType::LuaTypeNil) {
-        lua_pushnil(luaVm);
-    } else if (argument.getType() == LuaArgumentType::LuaTypeNumber) {
-        lua_pushnumber(luaVm, argument.toNumber());
-    } else if (argument.getType() == LuaArgumentType::LuaTypeInteger) {
-        lua_pushinteger(luaVm, argument.toInteger());
-    } else if (argument.getType() == LuaArgumentType::LuaTypeString) {
-        lua_pushstring(luaVm, argument.toString().c_str());
-    } else if (argument.getType() == LuaArgumentType::LuaTypeBoolean) {
-        lua_pushboolean(luaVm, argument.toBool());
-    } else if (argument.getType() == LuaArgumentType::LuaTypeLightUserdata) {
-        lua_pushlightuserdata(luaVm, argument.toPointer());
-    } else if (argument.getType() == LuaArgumentType::LuaTypeUserdata) {
-        lua_pushlightuserdata(luaVm, argument.toPointer());
-    } else if (argument.getType() == LuaArgumentType::LuaTypeObject) {
-        this->pushObject(argument.toObject());
-    } else if (argument.getType() == LuaArgumentType::LuaTypeTableList) {
-        this->pushTableList(argument);
-    } else if (argument.getType() == LuaArgumentType::LuaTypeTableMap) {
-        this->pushTableMap(argument);
-    } else {
-        throw LuaUnexpectedPushType(argument.getType());
+    LuaMemoryTelemetry::Attribution attribution;
+    LuaPushPlan plan;
+    plan.add(argument);
+    reserveStack(plan);
+
+    pushArgument(argument, plan);
+}
+
+void LuaVmExtended::reserveStack(const LuaPushPlan &plan) const
+{
+    if (!lua_checkstack(luaVm, plan.getStackSize())) {
+        throw LuaOutOfRange("Lua stack limit exceeded");
+    }
+}
+
+void LuaVmExtended::pushArgument(const LuaArgument &argument, LuaPushPlan &plan) const
+{
+    switch (argument.getTypeIndex()) {
+        case LuaTypeIndex::Nil:
+            lua_pushnil(luaVm);
+            break;
+        case LuaTypeIndex::Number:
+            lua_pushnumber(luaVm, argument.toNumber());
+            break;
+        case LuaTypeIndex::Integer:
+            lua_pushinteger(luaVm, argument.toInteger());
+            break;
+        case LuaTypeIndex::String: {
+            if (stringPool && stringPool->push(luaVm, argument)) {
+                break;
+            }
+            const std::string &string = argument.toString();
+            lua_pushlstring(luaVm, string.data(), string.size());
+            break;
+        }
+        case LuaTypeIndex::Boolean:
+            lua_pushboolean(luaVm, argument.toBool());
+            break;
+        case LuaTypeIndex::LightUserdata:
+        case LuaTypeIndex::Userdata:
+            lua_pushlightuserdata(luaVm, argument.toPointer());
+            break;
+        case LuaTypeIndex::Object:
+            this->pushObject(argument.toObject());
+            break;
+        case LuaTypeIndex::TableList:
+            this->pushTableList(argument, plan);
+            break;
+        case LuaTypeIndex::TableMap:
+            this->pushTableMap(argument, plan);
+            break;
+        case LuaTypeIndex::DoubleArray:
+            pushNumberArray(luaVm, argument.toDoubleArray());
+            break;
+        case LuaTypeIndex::FloatArray:
+            pushNumberArray(luaVm, argument.toFloatArray());
+            break;
+        case LuaTypeIndex::Int32Array:
+            pushNumberArray(luaVm, argument.toInt32Array());
+            break;
+        default:
+            throw LuaUnexpectedPushType(argument.getType());
     }
 }
 
@@ -87,6 +258,10 @@ LuaArgument LuaVmExtended::parseArgument(int index) const
 
 LuaArgument LuaVmExtended::parseArgument(int index, LuaArgumentType type, bool force) const
 {
+    static int (*const isTable)(lua_State *, int) = [](lua_State *vm, int index) -> int
+    {
+        return lua_istable(vm, index);
+    };
     static const std::unordered_map<LuaArgumentType, int (*)(lua_State *, int)> typeChecker = {
         {LuaArgumentType::LuaTypeInteger, lua_isnumber},
         {LuaArgumentType::LuaTypeNumber, lua_isnumber},
@@ -108,13 +283,10 @@ LuaArgument LuaVmExtended::parseArgument(int index, LuaArgumentType type, bool f
                 return lua_isnil(vm, index);
             }
         },
-        {
-            LuaArgumentType::LuaTypeTableMap,
-            [](lua_State *vm, int index) -> int
-            {
-                return lua_istable(vm, index);
-            }
-        },
+        {LuaArgumentType::LuaTypeTableMap, isTable},
+        {LuaArgumentType::LuaTypeDoubleArray, isTable},
+        {LuaArgumentType::LuaTypeFloatArray, isTable},
+        {LuaArgumentType::LuaTypeInt32Array, isTable},
     };      ///< Checker function dictionary
 
     if (!force) {               // No need to check type, if force
@@ -137,7 +309,12 @@ LuaArgument LuaVmExtended::parseArgument(int index, LuaArgumentType type, bool f
         return LuaArgument(static_cast<double>(lua_tonumber(luaVm, index)));
     }
     if (type == LuaArgumentType::LuaTypeString) {
-        return LuaArgument(std::string(lua_tostring(luaVm, index)));
+        size_t length;
+        const char *string = lua_tolstring(luaVm, index, &length);
+        if (stringPool) {
+            return stringPool->intern(string, length);
+        }
+        return LuaArgument(std::string(string, length));
     }
     if (type == LuaArgumentType::LuaTypeUserdata) {
         LuaArgument result(lua_touserdata(luaVm, index));
@@ -147,29 +324,333 @@ LuaArgument LuaVmExtended::parseArgument(int index, LuaArgumentType type, bool f
         return LuaArgument(static_cast<int>(lua_tointeger(luaVm, index)));
     }
     if (type == LuaArgumentType::LuaTypeTableMap) {
-        LuaArgument::TableMapType result;
-        lua_pushnil(luaVm);         // Current key is nil
-
-        while (lua_next(luaVm, index) != 0) {
-            // Cannot user negative index in case of nested tables
-            LuaArgument key = parseArgument(lua_gettop(luaVm) - 2 + 1);       // Parse -2 (but index from start)
-            LuaArgument value = parseArgument(lua_gettop(luaVm) - 1 + 1);     // Parse -1 (but index from start)
-
-            result[key] = value;
-            lua_pop(luaVm, 1);
-        }
-
-        return LuaArgument(result);
+        return parseTable(index);
     }
     if (type == LuaArgumentType::LuaTypeObject) {
         LuaArgument result(lua_touserdata(luaVm, index));
         result.extractObject();
         return result;
     }
+    if (type == LuaArgumentType::LuaTypeDoubleArray) {
+        return LuaArgument(readSequence<double>(luaVm, index));
+    }
+    if (type == LuaArgumentType::LuaTypeFloatArray) {
+        return LuaArgument(readSequence<float>(luaVm, index));
+    }
+    if (type == LuaArgumentType::LuaTypeInt32Array) {
+        return LuaArgument(readSequence<int32_t>(luaVm, index));
+    }
 
     return LuaArgument();
 }
 
+LuaArgument LuaVmExtended::parseTable(int index) const
+{
+    /// Table being parsed
+    struct Frame
+    {
+        int tableIndex;                             ///< Absolute stack index
+        const void *pointer;                        ///< Table identity
+        bool keyParsed;                             ///< Key is parsed, value is not
+        LuaArgument key;                            ///< Parsed key
+        LuaArgument::TableMapType result;           ///< Parsed pairs
+    };
+
+    if (index < 0 && index > LUA_REGISTRYINDEX) {
+        // Nested tables are placed above, so negative index cannot be used
+        index = lua_gettop(luaVm) + index + 1;
+    }
+
+    const int top = lua_gettop(luaVm);
+    std::vector<Frame> frames;                                  ///< Work stack
+    std::unordered_map<const void *, LuaArgument> parsed;       ///< Completed tables (shared references mode)
+    size_t nodes = 0;
+
+    LuaArgument completed;                          ///< Value of the last resolved table
+    bool hasCompleted = false;
+
+    // Returns true, if table has been resolved without parsing
+    auto enterTable = [&](int tableIndex) -> bool
+    {
+        const void *pointer = lua_topointer(luaVm, tableIndex);
+
+        for (const Frame &frame : frames) {
+            if (frame.pointer != pointer) {
+                continue;
+            }
+            if (!parseOptions.breakCycles) {
+                throw LuaTableCycle();
+            }
+
+            completed = LuaArgument();
+            return true;
+        }
+
+        if (parseOptions.shareReferences) {
+            auto it = parsed.find(pointer);
+            if (it != parsed.end()) {
+                completed = it->second;
+                return true;
+            }
+        }
+
+        if (frames.size() >= parseOptions.maxDepth) {
+            throw LuaParseLimitExceeded("Table depth limit exceeded");
+        }
+        if (!lua_checkstack(luaVm, 3)) {        // Key, value and nested key table copy
+            throw LuaParseLimitExceeded("Lua stack limit exceeded");
+        }
+
+        if (parseOptions.numberArrays) {
+            // Longer arrays do not fit the nodes limit, the pairs parser reports it
+            LuaArgument::DoubleArrayType array;
+            const size_t maxLength = (parseOptions.maxNodes - std::min(nodes, parseOptions.maxNodes)) / 2;
+            if (readNumberArray(luaVm, tableIndex, maxLength, array)) {
+                nodes += 2 * array.size();
+
+                completed = LuaArgument(std::move(array));
+                if (parseOptions.shareReferences) {
+                    parsed.emplace(pointer, completed);
+                }
+                return true;
+            }
+        }
+
+        frames.push_back(Frame{tableIndex, pointer, false, LuaArgument(), {}});
+        lua_pushnil(luaVm);                     // Current key is nil
+        return false;
+    };
+
+    try {
+        if (enterTable(index)) {
+            return completed;
+        }
+
+        while (!frames.empty()) {
+            Frame &frame = frames.back();
+
+            if (hasCompleted) {
+                // Nested table has been parsed
+                hasCompleted = false;
+                if (!frame.keyParsed) {
+                    frame.key = std::move(completed);
+                    frame.keyParsed = true;
+                    lua_pop(luaVm, 1);                      // Key copy
+                } else {
+                    if (!frame.key.isNil()) {                   // Key could be a broken cycle
+                        frame.result.emplace(std::move(frame.key), std::move(completed));
+                    }
+                    frame.keyParsed = false;
+                    lua_pop(luaVm, 1);                      // Value
+                }
+                continue;
+            }
+
+            if (frame.keyParsed) {
+                int valueIndex = lua_gettop(luaVm);
+                if (++nodes > parseOptions.maxNodes) {
+                    throw LuaParseLimitExceeded("Table nodes limit exceeded");
+                }
+                if (lua_type(luaVm, valueIndex) == LUA_TTABLE) {
+                    if (!enterTable(valueIndex)) {
+                        continue;
+                    }
+                    hasCompleted = true;                    // Deliver as nested table value
+                    continue;
+                }
+
+                LuaArgument value = parseArgument(valueIndex);
+                if (!frame.key.isNil()) {
+                    frame.result.emplace(std::move(frame.key), std::move(value));
+                }
+                frame.keyParsed = false;
+                lua_pop(luaVm, 1);                          // Value
+                continue;
+            }
+
+            if (lua_next(luaVm, frame.tableIndex) == 0) {
+                completed = LuaArgument(std::move(frame.result));
+                if (parseOptions.shareReferences) {
+                    parsed.emplace(frame.pointer, completed);
+                }
+                frames.pop_back();
+                hasCompleted = true;
+                continue;
+            }
+
+            int keyIndex = lua_gettop(luaVm) - 1;
+            if (++nodes > parseOptions.maxNodes) {
+                throw LuaParseLimitExceeded("Table nodes limit exceeded");
+            }
+            if (lua_type(luaVm, keyIndex) == LUA_TTABLE) {
+                // Key must stay below for lua_next, so parse its copy
+                lua_pushvalue(luaVm, keyIndex);
+                if (!enterTable(lua_gettop(luaVm))) {
+                    continue;
+                }
+                hasCompleted = true;                        // Deliver as nested table key
+                continue;
+            }
+
+            frame.key = parseArgument(keyIndex);
+            frame.keyParsed = true;
+        }
+    } catch (...) {
+        lua_settop(luaVm, top);
+        throw;
+    }
+
+    return completed;
+}
+
+bool LuaVmExtended::walkTable(int index, LuaTableVisitor &visitor, LuaWalkOrder order) const
+{
+    if (index < 0 && index > LUA_REGISTRYINDEX) {
+        index = lua_gettop(luaVm) + index + 1;
+    }
+    if (!lua_istable(luaVm, index)) {
+        throw LuaUnexpectedType(
+            LuaArgumentType::LuaTypeTableMap,
+            static_cast<LuaArgumentType>(lua_type(luaVm, index))
+        );
+    }
+
+    // Nested tables are kept on the stack as (key, table) pairs above the top,
+    // so walker state does not need any allocation
+    const int top = lua_gettop(luaVm);
+    auto tableIndex = [&](unsigned int depth) -> int
+    {
+        return depth == 0 ? index : top + 2 * static_cast<int>(depth);
+    };
+
+    // Pushes (key, value) instead of previous key. Pops the key, if table has ended
+    auto nextPair = [&](unsigned int depth) -> bool
+    {
+        const int table = tableIndex(depth);
+        if (order == LuaWalkOrder::Next || depth > 0) {
+            return lua_next(luaVm, table) != 0;
+        }
+
+        lua_Integer key = lua_tointeger(luaVm, -1) + 1;
+        lua_pop(luaVm, 1);
+        lua_rawgeti(luaVm, table, static_cast<int>(key));
+        if (lua_isnil(luaVm, -1)) {
+            lua_pop(luaVm, 1);
+            return false;
+        }
+        lua_pushinteger(luaVm, key);
+        lua_insert(luaVm, -2);
+        return true;
+    };
+
+    auto pushFirstKey = [&](unsigned int depth)
+    {
+        if (!lua_checkstack(luaVm, 4)) {
+            throw LuaParseLimitExceeded("Lua stack limit exceeded");
+        }
+        if (order == LuaWalkOrder::Next || depth > 0) {
+            lua_pushnil(luaVm);
+        } else {
+            lua_pushinteger(luaVm, 0);
+        }
+    };
+
+    try {
+        LuaWalkAction action = visitor.beginTable(LuaStackValue(luaVm, index), 0);
+        if (action != LuaWalkAction::Continue) {
+            return action != LuaWalkAction::Stop;
+        }
+
+        unsigned int depth = 0;
+        pushFirstKey(depth);
+        while (true) {
+            bool ended = !nextPair(depth);
+
+            if (!ended) {
+                int valueIndex = lua_gettop(luaVm);
+
+                action = visitor.key(LuaStackValue(luaVm, valueIndex - 1), depth);
+                if (action == LuaWalkAction::Stop) {
+                    lua_settop(luaVm, top);
+                    return false;
+                }
+                if (action == LuaWalkAction::Skip) {
+                    lua_pop(luaVm, 1);                  // Value
+                    continue;
+                }
+
+                if (lua_type(luaVm, valueIndex) == LUA_TTABLE) {
+                    const void *pointer = lua_topointer(luaVm, valueIndex);
+                    bool cycle = false;
+                    for (unsigned int parent = 0; parent <= depth && !cycle; parent++) {
+                        cycle = lua_topointer(luaVm, tableIndex(parent)) == pointer;
+                    }
+                    if (cycle) {
+                        if (!parseOptions.breakCycles) {
+                            throw LuaTableCycle();
+                        }
+                        lua_pop(luaVm, 1);
+                        continue;
+                    }
+                    if (depth + 2 > parseOptions.maxDepth) {
+                        throw LuaParseLimitExceeded("Table depth limit exceeded");
+                    }
+
+                    action = visitor.beginTable(LuaStackValue(luaVm, valueIndex), depth + 1);
+                    if (action == LuaWalkAction::Stop) {
+                        lua_settop(luaVm, top);
+                        return false;
+                    }
+                    if (action == LuaWalkAction::Skip) {
+                        lua_pop(luaVm, 1);
+                        continue;
+                    }
+
+                    depth++;
+                    pushFirstKey(depth);
+                    continue;
+                }
+
+                action = visitor.value(LuaStackValue(luaVm, valueIndex), depth);
+                lua_pop(luaVm, 1);                      // Value
+                if (action == LuaWalkAction::Stop) {
+                    lua_settop(luaVm, top);
+                    return false;
+                }
+                if (action != LuaWalkAction::Skip) {
+                    continue;
+                }
+
+                lua_pop(luaVm, 1);                      // Key. Skip the rest of the table
+            }
+
+            // Current table has ended. Stack: ..., table
+            while (true) {
+                action = visitor.endTable(depth);
+                if (depth == 0) {
+                    lua_settop(luaVm, top);
+                    return action != LuaWalkAction::Stop;
+                }
+
+                lua_pop(luaVm, 1);                      // Table. Stack: ..., parent, key
+                depth--;
+                if (action == LuaWalkAction::Stop) {
+                    lua_settop(luaVm, top);
+                    return false;
+                }
+                if (action != LuaWalkAction::Skip) {
+                    break;
+                }
+
+                lua_pop(luaVm, 1);                      // Key. Skip the rest of the parent table
+            }
+        }
+    } catch (...) {
+        lua_settop(luaVm, top);
+        throw;
+    }
+}
+
 std::vector<LuaArgument> LuaVmExtended::call(const std::string &function,
                                              const std::list<LuaArgument> &functionArgs,
                                              int returnSize) const
@@ -205,6 +686,32 @@ void LuaVmExtended::callFunction(const std::string &function,
     }
 }
 
+void LuaVmExtended::callReference(int reference, const std::vector<LuaArgument> &functionArgs) const
+{
+    const int top = lua_gettop(luaVm);
+    if (!lua_checkstack(luaVm, 1)) {
+        throw LuaOutOfRange("Lua stack limit exceeded");
+    }
+    lua_rawgeti(luaVm, LUA_REGISTRYINDEX, reference);
+
+    int size;
+    try {
+        size = this->pushArguments(functionArgs.cbegin(), functionArgs.cend());
+    } catch (...) {
+        lua_settop(luaVm, top);
+        throw;
+    }
+
+    int state = lua_pcall(luaVm, size, 0, 0);
+    if (state != 0) {
+        size_t length = 0;
+        const char *message = lua_tolstring(luaVm, -1, &length);
+        std::string text = message ? std::string(message, length) : "Error object is not a string";
+        lua_settop(luaVm, top);
+        throw LuaCallException(state, text);
+    }
+}
+
 std::vector<LuaArgument> LuaVmExtended::getCallReturn(int amount) const
 {
     if (amount <= 0) {
@@ -276,26 +783,28 @@ void LuaVmExtended::pushObject(const LuaObject &object) const
     lua_setmetatable(luaVm, -2);            // element
 }
 
-void LuaVmExtended::pushTableList(const LuaArgument &argument) const
+void LuaVmExtended::pushTableList(const LuaArgument &argument, LuaPushPlan &plan) const
 {
-    const std::vector<LuaArgument> &list = argument.toList();
+    const auto &list = argument.getList();
+    auto size = plan.nextTable();
 
-    lua_createtable(luaVm, static_cast<int>(list.size()), 0);
+    lua_createtable(luaVm, size.arraySize, size.hashSize);
     for (int i = 0; i < static_cast<int>(list.size()); i++) {
-        this->pushArgument(list[i]);
+        this->pushArgument(list[i], plan);
 
         lua_rawseti(luaVm, -2, i + 1);
     }
 }
 
-void LuaVmExtended::pushTableMap(const LuaArgument &argument) const
+void LuaVmExtended::pushTableMap(const LuaArgument &argument, LuaPushPlan &plan) const
 {
-    const auto &map = argument.toMap();
+    const auto &map = argument.getMap();
+    auto size = plan.nextTable();
 
-    lua_createtable(luaVm, 0, static_cast<int>(map.size()));
+    lua_createtable(luaVm, size.arraySize, size.hashSize);
     for (const auto &pair : map) {
-        this->pushArgument(pair.first);             // Set key
-        this->pushArgument(pair.second);            // Set value
+        this->pushArgument(pair.first, plan);       // Set key
+        this->pushArgument(pair.second, plan);      // Set value
 
         lua_rawset(luaVm, -3);                      // Set table row
     }
@@ -0,0 +1,99 @@
+TestsInfo = {
+    total = 0,
+    success = 0,
+    pending = {},       -- Async checks waiting for their callback
+    finished = false,   -- Synchronous tests are done
+    reported = false,
+}
+Tests = {}
+
+function addTest(name)
+    Tests[name] = _G[name]
+end
+
+function checkTable(left, right)
+    if #left ~= #right then
+        return false
+    end
+
+    for i, v in pairs(left) do
+        if type(v) == 'table' then
+            if not checkTable(v, right[i]) then
+                return false
+            end
+        elseif v ~= right[i] then
+            return false
+        end
+    end
+    return true
+end
+
+function runTest(name, input, excepted, description)
+    TestsInfo.total = TestsInfo.total + 1
+    iprint('===============[ TEST ]===============')
+    iprint(description .. " (" .. name .. ")")
+
+    local result = { Tests[name](unpack(input)) }
+    local status = checkTable(result, excepted)
+    TestsInfo.success = TestsInfo.success + (status and 1 or 0)
+    if status then
+        iprint("Test success")
+    else
+        iprint("Test failed. Expected: ", excepted, "Got: ", result)
+    end
+end
+
+function testStatus()
+    if TestsInfo.reported then
+        return
+    end
+    TestsInfo.reported = true
+
+    iprint('===============[ TOTAL ]===============')
+    if TestsInfo.total == TestsInfo.success then
+        iprint("[TEST TOTAL][OK] All tests passed!")
+    else
+        iprint("[TEST TOTAL][ER] Tests passed " .. TestsInfo.success .. "/" .. TestsInfo.total)
+    end
+end
+
+-- Async check is counted as a test, which fails until the returned callback is called.
+-- check(...) gets the callback arguments and returns status and values to print
+function asyncCheck(label, check)
+    TestsInfo.total = TestsInfo.total + 1
+    TestsInfo.pending[label] = true
+
+    return function(...)
+        if not TestsInfo.pending[label] then
+            return
+        end
+        TestsInfo.pending[label] = nil
+
+        local result = { check(...) }
+        local status = result[1] and true or false
+        TestsInfo.success = TestsInfo.success + (status and 1 or 0)
+        iprint(label, status and "OK" or "FAILED", unpack(result, 2))
+
+        if TestsInfo.finished and next(TestsInfo.pending) == nil then
+            testStatus()
+        end
+    end
+end
+
+-- Print the total, when all async checks report or on the timeout (pending checks fail)
+function finishTests(timeout)
+    TestsInfo.finished = true
+    if next(TestsInfo.pending) == nil then
+        testStatus()
+        return
+    end
+
+    setTimer(function()
+        -- Late callbacks are ignored
+        for label in pairs(TestsInfo.pending) do
+            iprint(label, "TIMEOUT")
+        end
+        TestsInfo.pending = {}
+        testStatus()
+    end, timeout, 1)
+end
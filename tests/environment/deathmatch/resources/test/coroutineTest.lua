@@ -0,0 +1,54 @@
+-- Module is built with -DBUILD_COROUTINES=ON
+if not test_asyncSleep then
+    return
+end
+
+-- Checks are counted before the tests total is printed
+local sleepCheck = asyncCheck("[COROUTINE] test_asyncSleep", function(status, slept, elapsed)
+    return status == true and slept == true and elapsed >= 100, elapsed
+end)
+local pcallCheck = asyncCheck("[COROUTINE] test_asyncSleep through pcall", function(success, message)
+    return success == false, message
+end)
+local scriptResumeCheck = asyncCheck("[COROUTINE] test_asyncSleep coroutine resumed by script", function(results, continued)
+    return results == 0 and not continued, results
+end)
+local reclaimCheck = asyncCheck("[COROUTINE] test_asyncSuspended failed yield is reclaimed", function(registered, left)
+    return registered == 1 and left == 0, registered, left
+end)
+local mainThreadCheck = asyncCheck("[COROUTINE] test_asyncSleep from main thread", function(result, message)
+    return result == false, message
+end)
+
+addEventHandler("onResourceStart", resourceRoot, function()
+    iprint('===============[ TESTING COROUTINES ]===============')
+
+    mainThreadCheck(test_asyncSleep(1))
+
+    coroutine.wrap(function()
+        local started = getTickCount()
+        local status, slept = test_asyncSleep(100)
+        sleepCheck(status, slept, getTickCount() - started)
+    end)()
+
+    -- Yield across pcall fails, the task is dropped by the pulse, which settles it
+    local before = test_asyncSuspended()
+    coroutine.wrap(function()
+        pcallCheck(pcall(test_asyncSleep, 10))
+    end)()
+    local registered = test_asyncSuspended() - before
+
+    -- The script resumes the coroutine before the task finishes, the task must not resume it again
+    local results, continued
+    local thread = coroutine.create(function()
+        results = select("#", test_asyncSleep(50))
+        coroutine.yield()
+        continued = true
+    end)
+    coroutine.resume(thread)
+    coroutine.resume(thread)
+    setTimer(function()
+        scriptResumeCheck(results, continued)
+        reclaimCheck(registered, test_asyncSuspended())
+    end, 200, 1)
+end)
@@ -0,0 +1,841 @@
+local TEST_ELEMENTS = {
+    Ped(0, 0, 0, 0),
+    Ped(0, 5, 6, 78),
+    Ped(0, 9, 14, 778),
+}
+
+TEST_ELEMENTS[2].dimension = 523
+
+function returnFive()
+    return 5
+end
+
+local function findFunctionStats(name)
+    for _, stats in ipairs(getFunctionStats(false)) do
+        if stats["function"] == name then
+            return stats
+        end
+    end
+    return { calls = 0, errors = 0 }
+end
+
+-- Raised errors are counted once the call is unwound, clean calls are never errors
+function checkFunctionStats()
+    local before = findFunctionStats("test_raiseError")
+    local raised = pcall(test_raiseError, true)
+    test_raiseError(false)
+    local after = findFunctionStats("test_raiseError")
+    return not raised
+        and after.calls == before.calls + 2
+        and after.errors == before.errors + 1
+        and after.p50 >= 0 and after.max >= after.p50
+end
+
+-- Sessions belong to the VM, so coroutines see the session of the main thread
+function checkProfilerStats()
+    local before = getProfilerStats().samples
+    local started = startProfiler(100, 0)
+    local sum = 0
+    for i = 1, 200000 do
+        sum = sum + i % 7
+    end
+    local running = coroutine.wrap(function()
+        return getProfilerStats().running
+    end)()
+    local stopped = stopProfiler()
+    local after = getProfilerStats()
+    return started and running and stopped and not after.running and after.samples > before
+end
+
+-- Coroutines allocate through the tracker of the VM
+function checkMemoryStats()
+    local enabled = enableMemoryTelemetry()
+    local before = getMemoryStats()
+    local blocks = coroutine.wrap(function()
+        local result = {}
+        for i = 1, 1000 do
+            result[i] = { i }
+        end
+        return result
+    end)()
+    local after = getMemoryStats()
+    local all = getMemoryStats(true)
+    local disabled = disableMemoryTelemetry()
+    return enabled and disabled and #blocks == 1000 and getMemoryStats() == false
+        and after.allocations >= before.allocations + 1000
+        and after.liveBytes > before.liveBytes and next(all) ~= nil
+end
+
+-- Pacing belongs to the VM, pulses of the host run its steps
+function checkGcPacerStats(done)
+    local enabled = enableGcPacer()
+    local shared = coroutine.wrap(function()
+        return getGcPacerStats()
+    end)()
+    setTimer(function()
+        local stats = getGcPacerStats()
+        local disabled = disableGcPacer()
+        done(disabled and stats.pulses > 0 and getGcPacerStats() == false)
+    end, 100, 1)
+    return enabled and shared ~= false and shared.pause == 200
+end
+
+-- Strings pinned by a main thread call are pushed onto the coroutine stack
+function checkSharedStringPool()
+    local records = { { name = "a", x = 1 }, { name = "b", x = 2 }, { name = "a", x = 3 } }
+    local first, size = test_sharedStringPool(records)
+    local second, sharedSize, extra = coroutine.wrap(function()
+        return test_sharedStringPool(records)
+    end)()
+    local third, lastSize = test_sharedStringPool(records)
+    return size > 0 and sharedSize == size and lastSize == size and extra == nil
+        and second[1].name == "a" and second[2].name == "b" and second[3].x == 3
+        and first[3].name == "a" and third[2].name == "b"
+end
+
+local CYCLE_TABLE = { value = 1 }
+CYCLE_TABLE.self = CYCLE_TABLE
+
+local SHARED_TABLE = { 1, 2, 3 }
+
+local function range(amount)
+    local result = {}
+    for i = 1, amount do
+        result[i] = i
+    end
+    return result
+end
+
+local function pushManyExpected(amount)
+    local result = range(amount)
+    table.insert(result, 1, range(amount))
+    return result
+end
+
+-- Writes of a worker chunk call (globals, library fields, loadstring chunks) must not be seen by the next call
+local WORKER_ISOLATION_CHUNK = "local fresh = marker == nil and string.marker == nil and leak == nil "
+    .. "marker = true string.marker = true loadstring('leak = true')() "
+    .. "return fresh and leak == true and _G.marker == true"
+
+local function nestedTable(depth)
+    local result = {}
+    local current = result
+    for _ = 1, depth do
+        current.next = {}
+        current = current.next
+    end
+    return result
+end
+
+local TEST_FUNCTIONS = {
+    {
+        name = "test_simple",
+        description = "Hello world test",
+        expected = { "Yes!" },
+    },
+    {
+        name = "test_simpleList",
+        description = "List output test",
+        expected = { "Sample string", -543, true, 5.4 },
+    },
+    {
+        name = "test_echo",
+        description = "Multi value echo test",
+        input = { "Hello world", true, false, 123123, -7.6 },
+        expected = { "Hello world", true, false, 123123, -7.6 },
+    },
+    {
+        name = "test_echo",
+        description = "Echo with nil test",
+        input = { nil, false },
+        expected = { nil, false },
+    },
+    {
+        name = "test_echo",
+        description = "Numbers echo test",
+        input = { 76, 76.8, 76.777779 },
+        expected = { 76, 76.8, 76.777779 },
+    },
+    {
+        name = "test_isNumber",
+        description = "Successful number test",
+        input = { 523.432 },
+        expected = { true },
+    },
+    {
+        name = "test_isNumber",
+        description = "Bad number test",
+        input = { "it's a string" },
+        expected = { false },
+    },
+    {
+        name = "test_isString",
+        description = "Successful string test",
+        input = { "it's a string" },
+        expected = { true },
+    },
+    {
+        name = "test_isString",
+        description = "'Number is string' test",
+        input = { 657474 },
+        expected = { true },
+    },
+    {
+        name = "test_isString",
+        description = "Bad string test",
+        input = { TEST_ELEMENTS[1] },
+        expected = { false },
+    },
+    {
+        name = "test_echoElement",
+        description = "Successful echo element",
+        input = { TEST_ELEMENTS[1] },
+        expected = { TEST_ELEMENTS[1] },
+    },
+    {
+        name = "test_echoElement",
+        description = "Successful echo root",
+        input = { root },
+        expected = { root },
+    },
+    {
+        name = "test_echoElement",
+        description = "Bad echo element",
+        input = { "string" },
+        expected = { false },
+    },
+    {
+        name = "test_strictTypes",
+        description = "Successful {bool, string, int} test",
+        input = { true, "i am string", 657 },
+        expected = { true },
+    },
+    {
+        name = "test_strictTypes",
+        description = "Successful {bool, string, int} test. Float is integer (c) Lua",
+        input = { true, "i am string", 657.86 },
+        expected = { true },
+    },
+    {
+        name = "test_strictTypes",
+        description = "Bad {bool, string, int} test. 1 is not bool (c) Lua",
+        input = { 1, "string", 657.86 },
+        expected = { false },
+    },
+    {
+        name = "test_strictTypes",
+        description = "Successful {bool, string, int} test. Number is string (c) Lua",
+        input = { false, 564, 657.86 },
+        expected = { true },
+    },
+    {
+        name = "test_simpleTable",
+        description = "Table hello world test",
+        input = {},
+        expected = { { {
+                           name = "name",
+                           surname = "surname"
+                       } } },
+    },
+    {
+        name = "test_callGetElementPosition",
+        description = "Call getElementPosition",
+        input = { TEST_ELEMENTS[2] },
+        expected = {
+            TEST_ELEMENTS[2]:getPosition().x,
+            TEST_ELEMENTS[2]:getPosition().y,
+            TEST_ELEMENTS[2]:getPosition().z,
+        },
+    },
+    {
+        name = "test_callGetElementPosition",
+        description = "Call getElementPosition for multiple arguments",
+        input = { TEST_ELEMENTS[2], TEST_ELEMENTS[3] },
+        expected = {
+            TEST_ELEMENTS[2]:getPosition().x,
+            TEST_ELEMENTS[2]:getPosition().y,
+            TEST_ELEMENTS[2]:getPosition().z,
+            TEST_ELEMENTS[3]:getPosition().x,
+            TEST_ELEMENTS[3]:getPosition().y,
+            TEST_ELEMENTS[3]:getPosition().z,
+        },
+    },
+    {
+        name = "test_callElementGetDimensionMethod",
+        description = "Call element:getDimension",
+        input = { TEST_ELEMENTS[2] },
+        expected = { TEST_ELEMENTS[2]:getDimension() },
+    },
+    {
+        name = "test_pushFunction",
+        description = "Call function after parsing and pushing (C++)",
+        input = { returnFive },
+        expected = { returnFive() },
+    },
+    {
+        name = "test_advancedTable",
+        description = "Create advanced table",
+        input = {  },
+        expected = {
+            "start",
+            {
+                -1,
+                {
+                    [true] = "value",
+                    keyOne = 6547
+                },
+                -3
+            },
+            7854,
+            "stop"
+        },
+    },
+    {
+        name = "test_echo",
+        description = "Successful echo simple table",
+        input = { {
+                      "TEST_ELEMENTS[2]",
+                      "value",
+                      6745,
+                  } },
+        expected = { {
+                         "TEST_ELEMENTS[2]",
+                         "value",
+                         6745,
+                     } },
+    },
+    {
+        name = "test_echo",
+        description = "Successful echo nested tables",
+        input = { {
+                      "TEST_ELEMENTS[2]",
+                      {
+                          [true] = "value",
+                          keyOne = 6547,
+                      },
+                  } },
+        expected = { {
+                         "TEST_ELEMENTS[2]",
+                         {
+                             [true] = "value",
+                             keyOne = 6547,
+                         },
+                     } },
+    },
+    {
+        name = "test_tableToList",
+        description = "Successful table (parsed as map in C++) to list",
+        input = { { 0, 1, 2, 3, 4, 5 } },
+        expected = { 0, 1, 2, 3, 4, 5 },
+    },
+    {
+        name = "test_tableToList",
+        description = "Table (parsed as map in C++) to list (bad)",
+        input = { { 0, 1, 2, 3, 4, 5, key='value' } },
+        expected = { false },
+    },
+    {
+        name = "test_listToMap",
+        description = "list to map",
+        input = { },
+        expected = { {
+                         [1] = 53,
+                         [2] = 42,
+                         [3] = 24,
+                         [4] = 74,
+                         [5] = 81,
+                         ["key"] = 876,
+                     } },
+    },
+    {
+        name = "test_constructors",
+        description = "Successful constructor tests",
+        input = { "string" },
+        expected = {"string", "string", "string"},
+    },
+    {
+        name = "test_checkGetArgumentsUnexpected",
+        description = "Check getArguments exception LuaUnexpectedType",
+        input = { "string" },
+        expected = { true },
+    },
+    {
+        name = "test_checkGetArgumentsBad",
+        description = "Check getArguments exception LuaBadType",
+        input = { returnFive },
+        expected = { true },
+    },
+    {
+        name = "test_checkGetArgumentsOutOfRange",
+        description = "Check getArguments exception LuaOutOfRange",
+        input = {  },
+        expected = { true },
+    },
+    {
+        name = "test_checkParseArgumentObject",
+        description = "Check parseArgument for lua object",
+        input = { TEST_ELEMENTS[1] },
+        expected = { true },
+    },
+    {
+        name = "test_callFunction",
+        description = "Call global function",
+        input = { "returnFive" },
+        expected = { returnFive() },
+    },
+    {
+        name = "test_tableProxy",
+        description = "Lazy table proxy field access",
+        input = { { 5, 6, 7, name = "value" }, "name" },
+        expected = { "value", 3 },
+    },
+    {
+        name = "test_tableProxy",
+        description = "Lazy table proxy nested access",
+        input = { { config = { inner = { 1, 2, { deep = true } } } }, "config", "inner", 3 },
+        expected = { { deep = true }, 3 },
+    },
+    {
+        name = "test_tableProxy",
+        description = "Lazy table proxy missing field",
+        input = { { 1, 2 }, "missing" },
+        expected = { nil, 2 },
+    },
+    {
+        name = "test_tableProxy",
+        description = "Lazy table proxy bad nested type",
+        input = { { config = "string" }, "config", "key" },
+        expected = { false },
+    },
+    {
+        name = "test_checkParseCycle",
+        description = "Self-referencing table is detected",
+        input = { CYCLE_TABLE },
+        expected = { true },
+    },
+    {
+        name = "test_checkParseDepth",
+        description = "Table depth limit exceeded",
+        input = { nestedTable(10), 5 },
+        expected = { true },
+    },
+    {
+        name = "test_checkParseDepth",
+        description = "Table depth limit not exceeded",
+        input = { nestedTable(3), 5 },
+        expected = { false },
+    },
+    {
+        name = "test_echoShared",
+        description = "Echo table with shared references",
+        input = { { first = SHARED_TABLE, second = SHARED_TABLE } },
+        expected = { { first = { 1, 2, 3 }, second = { 1, 2, 3 } } },
+    },
+    {
+        name = "test_echoShared",
+        description = "Echo self-referencing table with broken cycles",
+        input = { CYCLE_TABLE },
+        expected = { { value = 1 } },
+    },
+    {
+        name = "test_pushMany",
+        description = "Push values over the default stack size",
+        input = { 1000 },
+        expected = pushManyExpected(1000),
+    },
+    {
+        name = "test_sumNumbers",
+        description = "Sum arguments through the stack view",
+        input = { 1, 2.5, 3, "4" },
+        expected = { 10.5 },
+    },
+    {
+        name = "test_sumNumbers",
+        description = "Sum arguments through the stack view (bad type)",
+        input = { 1, {} },
+        expected = { false },
+    },
+    {
+        name = "test_sumField",
+        description = "Sum record field with table walker",
+        input = {
+            {
+                { name = "first", x = 1.5, nested = { x = 100 } },
+                { x = 2, name = "second" },
+                { name = "third", x = 3 },
+            },
+            "x"
+        },
+        expected = { 6.5 },
+    },
+    {
+        name = "test_sumField",
+        description = "Sum record field with table walker (stopped)",
+        input = { { { x = 1 }, { x = "bad" } }, "x" },
+        expected = { false },
+    },
+    {
+        name = "test_extractShopItem",
+        description = "Schema extraction of required and optional fields",
+        input = { {
+                      name = "Pizza",
+                      price = 10.5,
+                      tags = { "food", "hot" },
+                      spawns = { { id = 1, position = { x = 1, y = 2, z = 3 } } },
+                      ignored = true,
+                  } },
+        expected = { {
+                         name = "Pizza",
+                         price = 10.5,
+                         tags = { "food", "hot" },
+                         spawns = { { id = 1, position = { x = 1, y = 2 } } },
+                     } },
+    },
+    {
+        name = "test_extractShopItem",
+        description = "Schema extraction missing field path",
+        input = { { price = 10 } },
+        expected = { false, "name" },
+    },
+    {
+        name = "test_extractShopItem",
+        description = "Schema extraction nested mismatch path",
+        input = { {
+                      name = "Pizza",
+                      price = 10,
+                      spawns = { { id = 1, position = { x = 1, y = 2 } }, { id = 2, position = { x = "bad", y = 2 } } },
+                  } },
+        expected = { false, "spawns[2].position.x" },
+    },
+    {
+        name = "test_extractShopItem",
+        description = "Schema extraction scalar list mismatch path",
+        input = { { name = "Pizza", price = 10, tags = { "food", {} } } },
+        expected = { false, "tags[2]" },
+    },
+    {
+        name = "test_extractSamples",
+        description = "Schema extraction of typed array fields",
+        input = { { name = "a", samples = { 1.5, 2 }, ids = { 1, -2 } } },
+        expected = { { name = "a", samples = { 1.5, 2 }, ids = { 1, -2 } } },
+    },
+    {
+        name = "test_extractSamples",
+        description = "Schema typed array element mismatch path",
+        input = { { name = "a", samples = { 1, "2", 3 } } },
+        expected = { false, "samples[2]" },
+    },
+    {
+        name = "test_extractSamples",
+        description = "Schema int32 array element out of range path",
+        input = { { name = "a", samples = {}, ids = { 1, 2, 2 ^ 31 } } },
+        expected = { false, "ids[3]" },
+    },
+    {
+        name = "test_typeNames",
+        description = "Visit arguments of every type",
+        input = { true, 1.5, "text", {}, { a = 1 } },
+        expected = { "boolean", "number", "string", "table", "table" },
+    },
+    {
+        name = "test_internRecords",
+        description = "Repeated record keys and values are interned once",
+        input = { { { name = "a", x = 1 }, { name = "a", x = 2 }, { name = "b", x = 3 } } },
+        expected = { { { name = "a", x = 1 }, { name = "a", x = 2 }, { name = "b", x = 3 } }, 4 },
+    },
+    {
+        name = "checkSharedStringPool",
+        description = "VM string pool pushes cached strings from coroutines",
+        input = {},
+        expected = { true },
+    },
+    {
+        name = "test_numberArray",
+        description = "Sequence of numbers is parsed as typed array",
+        input = { { 1.5, 2, 3 } },
+        expected = { true, { 1.5, 2, 3 } },
+    },
+    {
+        name = "test_numberArray",
+        description = "Sequence in the hash part is parsed as typed array",
+        input = { { [3] = 3, [2] = 2, [1] = 1 } },
+        expected = { true, { 1, 2, 3 } },
+    },
+    {
+        name = "test_numberArray",
+        description = "Sequence with holes stays a table",
+        input = { { 1, 2, [4] = 4 } },
+        expected = { false, { 1, 2, [4] = 4 } },
+    },
+    {
+        name = "test_numberArray",
+        description = "Mixed table stays a table",
+        input = { { 1, 2, x = 3 } },
+        expected = { false, { 1, 2, x = 3 } },
+    },
+    {
+        name = "test_int32Array",
+        description = "Explicit int32 array",
+        input = { { 1, 2, 3 } },
+        expected = { 6, { 1, 2, 3 } },
+    },
+    {
+        name = "vectorDistances",
+        description = "Batch distances to origin",
+        input = { { 0, 0, 0, 3, 4, 0 }, 0, 0, 0 },
+        expected = { { 0, 5 } },
+    },
+    {
+        name = "vectorDistances",
+        description = "Batch distances with broken points array",
+        input = { { 1, 2 }, 0, 0, 0 },
+        expected = { false, "Points array size must be a multiple of 3" },
+    },
+    {
+        name = "vectorPairDistances",
+        description = "Batch pairwise distances",
+        input = { { 0, 0, 0, 1, 1, 1 }, { 0, 3, 4, 1, 1, 1 } },
+        expected = { { 5, 0 } },
+    },
+    {
+        name = "vectorWithinRadius",
+        description = "Batch radius filter",
+        input = { { 0, 0, 0, 10, 0, 0, 1, 1, 1 }, 0, 0, 0, 2 },
+        expected = { { 1, 3 } },
+    },
+    {
+        name = "vectorInsideBox",
+        description = "Batch AABB containment",
+        input = { { 0, 0, 0, 10, 0, 0, 1, 1, 1 }, -1, -1, -1, 1, 1, 1 },
+        expected = { { 1, 3 } },
+    },
+    {
+        name = "vectorNearest",
+        description = "Batch k-nearest",
+        input = { { 0, 0, 0, 10, 0, 0, 1, 1, 1 }, 9, 0, 0, 2 },
+        expected = { { 2, 3 } },
+    },
+    {
+        name = "test_asyncSum",
+        description = "Job is submitted to worker pool (callback is called on pulse)",
+        input = { { 1, 2, 3 }, asyncCheck("[ASYNC] test_asyncSum callback", function(success, sum)
+            return success and sum == 6, sum
+        end) },
+        expected = { true },
+    },
+    {
+        name = "test_setTimer",
+        description = "Native timer calls lua callback with arguments on pulse",
+        input = { asyncCheck("[TIMER] test_setTimer callback", function(first, second)
+            return first == 1 and second == "two", first, second
+        end), 50, 1, 1, "two" },
+        expected = { 1 },
+    },
+    {
+        name = "test_setTimer",
+        description = "Interval less than 1 ms is rejected",
+        input = { function() end, 0, 1 },
+        expected = { false, "Interval must be between 1 and 4294967295" },
+    },
+    {
+        name = "test_killTimer",
+        description = "Not existing timer is not killed",
+        input = { 1000000 },
+        expected = { false },
+    },
+    {
+        name = "test_snapshotRoundTrip",
+        description = "Snapshot keeps nested tables and strings",
+        input = { { 1, "two", { three = 3, list = { true, false } } } },
+        expected = { { 1, "two", { three = 3, list = { true, false } } } },
+    },
+    {
+        name = "test_batchEvents",
+        description = "1000 events are delivered in one call on pulse",
+        input = { asyncCheck("[EVENTS] test_batchEvents callback", function(events)
+            return #events == 1000 and events[1000] == 999, #events
+        end), 1000, 0 },
+        expected = { true },
+    },
+    {
+        name = "test_batchEvents",
+        description = "Events with equal keys are merged (latest wins)",
+        input = { asyncCheck("[EVENTS] test_batchEvents merged callback", function(events)
+            return #events == 10 and events[1] == 990, #events
+        end), 1000, 10 },
+        expected = { true },
+    },
+    {
+        name = "test_unsubscribeEvents",
+        description = "Not existing subscription is not removed",
+        input = { 1000000 },
+        expected = { false },
+    },
+    {
+        name = "test_runWorker",
+        description = "Chunk runs on worker lua state with snapshot arguments",
+        input = { "local list, k = ... local sum = 0 for _, v in ipairs(list) do sum = sum + v * k end return sum, string.rep('a', 3)",
+            asyncCheck("[WORKER] test_runWorker callback", function(success, sum, text)
+                return success and sum == 12 and text == "aaa", sum, text
+            end), { 1, 2, 3 }, 2 },
+        expected = { true },
+    },
+    {
+        name = "test_runWorker",
+        description = "Worker state has no file access",
+        input = { "return dofile == nil and loadfile == nil", asyncCheck("[WORKER] test_runWorker sandbox callback", function(success, sandboxed)
+            return success and sandboxed
+        end) },
+        expected = { true },
+    },
+    {
+        name = "test_runWorker",
+        description = "Syntax error is delivered to callback",
+        input = { "return +", asyncCheck("[WORKER] test_runWorker error callback", function(success, message)
+            return not success, message
+        end) },
+        expected = { true },
+    },
+    {
+        name = "test_runWorker",
+        description = "Binary chunk is rejected",
+        input = { string.dump(function() return 1 end), asyncCheck("[WORKER] test_runWorker binary chunk callback", function(success, message)
+            return not success, message
+        end) },
+        expected = { true },
+    },
+    {
+        name = "test_runWorker",
+        description = "Worker loadstring refuses binary chunks, environment functions are hidden",
+        input = { "return loadstring(...) == nil and load == nil and getfenv == nil and setfenv == nil",
+            asyncCheck("[WORKER] test_runWorker loadstring callback", function(success, hidden)
+                return success and hidden
+            end), string.dump(function() end) },
+        expected = { true },
+    },
+    {
+        name = "test_runWorker",
+        description = "Worker chunk call 1 gets a fresh environment",
+        input = { WORKER_ISOLATION_CHUNK, asyncCheck("[WORKER] test_runWorker environment callback 1", function(success, fresh)
+            return success and fresh
+        end) },
+        expected = { true },
+    },
+    {
+        name = "test_runWorker",
+        description = "Worker chunk call 2 gets a fresh environment",
+        input = { WORKER_ISOLATION_CHUNK, asyncCheck("[WORKER] test_runWorker environment callback 2", function(success, fresh)
+            return success and fresh
+        end) },
+        expected = { true },
+    },
+    {
+        name = "test_counters",
+        description = "Marshaling counters of the scope (when compiled in)",
+        input = { { 1, "two", { 3 } } },
+        expected = { true },
+    },
+    {
+        name = "test_functionStats",
+        description = "Call statistics of test functions",
+        input = {},
+        expected = { true },
+    },
+    {
+        name = "checkFunctionStats",
+        description = "getFunctionStats counts calls and unwound errors",
+        input = {},
+        expected = { true },
+    },
+    {
+        name = "test_profiler",
+        description = "Sampled stacks of a lua function",
+        input = { function()
+            local sum = 0
+            for i = 1, 200000 do
+                sum = sum + i % 7
+            end
+            return sum
+        end },
+        expected = { true },
+    },
+    {
+        name = "checkProfilerStats",
+        description = "getProfilerStats counts samples of the VM session",
+        input = {},
+        expected = { true },
+    },
+    {
+        name = "test_memoryTelemetry",
+        description = "Allocations of module pushes",
+        input = { { 1, 2, 3, "four", { five = 5 } } },
+        expected = { true },
+    },
+    {
+        name = "checkMemoryStats",
+        description = "getMemoryStats counts allocations of the VM and its coroutines",
+        input = {},
+        expected = { true },
+    },
+    {
+        name = "test_gcPacer",
+        description = "Default options collect in pulses",
+        input = { function()
+            local result = {}
+            for i = 1, 20000 do
+                result[i] = { i, tostring(i) }
+            end
+            return result
+        end },
+        expected = { true },
+    },
+    {
+        name = "test_gcPacerCycles",
+        description = "Automatic steps between pulses finish pacer cycles (cycles are not run back to back)",
+        input = { function()
+            local result = {}
+            for i = 1, 100000 do
+                result[i] = { i }
+            end
+            return result
+        end, function()
+            for i = 1, 10000 do
+                local garbage = { i }
+            end
+        end },
+        expected = { true },
+    },
+    {
+        name = "checkGcPacerStats",
+        description = "getGcPacerStats counts pulses of the VM",
+        input = { asyncCheck("[GC] checkGcPacerStats pulses callback", function(result)
+            return result
+        end) },
+        expected = { true },
+    },
+}
+
+addEventHandler("onResourceStart", resourceRoot, function()
+    iprint('===============[ TESTING DEV ]===============')
+    outputDebugString(test_dev_status())
+
+    iprint('===============[ TESTING START ]===============')
+
+    for _, v in pairs(TEST_FUNCTIONS) do
+        addTest(v.name)
+    end
+
+    for _, v in pairs(TEST_FUNCTIONS) do
+        runTest(
+                v.name,
+                v.input or {},
+                v.expected,
+                v.description or ""
+        )
+    end
+
+    iprint('===============[ TESTING END ]===============')
+
+    -- Callbacks of async tests are called on pulse
+    finishTests(2000)
+end)
\ No newline at end of file
@@ -0,0 +1,91 @@
+-- Lua -> module -> Lua round trips with realistic payloads
+-- Usage (server or host console): throughputbench [calls per scenario]
+
+local function smallRecord()
+    return { id = 1024, name = "Player_1024", x = 1520.5, y = -1675.25, z = 13.5, active = true }
+end
+
+local function bigArray()
+    local result = {}
+    for i = 1, 10000 do
+        result[i] = i * 0.5
+    end
+    return result
+end
+
+local function nestedConfig()
+    local modes = {}
+    for i = 1, 8 do
+        local maps = {}
+        for j = 1, 8 do
+            maps[j] = { name = "map" .. i .. "_" .. j, weight = j / 8, spawns = { { 0, 0, 3 }, { 10, 10, 3 } } }
+        end
+        modes[i] = { name = "mode" .. i, enabled = i % 2 == 0, maps = maps }
+    end
+    return { server = { name = "Benchmark", slots = 128, password = false }, modes = modes }
+end
+
+local function elementList()
+    local result = {}
+    for i = 1, 100 do
+        result[i] = createPed(0, i, i, 3)
+    end
+    return result
+end
+
+local SCENARIOS = {
+    { "smallRecords", test_echo, smallRecord },
+    { "bigArray", test_echo, bigArray },
+    { "bigArrayTyped", test_numberArray, bigArray },
+    { "elementList", test_echo, elementList },
+    { "nestedConfig", test_echo, nestedConfig },
+}
+
+local function percentile(sorted, fraction)
+    return sorted[math.max(1, math.ceil(#sorted * fraction))]
+end
+
+local function run(calls, callback, payload)
+    local clock = test_dev_clock
+
+    -- Warm up
+    for _ = 1, math.min(calls, 100) do
+        callback(payload)
+    end
+
+    local started = clock()
+    for _ = 1, calls do
+        callback(payload)
+    end
+    local elapsed = clock() - started
+
+    -- Latency is measured separately, clock calls are not free
+    local latencies = {}
+    for i = 1, calls do
+        local callStarted = clock()
+        callback(payload)
+        latencies[i] = clock() - callStarted
+    end
+    table.sort(latencies)
+
+    return calls / math.max(elapsed, 1) * 1000000, percentile(latencies, 0.5), percentile(latencies, 0.99)
+end
+
+addCommandHandler("throughputbench", function(_, _, calls)
+    calls = tonumber(calls) or 10000
+
+    iprint(("===============[ THROUGHPUT: %d calls per scenario ]==============="):format(calls))
+    for _, scenario in ipairs(SCENARIOS) do
+        local name, callback, makePayload = unpack(scenario)
+        local payload = makePayload()
+        local callsPerSecond, p50, p99 = run(calls, callback, payload)
+        iprint(("%-14s %12.0f calls/s   p50 %9.1f us   p99 %9.1f us"):format(name, callsPerSecond, p50, p99))
+
+        if name == "elementList" then
+            for _, element in ipairs(payload) do
+                destroyElement(element)
+            end
+        end
+    end
+    iprint("===============[ THROUGHPUT END ]===============")
+end)
@@ -0,0 +1,88 @@
+-- Native batch vector math against equivalent Lua loops
+-- Usage (server console): vectorbench [points amount] [repeats]
+
+local function randomPoints(amount)
+    local points = {}
+    for i = 1, amount * 3 do
+        points[i] = math.random() * 6000 - 3000
+    end
+    return points
+end
+
+local function luaDistances(points, x, y, z)
+    local result = {}
+    for i = 1, #points, 3 do
+        local dx, dy, dz = points[i] - x, points[i + 1] - y, points[i + 2] - z
+        result[#result + 1] = math.sqrt(dx * dx + dy * dy + dz * dz)
+    end
+    return result
+end
+
+local function luaWithinRadius(points, x, y, z, radius)
+    local result = {}
+    local radiusSquared = radius * radius
+    for i = 1, #points, 3 do
+        local dx, dy, dz = points[i] - x, points[i + 1] - y, points[i + 2] - z
+        if dx * dx + dy * dy + dz * dz <= radiusSquared then
+            result[#result + 1] = (i + 2) / 3
+        end
+    end
+    return result
+end
+
+local function luaInsideBox(points, minX, minY, minZ, maxX, maxY, maxZ)
+    local result = {}
+    for i = 1, #points, 3 do
+        local x, y, z = points[i], points[i + 1], points[i + 2]
+        if x >= minX and x <= maxX and y >= minY and y <= maxY and z >= minZ and z <= maxZ then
+            result[#result + 1] = (i + 2) / 3
+        end
+    end
+    return result
+end
+
+local function luaNearest(points, x, y, z, k)
+    local distances = luaDistances(points, x, y, z)
+    local order = {}
+    for i = 1, #distances do
+        order[i] = i
+    end
+    table.sort(order, function(left, right)
+        return distances[left] < distances[right]
+    end)
+
+    local result = {}
+    for i = 1, math.min(k, #order) do
+        result[i] = order[i]
+    end
+    return result
+end
+
+local function measure(repeats, callback, ...)
+    local start = getTickCount()
+    for _ = 1, repeats do
+        callback(...)
+    end
+    return (getTickCount() - start) / repeats
+end
+
+local SCENARIOS = {
+    { "distances", luaDistances, vectorDistances, { 0, 0, 0 } },
+    { "withinRadius", luaWithinRadius, vectorWithinRadius, { 0, 0, 0, 500 } },
+    { "insideBox", luaInsideBox, vectorInsideBox, { -500, -500, -500, 500, 500, 500 } },
+    { "nearest", luaNearest, vectorNearest, { 0, 0, 0, 10 } },
+}
+
+addCommandHandler("vectorbench", function(_, _, amount, repeats)
+    amount = tonumber(amount) or 100000
+    repeats = tonumber(repeats) or 10
+
+    local points = randomPoints(amount)
+    iprint(("===============[ VECTOR MATH: %d points, %d repeats ]==============="):format(amount, repeats))
+    for _, scenario in ipairs(SCENARIOS) do
+        local name, luaFunction, nativeFunction, arguments = unpack(scenario)
+        local luaTime = measure(repeats, luaFunction, points, unpack(arguments))
+        local nativeTime = measure(repeats, nativeFunction, points, unpack(arguments))
+        iprint(("%-14s lua %8.2f ms   native %8.2f ms"):format(name, luaTime, nativeTime))
+    end
+end)
@@ -1,4 +1,7 @@
 #include "functions.h"
+#include "ModuleSdk/LuaCounters.h"
+#include "ModuleSdk/LuaSchema.h"
+#include "ModuleSdk/LuaSnapshot.h"
 #include "lua/ILuaModuleManager.h"
 #include <list>
 
@@ -22,6 +25,28 @@ using AddType = std::pair<decltype(allFunctions)::iterator, bool>;
 
 std::unordered_map<std::string, Type> allFunctions = {};
 
+LuaTaskPool taskPool;
+
+LuaStatePool statePool(2, 100000000);
+
+LuaScheduler scheduler;
+
+LuaEventBatcher events;
+
+LuaFunctionStats functionStats;
+
+LuaProfiler profiler;
+
+LuaMemoryTelemetry memory;
+
+LuaGcPacer gcPacer;
+
+std::map<const void *, std::unique_ptr<LuaStringPool>> stringPools;
+
+#ifdef MODULE_SDK_COROUTINES
+LuaCoroutines coroutines;
+#endif
+
 std::string stackDump(lua_State *luaVm)
 {
     std::string result;
@@ -400,5 +425,721 @@ CREATE_TEST_FUNCTION(callFunction)
     return lua.pushArguments(result.cbegin(), result.cend());
 }
 
+CREATE_TEST_FUNCTION(tableProxy)
+{
+    LuaVmExtended lua(luaVm);
+    int top = lua_gettop(luaVm);
+
+    try {
+        // Walk path from the second argument to the last one
+        LuaTableProxy proxy = lua.getTableProxy(1);
+        for (int index = 2; index < top; index++) {
+            proxy = proxy.getTable(lua.parseArgument(index));
+        }
+
+        LuaArgument value = proxy.get(lua.parseArgument(top));
+        LuaArgument size(static_cast<int>(proxy.size()));
+        lua.pushArgument(value);
+        lua.pushArgument(size);
+    } catch (const LuaException &) {
+        lua.pushArgument(LuaArgument(false));
+        return 1;
+    }
+
+    return 2;
+}
+
+CREATE_TEST_FUNCTION(checkParseCycle)
+{
+    LuaVmExtended lua(luaVm);
+
+    try {
+        lua.parseArgument(1);
+
+        lua.pushArgument(LuaArgument(false));
+    } catch (LuaTableCycle &) {
+        lua.pushArgument(LuaArgument(true));
+    } catch (LuaException &) {
+        lua.pushArgument(LuaArgument(false));
+    }
+
+    return 1;
+}
+
+CREATE_TEST_FUNCTION(checkParseDepth)
+{
+    LuaVmExtended lua(luaVm);
+
+    LuaParseOptions options;
+    options.maxDepth = static_cast<unsigned int>(lua.parseArgument(2, LuaArgumentType::LuaTypeInteger).toInteger());
+    lua.setParseOptions(options);
+
+    try {
+        lua.parseArgument(1);
+
+        lua.pushArgument(LuaArgument(false));
+    } catch (LuaParseLimitExceeded &) {
+        lua.pushArgument(LuaArgument(true));
+    } catch (LuaException &) {
+        lua.pushArgument(LuaArgument(false));
+    }
+
+    return 1;
+}
+
+CREATE_TEST_FUNCTION(echoShared)
+{
+    LuaVmExtended lua(luaVm);
+
+    LuaParseOptions options;
+    options.breakCycles = true;
+    options.shareReferences = true;
+    lua.setParseOptions(options);
+
+    auto vector = lua.getArguments();
+    return lua.pushArguments(vector.cbegin(), vector.cend());
+}
+
+CREATE_TEST_FUNCTION(pushMany)
+{
+    LuaVmExtended lua(luaVm);
+
+    int amount = lua.parseArgument(1, LuaArgumentType::LuaTypeInteger).toInteger();
+    LuaArgument::TableListType list;
+    for (int i = 1; i <= amount; i++) {
+        list.emplace_back(i);
+    }
+
+    // Values and nested list over the default stack size
+    lua.pushArgument(LuaArgument(list));
+    return 1 + lua.pushArguments(list.cbegin(), list.cend());
+}
+
+CREATE_TEST_FUNCTION(sumNumbers)
+{
+    LuaVmExtended lua(luaVm);
+
+    double sum = 0;
+    try {
+        for (const LuaStackValue &value : lua.getArgumentsView()) {
+            sum += value.toNumber();
+        }
+    } catch (const LuaUnexpectedType &) {
+        lua.pushArgument(LuaArgument(false));
+        return 1;
+    }
+
+    lua.pushArgument(LuaArgument(sum));
+    return 1;
+}
+
+CREATE_TEST_FUNCTION(sumField)
+{
+    /// Sums numeric field of records, stops on the first bad record
+    class SumFieldVisitor: public LuaTableVisitor
+    {
+    public:
+        explicit SumFieldVisitor(std::string field)
+            : field(std::move(field))
+        {}
+
+        LuaWalkAction beginTable(const LuaStackValue &, unsigned int depth) override
+        {
+            // Records only, nested tables are not interesting
+            return depth <= 1 ? LuaWalkAction::Continue : LuaWalkAction::Skip;
+        }
+
+        LuaWalkAction key(const LuaStackValue &key, unsigned int depth) override
+        {
+            if (depth == 0) {
+                return LuaWalkAction::Continue;
+            }
+            if (key.getType() != LuaArgumentType::LuaTypeString || field != key.toString()) {
+                return LuaWalkAction::Skip;
+            }
+            return LuaWalkAction::Continue;
+        }
+
+        LuaWalkAction value(const LuaStackValue &value, unsigned int depth) override
+        {
+            if (depth == 0 || !value.isNumber()) {
+                return LuaWalkAction::Stop;
+            }
+            sum += value.toNumber();
+            return LuaWalkAction::Skip;         // Field is found, go to the next record
+        }
+
+        double sum = 0;
+
+    private:
+        std::string field;
+    };
+
+    LuaVmExtended lua(luaVm);
+
+    try {
+        SumFieldVisitor visitor(lua.parseArgument(2, LuaArgumentType::LuaTypeString).toString());
+        if (!lua.walkTable(1, visitor, LuaWalkOrder::Sequence)) {
+            lua.pushArgument(LuaArgument(false));
+            return 1;
+        }
+
+        lua.pushArgument(LuaArgument(visitor.sum));
+    } catch (const LuaException &) {
+        lua.pushArgument(LuaArgument(false));
+    }
+    return 1;
+}
+
+CREATE_TEST_FUNCTION(extractShopItem)
+{
+    static const LuaSchema schema = LuaSchema()
+        .field("name", LuaArgumentType::LuaTypeString)
+        .field("price", LuaArgumentType::LuaTypeNumber)
+        .field("amount", LuaArgumentType::LuaTypeInteger, true)
+        .list("tags", LuaArgumentType::LuaTypeString, true)
+        .list(
+            "spawns",
+            LuaSchema()
+                .field("id", LuaArgumentType::LuaTypeInteger)
+                .field(
+                    "position",
+                    LuaSchema()
+                        .field("x", LuaArgumentType::LuaTypeNumber)
+                        .field("y", LuaArgumentType::LuaTypeNumber)
+                ),
+            true
+        );
+
+    LuaVmExtended lua(luaVm);
+    LuaCompiledSchema compiled = schema.compile(luaVm);
+
+    std::string path;
+    if (!compiled.validate(1, &path)) {
+        std::list<LuaArgument> result{LuaArgument(false), LuaArgument(path)};
+        return lua.pushArguments(result.cbegin(), result.cend());
+    }
+
+    lua.pushArgument(compiled.extract(1));
+    return 1;
+}
+
+CREATE_TEST_FUNCTION(extractSamples)
+{
+    static const LuaSchema schema = LuaSchema()
+        .field("name", LuaArgumentType::LuaTypeString)
+        .field("samples", LuaArgumentType::LuaTypeDoubleArray)
+        .field("ids", LuaArgumentType::LuaTypeInt32Array, true);
+
+    LuaVmExtended lua(luaVm);
+    LuaCompiledSchema compiled = schema.compile(luaVm);
+
+    // Validation and extraction must report the same path
+    std::string path;
+    const bool valid = compiled.validate(1, &path);
+    try {
+        LuaArgument result = compiled.extract(1);
+        if (!valid) {
+            lua.pushArgument(LuaArgument("Extracted invalid table"));
+            return 1;
+        }
+        lua.pushArgument(result);
+        return 1;
+    } catch (const LuaSchemaMismatch &e) {
+        std::list<LuaArgument> result{
+            LuaArgument(false),
+            LuaArgument(valid ? "Validated mismatched table" : e.getPath() == path ? path : "Paths differ")
+        };
+        return lua.pushArguments(result.cbegin(), result.cend());
+    }
+}
+
+CREATE_TEST_FUNCTION(typeNames)
+{
+    struct TypeNameVisitor
+    {
+        const char *operator()(LuaNil) const
+        {
+            return "nil";
+        }
+
+        const char *operator()(bool) const
+        {
+            return "boolean";
+        }
+
+        const char *operator()(double) const
+        {
+            return "number";
+        }
+
+        const char *operator()(int) const
+        {
+            return "integer";
+        }
+
+        const char *operator()(const std::string &) const
+        {
+            return "string";
+        }
+
+        const char *operator()(LuaLightUserdata) const
+        {
+            return "lightuserdata";
+        }
+
+        const char *operator()(LuaUserdata) const
+        {
+            return "userdata";
+        }
+
+        const char *operator()(const LuaObject &) const
+        {
+            return "object";
+        }
+
+        const char *operator()(const LuaArgument::TableListType &) const
+        {
+            return "table";
+        }
+
+        const char *operator()(const LuaArgument::TableMapType &) const
+        {
+            return "table";
+        }
+
+        const char *operator()(const LuaArgument::DoubleArrayType &) const
+        {
+            return "array";
+        }
+
+        const char *operator()(const LuaArgument::FloatArrayType &) const
+        {
+            return "array";
+        }
+
+        const char *operator()(const LuaArgument::Int32ArrayType &) const
+        {
+            return "array";
+        }
+    };
+
+    LuaVmExtended lua(luaVm);
+    std::list<LuaArgument> result;
+    for (const LuaArgument &argument : lua.getArguments()) {
+        result.emplace_back(argument.visit(TypeNameVisitor()));
+    }
+    return lua.pushArguments(result.cbegin(), result.cend());
+}
+
+CREATE_TEST_FUNCTION(internRecords)
+{
+    LuaStringPool pool(luaVm);
+    LuaVmExtended lua(luaVm);
+    lua.setStringPool(&pool);
+
+    LuaArgument records = lua.parseArgument(1);
+    std::list<LuaArgument> result{records, LuaArgument(static_cast<int>(pool.size()))};
+    return lua.pushArguments(result.cbegin(), result.cend());
+}
+
+CREATE_TEST_FUNCTION(sharedStringPool)
+{
+    // The pool of the VM lives until the resource stops, the first call comes from the main thread
+    std::unique_ptr<LuaStringPool> &pool = stringPools[lua_topointer(luaVm, LUA_REGISTRYINDEX)];
+    if (!pool) {
+        pool.reset(new LuaStringPool(luaVm));
+    }
+
+    LuaVmExtended lua(luaVm);
+    lua.setStringPool(pool.get());
+
+    LuaArgument records = lua.parseArgument(1);
+    std::list<LuaArgument> result{records, LuaArgument(static_cast<int>(pool->size()))};
+    return lua.pushArguments(result.cbegin(), result.cend());
+}
+
+CREATE_TEST_FUNCTION(numberArray)
+{
+    LuaParseOptions options;
+    options.numberArrays = true;
+
+    LuaVmExtended lua(luaVm);
+    lua.setParseOptions(options);
+
+    LuaArgument argument = lua.parseArgument(1);
+    std::list<LuaArgument> result{
+        LuaArgument(argument.getType() == LuaArgumentType::LuaTypeDoubleArray),
+        argument,
+    };
+    return lua.pushArguments(result.cbegin(), result.cend());
+}
+
+CREATE_TEST_FUNCTION(int32Array)
+{
+    LuaVmExtended lua(luaVm);
+    LuaArgument argument = lua.parseArgument(1, LuaArgumentType::LuaTypeInt32Array);
+
+    int sum = 0;
+    for (int32_t value : argument.toInt32Array()) {
+        sum += value;
+    }
+
+    std::list<LuaArgument> result{LuaArgument(sum), argument};
+    return lua.pushArguments(result.cbegin(), result.cend());
+}
+
+CREATE_TEST_FUNCTION(asyncSum)
+{
+    LuaVmExtended lua(luaVm);
+    try {
+        LuaArgument numbers = lua.parseArgument(1, LuaArgumentType::LuaTypeDoubleArray);
+        taskPool.submit(
+            luaVm,
+            2,
+            [numbers]() -> std::vector<LuaArgument>
+            {
+                double sum = 0;
+                for (double value : numbers.toDoubleArray()) {
+                    sum += value;
+                }
+                return {LuaArgument(sum)};
+            }
+        );
+    } catch (const LuaException &) {
+        lua.pushArgument(LuaArgument(false));
+        return 1;
+    }
+
+    lua.pushArgument(LuaArgument(true));
+    return 1;
+}
+
+CREATE_TEST_FUNCTION(setTimer)
+{
+    return scheduler.luaSetTimer(luaVm);
+}
+
+CREATE_TEST_FUNCTION(killTimer)
+{
+    return scheduler.luaKillTimer(luaVm);
+}
+
+CREATE_TEST_FUNCTION(snapshotRoundTrip)
+{
+    LuaVmExtended lua(luaVm);
+    LuaSnapshot snapshot(lua.parseArgument(1));
+    lua.pushArgument(snapshot.toArgument());
+    return 1;
 }
 
+CREATE_TEST_FUNCTION(batchEvents)
+{
+    LuaVmExtended lua(luaVm);
+    LuaEventBatcher::SubscriptionId id;
+    double count;
+    double distinct;
+    try {
+        count = lua.parseArgument(2, LuaArgumentType::LuaTypeNumber).toNumber();
+        distinct = lua.parseArgument(3, LuaArgumentType::LuaTypeNumber).toNumber();
+        id = events.subscribe(luaVm, 1);
+    } catch (const LuaException &) {
+        lua.pushArgument(LuaArgument(false));
+        return 1;
+    }
+
+    // Events with equal keys are merged, the callback gets one list on pulse
+    for (int i = 0; i < static_cast<int>(count); i++) {
+        if (distinct > 0) {
+            events.post(id, LuaArgument(i % static_cast<int>(distinct)), LuaArgument(i));
+        } else {
+            events.post(id, LuaArgument(i));
+        }
+    }
+
+    lua.pushArgument(LuaArgument(true));
+    return 1;
+}
+
+CREATE_TEST_FUNCTION(unsubscribeEvents)
+{
+    return events.luaUnsubscribe(luaVm);
+}
+
+CREATE_TEST_FUNCTION(runWorker)
+{
+    return statePool.luaRun(luaVm);
+}
+
+CREATE_TEST_FUNCTION(counters)
+{
+    {
+        LUA_COUNTERS_SCOPE("test_counters");
+        LuaVmExtended lua(luaVm);
+        LuaArgument argument = lua.parseArgument(1);
+        lua.pushArgument(argument);
+        lua_pop(luaVm, 1);
+    }
+
+    // Without MODULE_SDK_COUNTERS nothing is counted
+    bool counted = true;
+    if (LuaCounters::isEnabled()) {
+        auto functions = LuaCounters::getFunctions();
+        auto found = functions.find("test_counters");
+        counted = found != functions.end()
+            && found->second.apiCalls > 0
+            && found->second.tablesCreated > 0
+            && found->second.allocations > 0;
+    }
+
+    lua_pushboolean(luaVm, counted);
+    return 1;
+}
+
+CREATE_TEST_FUNCTION(raiseError)
+{
+    if (lua_toboolean(luaVm, 1)) {
+        lua_pushstring(luaVm, "Raised by test");
+        return lua_error(luaVm);
+    }
+    lua_pushboolean(luaVm, true);
+    return 1;
+}
+
+CREATE_TEST_FUNCTION(functionStats)
+{
+    // This call is in progress: counted, but not an error
+    bool inFlight = false;
+    bool recorded = false;
+    for (const auto &summary : functionStats.getSummaries(false)) {
+        if (summary.function == "test_functionStats") {
+            inFlight = summary.calls > 0 && summary.errors == 0;
+        } else if (summary.latency.getCount() > 0) {
+            recorded = recorded || summary.latency.getPercentile(0.5) <= summary.latency.getMax();
+        }
+    }
+
+    lua_pushboolean(luaVm, inFlight && recorded);
+    return 1;
+}
+
+CREATE_TEST_FUNCTION(profiler)
+{
+    // Scripts may profile the VM themselves
+    if (profiler.isRunning(luaVm)) {
+        lua_pushboolean(luaVm, true);
+        return 1;
+    }
+
+    LuaProfiler::Options options;
+    options.instructions = 100;
+    options.samplesPerSecond = 0;
+    const uint64_t samples = profiler.getStats(luaVm).samples;
+    if (!profiler.start(luaVm, "test_profiler", options)) {
+        lua_pushboolean(luaVm, false);
+        return 1;
+    }
+
+    lua_pushvalue(luaVm, 1);
+    const int status = lua_pcall(luaVm, 0, 0, 0);
+    profiler.stop(luaVm);
+
+    const std::string folded = profiler.toFolded();
+    lua_pushboolean(
+        luaVm,
+        status == 0 && profiler.getStats(luaVm).samples > samples && folded.find("test_profiler;") != std::string::npos
+    );
+    return 1;
+}
+
+CREATE_TEST_FUNCTION(memoryTelemetry)
+{
+    // Scripts may track the VM themselves
+    const bool enabled = memory.enable(luaVm, "test_memoryTelemetry");
+    const LuaMemoryTelemetry::Stats before = memory.getStats(luaVm);
+
+    LuaVmExtended lua(luaVm);
+    lua.pushArgument(lua.parseArgument(1));
+    lua_pop(luaVm, 1);
+
+    const LuaMemoryTelemetry::Stats after = memory.getStats(luaVm);
+    if (enabled) {
+        memory.disable(luaVm);
+    }
+
+    lua_pushboolean(
+        luaVm,
+        after.allocations > before.allocations
+            && after.moduleBytes > before.moduleBytes
+            && after.liveBytes > 0
+            && after.peakBytes >= after.liveBytes
+    );
+    return 1;
+}
+
+CREATE_TEST_FUNCTION(gcPacer)
+{
+    // Scripts may pace the VM themselves
+    if (gcPacer.isEnabled(luaVm)) {
+        lua_pushboolean(luaVm, true);
+        return 1;
+    }
+
+    const int pause = lua_gc(luaVm, LUA_GCSETPAUSE, 200);
+    lua_gc(luaVm, LUA_GCSETPAUSE, pause);
+    if (!gcPacer.enable(luaVm, LuaGcPacer::Options())) {
+        lua_pushboolean(luaVm, false);
+        return 1;
+    }
+
+    // Live memory (kept on the stack) grows over the trigger, pulses run until the cycle ends
+    lua_pushvalue(luaVm, 1);
+    const int status = lua_pcall(luaVm, 0, 1, 0);
+    for (int i = 0; i < 1000 && !gcPacer.getStats(luaVm).cycles; i++) {
+        gcPacer.pulse();
+    }
+
+    const LuaGcPacer::Stats stats = gcPacer.getStats(luaVm);
+    gcPacer.disable(luaVm);
+    lua_pop(luaVm, 1);
+    const int restored = lua_gc(luaVm, LUA_GCSETPAUSE, pause);
+
+    lua_pushboolean(
+        luaVm,
+        status == 0 && stats.steps > 0 && stats.cycles > 0 && stats.gcTime.count() > 0 && restored == pause
+    );
+    return 1;
+}
+
+uint64_t gcGeneration = 0;                          ///< Counting run of cycle sentinels (sentinels of old runs are ignored)
+
+uint64_t gcCycles = 0;
+
+void newGcSentinel(lua_State *luaVm);
+
+/**
+ * @brief Finalizer of the cycle sentinel: the cycle has finished, the next one gets a new sentinel
+ */
+int countGcCycle(lua_State *luaVm)
+{
+    if (*static_cast<uint64_t *>(lua_touserdata(luaVm, 1)) == gcGeneration) {
+        gcCycles++;
+        newGcSentinel(luaVm);
+    }
+    return 0;
+}
+
+/**
+ * @brief Unreachable userdata, which is finalized by the next finished cycle
+ */
+void newGcSentinel(lua_State *luaVm)
+{
+    *static_cast<uint64_t *>(lua_newuserdata(luaVm, sizeof(uint64_t))) = gcGeneration;
+    lua_createtable(luaVm, 0, 1);
+    lua_pushcfunction(luaVm, countGcCycle);
+    lua_setfield(luaVm, -2, "__gc");
+    lua_setmetatable(luaVm, -2);
+    lua_pop(luaVm, 1);
+}
+
+/**
+ * @brief Run the garbage function and pulses in turns
+ * @param stepped Pulses, which ran pacer steps
+ * @return Finished collection cycles
+ */
+uint64_t countGcCycles(lua_State *luaVm, int garbage, int pulses, int &stepped)
+{
+    gcGeneration++;
+    gcCycles = 0;
+    stepped = 0;
+    newGcSentinel(luaVm);
+    for (int i = 0; i < pulses; i++) {
+        lua_pushvalue(luaVm, garbage);
+        if (lua_pcall(luaVm, 0, 0, 0) != 0) {
+            lua_pop(luaVm, 1);
+        }
+        stepped += gcPacer.pulse() > 0;
+    }
+
+    gcGeneration++;
+    return gcCycles;
+}
+
+CREATE_TEST_FUNCTION(gcPacerCycles)
+{
+    // Scripts may pace the VM themselves
+    if (gcPacer.isEnabled(luaVm)) {
+        lua_pushboolean(luaVm, true);
+        return 1;
+    }
+
+    // Live memory
+    lua_pushvalue(luaVm, 1);
+    if (lua_pcall(luaVm, 0, 1, 0) != 0) {
+        lua_pushboolean(luaVm, false);
+        return 1;
+    }
+
+    // Scripts allocate between pulses, so automatic steps finish pacer cycles
+    constexpr int pulses = 150;
+    int stepped = 0;
+    const uint64_t automatic = countGcCycles(luaVm, 2, pulses, stepped);
+
+    // A single step per pulse (independent of the machine speed), so pacer cycles span many pulses
+    LuaGcPacer::Options options;
+    options.budget = std::chrono::microseconds(1);
+    gcPacer.enable(luaVm, options);
+    const uint64_t paced = countGcCycles(luaVm, 2, pulses, stepped);
+    gcPacer.disable(luaVm);
+
+    // Sentinels are finalized while the module is loaded
+    lua_pop(luaVm, 1);
+    lua_gc(luaVm, LUA_GCCOLLECT, 0);
+    lua_gc(luaVm, LUA_GCCOLLECT, 0);
+
+    // Cycles start after the trigger growth (instead of the pause growth), back to back cycles step in every pulse
+    const uint64_t ratio = (options.minPause - 100) / (options.trigger - 100);
+    lua_pushboolean(luaVm, automatic > 0 && paced <= automatic * ratio + 2 && stepped > 0 && stepped * 4 <= pulses * 3);
+    return 1;
+}
+
+#ifdef MODULE_SDK_COROUTINES
+
+/**
+ * @brief Resolve after delay (scripts see blocking sleep)
+ */
+LuaAsync sleepAsync(unsigned int delay)
+{
+    LuaPromise promise;
+    scheduler.setTimer(
+        [promise]() mutable
+        {
+            promise.resolve({LuaArgument(true)});
+        },
+        delay
+    );
+    co_return co_await promise;
+}
+
+CREATE_TEST_FUNCTION(asyncSleep)
+{
+    // Nothing with a destructor stays on the C stack: the yield may raise an error
+    double delay;
+    try {
+        delay = LuaVmExtended(luaVm).parseArgument(1, LuaArgumentType::LuaTypeNumber).toNumber();
+    } catch (const LuaException &) {
+        lua_pushboolean(luaVm, false);
+        return 1;
+    }
+    return coroutines.call(luaVm, sleepAsync(static_cast<unsigned int>(delay)));
+}
+
+CREATE_TEST_FUNCTION(asyncSuspended)
+{
+    lua_pushnumber(luaVm, static_cast<lua_Number>(coroutines.getSuspended()));
+    return 1;
+}
+
+#endif
+
+}
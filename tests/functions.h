@@ -1,8 +1,22 @@
 #pragma once
 
+#include "ModuleSdk/LuaEventBatcher.h"
+#include "ModuleSdk/LuaFunctionStats.h"
+#include "ModuleSdk/LuaGcPacer.h"
+#include "ModuleSdk/LuaMemoryTelemetry.h"
+#include "ModuleSdk/LuaProfiler.h"
+#include "ModuleSdk/LuaScheduler.h"
+#include "ModuleSdk/LuaStatePool.h"
+#include "ModuleSdk/LuaTaskPool.h"
 #include "ModuleSdk/LuaVmExtended.h"
+#include <map>
+#include <memory>
 #include <unordered_map>
 
+#ifdef MODULE_SDK_COROUTINES
+#include "ModuleSdk/LuaCoroutines.h"
+#endif
+
 
 namespace TestFunction
 {
@@ -11,4 +25,26 @@ using Type = int (*)(lua_State *);
 
 extern std::unordered_map<std::string, Type> allFunctions;
 
+extern LuaTaskPool taskPool;                ///< Async jobs (delivered in DoPulse)
+
+extern LuaStatePool statePool;              ///< Worker lua states (delivered in DoPulse)
+
+extern LuaScheduler scheduler;              ///< Native timers and deferred tasks (run in DoPulse)
+
+extern LuaEventBatcher events;              ///< Batched events (delivered at the end of DoPulse)
+
+extern LuaFunctionStats functionStats;      ///< Call statistics of test functions
+
+extern LuaProfiler profiler;                ///< Lua sampling profiler (collected in DoPulse)
+
+extern LuaMemoryTelemetry memory;           ///< Resource memory telemetry (rates updated in DoPulse)
+
+extern LuaGcPacer gcPacer;                  ///< Incremental collection of opted-in resources (in DoPulse)
+
+extern std::map<const void *, std::unique_ptr<LuaStringPool>> stringPools;     ///< By VM registry
+
+#ifdef MODULE_SDK_COROUTINES
+extern LuaCoroutines coroutines;            ///< Async functions (resumed in DoPulse)
+#endif
+
 }
\ No newline at end of file
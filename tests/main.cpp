@@ -1,6 +1,9 @@
 #include "functions.h"
+#include "ModuleSdk/LuaCounters.h"
+#include "ModuleSdk/LuaVectorMath.h"
 #include "lua/ILuaModuleManager.h"
 #include "lua/LuaImports.h"
+#include <chrono>
 #include <cstring>
 #include <numeric>
 
@@ -65,25 +68,184 @@ EXTERN_C void RegisterFunctions(lua_State *luaVm)
         }
     );
 
+    pModuleManager->RegisterFunction(
+        luaVm,
+        "test_dev_clock",
+        [](lua_State *luaVm) -> int
+        {
+            // Monotonic microseconds for benchmark scripts
+            auto now = std::chrono::steady_clock::now().time_since_epoch();
+            lua_pushnumber(
+                luaVm,
+                static_cast<lua_Number>(std::chrono::duration_cast<std::chrono::microseconds>(now).count())
+            );
+            return 1;
+        }
+    );
+
     for (const auto &pair : TestFunction::allFunctions) {
-        pModuleManager->RegisterFunction(
+        TestFunction::functionStats.registerFunction(
+            pModuleManager,
             luaVm,
             ("test_" + pair.first).c_str(),
             pair.second
         );
     }
+
+    pModuleManager->RegisterFunction(
+        luaVm,
+        "getFunctionStats",
+        [](lua_State *luaVm) -> int
+        {
+            return TestFunction::functionStats.luaGetStats(luaVm);
+        }
+    );
+
+    pModuleManager->RegisterFunction(
+        luaVm,
+        "dumpFunctionStats",
+        [](lua_State *luaVm) -> int
+        {
+            return TestFunction::functionStats.luaDump(luaVm);
+        }
+    );
+
+    pModuleManager->RegisterFunction(luaVm, "getMarshalingCounters", LuaCounters::luaGetCounters);
+
+    pModuleManager->RegisterFunction(
+        luaVm,
+        "startProfiler",
+        [](lua_State *luaVm) -> int
+        {
+            return TestFunction::profiler.luaStart(luaVm, pModuleManager);
+        }
+    );
+
+    pModuleManager->RegisterFunction(
+        luaVm,
+        "stopProfiler",
+        [](lua_State *luaVm) -> int
+        {
+            return TestFunction::profiler.luaStop(luaVm);
+        }
+    );
+
+    pModuleManager->RegisterFunction(
+        luaVm,
+        "getProfilerStats",
+        [](lua_State *luaVm) -> int
+        {
+            return TestFunction::profiler.luaGetStats(luaVm);
+        }
+    );
+
+    pModuleManager->RegisterFunction(
+        luaVm,
+        "dumpProfiler",
+        [](lua_State *luaVm) -> int
+        {
+            return TestFunction::profiler.luaDump(luaVm);
+        }
+    );
+
+    pModuleManager->RegisterFunction(
+        luaVm,
+        "enableMemoryTelemetry",
+        [](lua_State *luaVm) -> int
+        {
+            return TestFunction::memory.luaEnable(luaVm, pModuleManager);
+        }
+    );
+
+    pModuleManager->RegisterFunction(
+        luaVm,
+        "disableMemoryTelemetry",
+        [](lua_State *luaVm) -> int
+        {
+            return TestFunction::memory.luaDisable(luaVm);
+        }
+    );
+
+    pModuleManager->RegisterFunction(
+        luaVm,
+        "getMemoryStats",
+        [](lua_State *luaVm) -> int
+        {
+            return TestFunction::memory.luaGetStats(luaVm);
+        }
+    );
+
+    pModuleManager->RegisterFunction(
+        luaVm,
+        "dumpMemoryStats",
+        [](lua_State *luaVm) -> int
+        {
+            return TestFunction::memory.luaDump(luaVm);
+        }
+    );
+
+    pModuleManager->RegisterFunction(
+        luaVm,
+        "enableGcPacer",
+        [](lua_State *luaVm) -> int
+        {
+            return TestFunction::gcPacer.luaEnable(luaVm);
+        }
+    );
+
+    pModuleManager->RegisterFunction(
+        luaVm,
+        "disableGcPacer",
+        [](lua_State *luaVm) -> int
+        {
+            return TestFunction::gcPacer.luaDisable(luaVm);
+        }
+    );
+
+    pModuleManager->RegisterFunction(
+        luaVm,
+        "getGcPacerStats",
+        [](lua_State *luaVm) -> int
+        {
+            return TestFunction::gcPacer.luaGetStats(luaVm);
+        }
+    );
+
+    for (const auto &pair : LuaVectorMath::getLuaFunctions()) {
+        pModuleManager->RegisterFunction(luaVm, pair.first.c_str(), pair.second);
+    }
 }
 
+// Called by the server every tick on the main thread
 EXTERN_C bool DoPulse()
 {
-    // TODO: Understand, what is it
+    TestFunction::taskPool.pulse();
+    TestFunction::statePool.pulse();
+    TestFunction::scheduler.pulse();
+#ifdef MODULE_SDK_COROUTINES
+    TestFunction::coroutines.pulse();
+#endif
+    TestFunction::events.flush();
+    TestFunction::profiler.pulse();
+    TestFunction::memory.pulse();
+    TestFunction::gcPacer.pulse();
     return true;
 }
 
 
-EXTERN_C void ResourceStopped(lua_State *)
+EXTERN_C void ResourceStopped(lua_State *luaVm)
 {
-
+    TestFunction::taskPool.resourceStopped(luaVm);
+    TestFunction::statePool.resourceStopped(luaVm);
+    TestFunction::scheduler.resourceStopped(luaVm);
+    TestFunction::events.resourceStopped(luaVm);
+    TestFunction::profiler.resourceStopped(luaVm);
+    TestFunction::memory.resourceStopped(luaVm);
+    TestFunction::gcPacer.resourceStopped(luaVm);
+    TestFunction::stringPools.erase(lua_topointer(luaVm, LUA_REGISTRYINDEX));
+#ifdef MODULE_SDK_COROUTINES
+    TestFunction::coroutines.resourceStopped(luaVm);
+#endif
 }
 
 